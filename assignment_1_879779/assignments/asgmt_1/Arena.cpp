@@ -0,0 +1,106 @@
+#include "Arena.h"
+
+#include <new>
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+static atomic<int> hugePages {HUGE_PAGES_TRANSPARENT};
+static atomic<long long> regionBytes {0};
+static atomic<long long> fallbacks {0};
+
+static size_t getRegionSize(size_t bytes) {
+    return (bytes + ARENA_HUGE_PAGE - 1) / ARENA_HUGE_PAGE * ARENA_HUGE_PAGE;
+}
+
+/**
+ * @param bytes
+ * @return cache-line aligned memory, huge-page aligned from ARENA_MIN_REGION bytes
+ */
+void* Arena::allocate(size_t bytes) {
+    if (bytes < ARENA_MIN_REGION) {
+        return ::operator new(bytes, align_val_t(ARENA_ALIGNMENT));
+    }
+#ifdef __linux__
+    size_t size = getRegionSize(bytes);
+    HugePages mode = getHugePages();
+    if (mode == HUGE_PAGES_EXPLICIT) {
+        void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (region != MAP_FAILED) {
+            regionBytes += (long long) size;
+            return region;
+        }
+        fallbacks++; // no reserved huge pages left
+    }
+
+    // Map a huge page more than needed, then unmap the unaligned ends
+    auto* mapped = (char*) mmap(nullptr, size + ARENA_HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED) {
+        throw bad_alloc();
+    }
+    auto* region = (char*) (((uintptr_t) mapped + ARENA_HUGE_PAGE - 1) & ~(uintptr_t) (ARENA_HUGE_PAGE - 1));
+    if (region > mapped) munmap(mapped, region - mapped);
+    if (region < mapped + ARENA_HUGE_PAGE) munmap(region + size, mapped + ARENA_HUGE_PAGE - region);
+    madvise(region, size, mode == HUGE_PAGES_OFF ? MADV_NOHUGEPAGE : MADV_HUGEPAGE);
+    regionBytes += (long long) size;
+    return region;
+#else
+    return ::operator new(bytes, align_val_t(ARENA_HUGE_PAGE));
+#endif
+}
+
+void Arena::release(void* pointer, size_t bytes) {
+    if (bytes < ARENA_MIN_REGION) {
+        ::operator delete(pointer, align_val_t(ARENA_ALIGNMENT));
+        return;
+    }
+#ifdef __linux__
+    size_t size = getRegionSize(bytes);
+    munmap(pointer, size);
+    regionBytes -= (long long) size;
+#else
+    ::operator delete(pointer, align_val_t(ARENA_HUGE_PAGE));
+#endif
+}
+
+/**
+ * Pages of the regions mapped from now on, the ones already mapped keep theirs
+ */
+void Arena::setHugePages(HugePages mode) {
+    hugePages = mode;
+}
+
+HugePages Arena::getHugePages() {
+    return (HugePages) hugePages.load();
+}
+
+HugePages Arena::parseHugePages(const string& name) {
+    if (name == "off") return HUGE_PAGES_OFF;
+    if (name == "thp") return HUGE_PAGES_TRANSPARENT;
+    if (name == "explicit") return HUGE_PAGES_EXPLICIT;
+    throw invalid_argument("unknown huge pages " + name + ", expected off, thp or explicit");
+}
+
+string Arena::getName(HugePages mode) {
+    return mode == HUGE_PAGES_OFF ? "off" : mode == HUGE_PAGES_TRANSPARENT ? "thp" : "explicit";
+}
+
+/**
+ * Bytes of the regions currently mapped
+ */
+long long Arena::getRegionBytes() {
+    return regionBytes;
+}
+
+/**
+ * Regions that asked for explicit huge pages and got transparent ones
+ */
+long long Arena::getFallbacks() {
+    return fallbacks;
+}
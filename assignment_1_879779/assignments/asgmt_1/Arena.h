@@ -0,0 +1,59 @@
+#ifndef LEARNING_MASSIVE_DATA_ARENA_H
+#define LEARNING_MASSIVE_DATA_ARENA_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+#define ARENA_ALIGNMENT 64 //of every allocation, a cache line
+#define ARENA_HUGE_PAGE (2 << 20) //size and alignment of the regions of large arrays, a huge page on x86-64
+#define ARENA_MIN_REGION (1 << 20) //arrays from this size get their own region, smaller ones come from the heap
+
+/**
+ * Pages of the regions: normal pages only (MADV_NOHUGEPAGE), transparent huge pages (MADV_HUGEPAGE, the kernel
+ * backs the region with huge pages when it can) or explicit huge pages (MAP_HUGETLB, from the pool reserved in
+ * /proc/sys/vm/nr_hugepages, transparent ones when the pool is empty)
+ */
+enum HugePages { HUGE_PAGES_OFF, HUGE_PAGES_TRANSPARENT, HUGE_PAGES_EXPLICIT };
+
+/**
+ * Memory of the graph arrays. Arrays of at least ARENA_MIN_REGION bytes are mapped in their own region, aligned
+ * to and rounded up to ARENA_HUGE_PAGE so that it can be backed by huge pages: random accesses to the neighbours
+ * then need one TLB entry per 2 MB instead of one per 4 KB. Smaller arrays come from the heap, cache-line aligned.
+ */
+class Arena {
+    public:
+    static void* allocate(size_t bytes);
+    static void release(void* pointer, size_t bytes);
+
+    static void setHugePages(HugePages mode);
+    static HugePages getHugePages();
+    static HugePages parseHugePages(const std::string& name);
+    static std::string getName(HugePages mode);
+
+    static long long getRegionBytes();
+    static long long getFallbacks();
+};
+
+/**
+ * Allocator of the graph arrays, stateless: every ArenaAllocator can release what another one allocated
+ */
+template<typename T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    ArenaAllocator() = default;
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>&) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(Arena::allocate(n * sizeof(T))); }
+    void deallocate(T* pointer, size_t n) { Arena::release(pointer, n * sizeof(T)); }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>&) const { return true; }
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif
@@ -0,0 +1,258 @@
+#include "Benchmark.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+#ifndef BENCHMARK_COMPILER_FLAGS
+#define BENCHMARK_COMPILER_FLAGS "unknown"
+#endif
+#ifndef BENCHMARK_BUILD_TYPE
+#define BENCHMARK_BUILD_TYPE "unknown"
+#endif
+
+/**
+ * Time a kernel: warm-up runs first, then timed runs until the stopping rule of the config is met
+ * @param nThreads recorded in the result, the kernel is expected to use it
+ * @param config
+ * @param expected count every run must return, -1 to not check it
+ * @param kernel
+ * @return samples and statistics of the timed runs
+ */
+BenchmarkResult Benchmark::run(int nThreads, const BenchmarkConfig& config, long long expected,
+                               const function<long long()>& kernel) {
+    BenchmarkResult result;
+    result.nThreads = nThreads;
+
+    for (int i = 0; i < config.warmup; i++) {
+        result.count = kernel();
+        result.correct &= expected < 0 || result.count == expected;
+    }
+
+    PerfCounters counters;
+    auto budgetStart = chrono::steady_clock::now();
+    while (true) {
+        // The counters are opened and read outside of the timed region
+        if (config.perfCounters) counters.start(nThreads);
+        auto start = chrono::steady_clock::now();
+        result.count = kernel();
+        auto end = chrono::steady_clock::now();
+        if (config.perfCounters) {
+            counters.stop();
+            result.counters += counters.getTotal();
+            result.threadCounters.resize(counters.getPerThread().size());
+            for (size_t t = 0; t < result.threadCounters.size(); t++) {
+                result.threadCounters[t] += counters.getPerThread()[t];
+            }
+        }
+
+        result.samples.push_back(chrono::duration_cast<chrono::nanoseconds> (end - start).count());
+        result.correct &= expected < 0 || result.count == expected;
+
+        int n = (int) result.samples.size();
+        if (n < config.minRepetitions) continue;
+        computeStatistics(result);
+        double spent = chrono::duration<double> (end - budgetStart).count();
+        if (result.relError <= config.targetRelError || n >= config.maxRepetitions || spent >= config.timeBudget) break;
+    }
+    computeStatistics(result);
+
+    double runs = (double) result.samples.size();
+    result.counters /= runs;
+    for (auto& sample: result.threadCounters) {
+        sample /= runs;
+    }
+    return result;
+}
+
+/**
+ * min, median, p95 (nearest rank), mean, standard deviation and relative error of the mean at 95% confidence
+ */
+void Benchmark::computeStatistics(BenchmarkResult& result) {
+    vector<long long> sorted = result.samples;
+    sort(sorted.begin(), sorted.end());
+    size_t n = sorted.size();
+
+    result.min = (double) sorted.front();
+    result.median = n % 2 ? (double) sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2.0;
+    result.p95 = (double) sorted[(size_t) ceil(0.95 * (double) n) - 1];
+
+    double sum = 0;
+    for (long long t: sorted) sum += (double) t;
+    result.mean = sum / (double) n;
+
+    double squares = 0;
+    for (long long t: sorted) squares += ((double) t - result.mean) * ((double) t - result.mean);
+    result.stddev = n > 1 ? sqrt(squares / (double) (n - 1)) : 0;
+    result.relError = result.mean > 0 ? 1.96 * result.stddev / sqrt((double) n) / result.mean : 0;
+}
+
+/**
+ * Speedup and parallel efficiency of every result against the median of the 1-thread result, if there is one
+ * @param results
+ */
+void Benchmark::computeSpeedups(vector<BenchmarkResult>& results) {
+    auto baseline = find_if(results.begin(), results.end(), [](const BenchmarkResult& r) { return r.nThreads == 1; });
+    if (baseline == results.end()) return;
+
+    double base = baseline->median;
+    for (auto& result: results) {
+        result.speedup = result.median > 0 ? base / result.median : 0;
+        result.efficiency = result.speedup / result.nThreads;
+    }
+}
+
+/**
+ * Host name, CPU, no. of hardware threads, compiler, compiler flags, build type and date of the run
+ * @return
+ */
+BenchmarkMetadata Benchmark::getHostMetadata() {
+    BenchmarkMetadata metadata;
+
+    char host[256] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+    metadata.emplace_back("host", host);
+
+    string cpu = "unknown";
+    ifstream cpuinfo("/proc/cpuinfo");
+    string line;
+    while (getline(cpuinfo, line)) {
+        if (line.rfind("model name", 0) == 0) {
+            cpu = line.substr(line.find(':') + 2);
+            break;
+        }
+    }
+    metadata.emplace_back("cpu", cpu);
+    metadata.emplace_back("hardware_threads", to_string(thread::hardware_concurrency()));
+
+#ifdef __VERSION__
+    metadata.emplace_back("compiler", __VERSION__);
+#endif
+    metadata.emplace_back("compiler_flags", BENCHMARK_COMPILER_FLAGS);
+    metadata.emplace_back("build_type", BENCHMARK_BUILD_TYPE);
+
+    time_t now = time(nullptr);
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    metadata.emplace_back("date", date);
+    return metadata;
+}
+
+string Benchmark::escapeJson(const string& text) {
+    string escaped;
+    for (char c: text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if ((unsigned char) c < 0x20) {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+/**
+ * Write the counters as a JSON object, null for the events that were not available
+ */
+void Benchmark::writeCountersJson(ostream& out, const PerfSample& sample) {
+    out << "{";
+    for (int e = 0; e < N_PERF_EVENTS; e++) {
+        out << (e ? ", " : "") << "\"" << PerfCounters::getName(e) << "\": ";
+        if (sample.valid[e]) out << sample.values[e];
+        else out << "null";
+    }
+    out << "}";
+}
+
+/**
+ * Write the metadata and, for each thread count, statistics and raw samples as a JSON object
+ * @param path
+ * @param metadata
+ * @param results
+ */
+void Benchmark::saveJson(const string& path, const BenchmarkMetadata& metadata, const vector<BenchmarkResult>& results) {
+    ofstream out(path, ios::trunc);
+    if (!out.is_open()) {
+        throw runtime_error("unable to open " + path);
+    }
+    out << setprecision(17);
+
+    out << "{\n  \"metadata\": {";
+    for (size_t i = 0; i < metadata.size(); i++) {
+        out << (i ? "," : "") << "\n    \"" << escapeJson(metadata[i].first) << "\": \"" << escapeJson(metadata[i].second) << "\"";
+    }
+    out << "\n  },\n  \"unit\": \"ns\",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult& r = results[i];
+        out << (i ? "," : "") << "\n    {\"threads\": " << r.nThreads << ", \"count\": " << r.count
+            << ", \"correct\": " << (r.correct ? "true" : "false") << ", \"runs\": " << r.samples.size()
+            << ", \"min\": " << r.min << ", \"median\": " << r.median << ", \"p95\": " << r.p95
+            << ", \"mean\": " << r.mean << ", \"stddev\": " << r.stddev << ", \"rel_error\": " << r.relError
+            << ", \"speedup\": " << r.speedup << ", \"efficiency\": " << r.efficiency << ", \"samples\": [";
+        for (size_t j = 0; j < r.samples.size(); j++) {
+            out << (j ? ", " : "") << r.samples[j];
+        }
+        out << "]";
+        if (r.counters.any()) {
+            out << ", \"counters\": ";
+            writeCountersJson(out, r.counters);
+            out << ", \"thread_counters\": [";
+            for (size_t t = 0; t < r.threadCounters.size(); t++) {
+                out << (t ? ", " : "");
+                writeCountersJson(out, r.threadCounters[t]);
+            }
+            out << "]";
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}" << endl;
+}
+
+/**
+ * Write the metadata as "# key: value" comment lines, then one row of statistics for each thread count
+ * @param path
+ * @param metadata
+ * @param results
+ */
+void Benchmark::saveCsv(const string& path, const BenchmarkMetadata& metadata, const vector<BenchmarkResult>& results) {
+    ofstream out(path, ios::trunc);
+    if (!out.is_open()) {
+        throw runtime_error("unable to open " + path);
+    }
+    out << setprecision(17);
+
+    for (const auto& [key, value]: metadata) {
+        out << "# " << key << ": " << value << "\n";
+    }
+    out << "threads,count,correct,runs,min_ns,median_ns,p95_ns,mean_ns,stddev_ns,rel_error,speedup,efficiency";
+    for (int e = 0; e < N_PERF_EVENTS; e++) {
+        out << "," << PerfCounters::getName(e);
+    }
+    out << "\n";
+    for (const auto& r: results) {
+        out << r.nThreads << "," << r.count << "," << (r.correct ? "true" : "false") << "," << r.samples.size() << ","
+            << r.min << "," << r.median << "," << r.p95 << "," << r.mean << "," << r.stddev << "," << r.relError << ","
+            << r.speedup << "," << r.efficiency;
+        for (int e = 0; e < N_PERF_EVENTS; e++) {
+            out << ",";
+            if (r.counters.valid[e]) out << r.counters.values[e]; // empty when not available
+        }
+        out << "\n";
+    }
+}
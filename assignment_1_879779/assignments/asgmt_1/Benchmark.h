@@ -0,0 +1,60 @@
+#ifndef LEARNING_MASSIVE_DATA_BENCHMARK_H
+#define LEARNING_MASSIVE_DATA_BENCHMARK_H
+
+#include "PerfCounters.h"
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <functional>
+#include <ostream>
+
+/**
+ * When to stop repeating a measurement: after minRepetitions runs, as soon as the relative error of the mean
+ * (95% confidence) is below targetRelError, or when maxRepetitions runs or timeBudget seconds are reached.
+ */
+struct BenchmarkConfig {
+    int warmup = 1;
+    int minRepetitions = 5;
+    int maxRepetitions = 100;
+    double targetRelError = 0.02;
+    double timeBudget = 10;
+    bool perfCounters = false;   // record the hardware counters of every timed run
+};
+
+/**
+ * Measurements of one thread count, times in nanoseconds
+ */
+struct BenchmarkResult {
+    int nThreads = 1;
+    std::vector<long long> samples;
+    long long count = 0;         // result of the last run
+    bool correct = true;         // every run agreed with the expected count
+    double min = 0, median = 0, p95 = 0, mean = 0, stddev = 0, relError = 0;
+    double speedup = 0, efficiency = 0; // against the 1-thread median, 0 without a 1-thread result
+    PerfSample counters;                     // mean of the timed runs, all threads together
+    std::vector<PerfSample> threadCounters;  // mean of the timed runs, for each thread
+};
+
+/**
+ * Ordered key/value pairs describing a benchmark (host, build, graph, algorithm)
+ */
+using BenchmarkMetadata = std::vector<std::pair<std::string, std::string>>;
+
+class Benchmark {
+    public:
+    static BenchmarkResult run(int nThreads, const BenchmarkConfig& config, long long expected,
+                               const std::function<long long()>& kernel);
+    static void computeSpeedups(std::vector<BenchmarkResult>& results);
+
+    static BenchmarkMetadata getHostMetadata();
+    static void saveJson(const std::string& path, const BenchmarkMetadata& metadata, const std::vector<BenchmarkResult>& results);
+    static void saveCsv(const std::string& path, const BenchmarkMetadata& metadata, const std::vector<BenchmarkResult>& results);
+
+    private:
+    static void computeStatistics(BenchmarkResult& result);
+    static std::string escapeJson(const std::string& text);
+    static void writeCountersJson(std::ostream& out, const PerfSample& sample);
+};
+
+#endif
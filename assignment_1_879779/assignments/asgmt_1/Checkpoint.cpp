@@ -0,0 +1,134 @@
+#include "Checkpoint.h"
+
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+/**
+ * @param path checkpoint file
+ * @param resume continue from the file if it exists, otherwise it is overwritten
+ * @param interval seconds between two writes, 0 to write after every unit
+ */
+Checkpoint::Checkpoint(const string& path, bool resume, double interval)
+        : path(path), resume(resume), interval(interval) {}
+
+/**
+ * Identity of a run: a checkpoint only resumes the same count of the same, unchanged, file
+ * @param algorithm
+ * @param path file of edges
+ * @param parameter colors of colorful, memory budget of external: they decide the units
+ * @return
+ */
+string Checkpoint::getRun(const string& algorithm, const string& path, long long parameter) {
+    filesystem::path file = filesystem::weakly_canonical(path);
+    long long modified = filesystem::last_write_time(file).time_since_epoch().count();
+    return algorithm + " " + to_string(parameter) + " " + to_string(filesystem::file_size(file)) + " "
+           + to_string(modified) + " " + file.string();
+}
+
+/**
+ * Called by the kernel before counting
+ * @param run identity of the count, see getRun
+ * @return the finished work to skip, nothing if not resuming or the file does not exist yet
+ */
+CheckpointState Checkpoint::start(const string& run) {
+    this->run = run;
+    last = CheckpointState();
+    lastSave = Clock::now();
+    stopped = false;
+    if (!resume || !filesystem::exists(path)) {
+        return last;
+    }
+
+    ifstream in(path);
+    if (!in.is_open()) {
+        throw runtime_error("unable to open " + path);
+    }
+    string line, saved;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        stringstream fields(line);
+        string name;
+        fields >> name;
+        if (name == "run") {
+            saved = line.substr(4);
+            continue;
+        }
+        long long value;
+        if (!(fields >> value)) {
+            throw runtime_error("invalid line in " + path + ": " + line);
+        }
+        if (name == "total") last.total = value;
+        else if (name == "done") last.done = value;
+        else if (name == "next") last.next = value;
+        else if (name == "count") last.count = value;
+        else throw runtime_error("unknown field " + name + " in " + path);
+    }
+    if (saved != run) {
+        throw invalid_argument(path + " is the checkpoint of another run: " + saved);
+    }
+    if (last.done < 0 || last.done > last.total || last.next < 0) {
+        throw runtime_error("invalid progress in " + path);
+    }
+    return last;
+}
+
+/**
+ * Called by the kernel after a unit or a block, from one thread
+ * @param state finished work
+ * @return true if the kernel has to stop, the file is written
+ */
+bool Checkpoint::update(const CheckpointState& state) {
+    last = state;
+    if (stop != nullptr && stop->load()) {
+        save(state);
+        stopped = true;
+        return true;
+    }
+    if (chrono::duration<double>(Clock::now() - lastSave).count() >= interval) {
+        save(state);
+    }
+    return false;
+}
+
+/**
+ * Called by the kernel at the end: a run resumed after it returns the count without counting again
+ */
+void Checkpoint::finish(const CheckpointState& state) {
+    last = state;
+    save(state);
+}
+
+/**
+ * @return fraction of the units finished
+ */
+double Checkpoint::getFraction() const {
+    return last.total > 0 ? (double) last.done / (double) last.total : 0;
+}
+
+void Checkpoint::save(const CheckpointState& state) {
+    ostringstream text;
+    text << "# progress of a triangle count, see Checkpoint\n"
+         << "run " << run << "\n"
+         << "total " << state.total << "\n"
+         << "done " << state.done << "\n"
+         << "next " << state.next << "\n"
+         << "count " << state.count << "\n";
+    string content = text.str();
+
+    string temporary = path + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool written = fd >= 0 && write(fd, content.data(), content.size()) == (ssize_t) content.size() && fsync(fd) == 0;
+    if (fd >= 0) close(fd);
+    if (!written || rename(temporary.c_str(), path.c_str()) != 0) {
+        throw runtime_error("unable to write " + path + ": " + strerror(errno));
+    }
+    lastSave = Clock::now();
+}
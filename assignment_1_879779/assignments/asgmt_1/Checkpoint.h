@@ -0,0 +1,59 @@
+#ifndef LEARNING_MASSIVE_DATA_CHECKPOINT_H
+#define LEARNING_MASSIVE_DATA_CHECKPOINT_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#define CHECKPOINT_INTERVAL 60 //default seconds between two writes of the checkpoint file
+
+/**
+ * Work of a partitioned count that is finished. The units are the passes of external, each over a range of
+ * nodes, and the color subgraphs of colorful.
+ */
+struct CheckpointState {
+    long long total = 0;    // units of the whole count
+    long long done = 0;     // units finished
+    long long next = 0;     // external: first node of unit done whose out-neighbours are not scanned yet
+    long long count = 0;    // triangles of the finished work
+};
+
+/**
+ * Progress of a partitioned count (colorful, external) kept in a small text file, so that a preempted run can
+ * resume where the last write left it instead of starting over. The kernel calls start() with the identity of its
+ * run, which returns the state to resume from, update() after each unit or block, which writes the file at most
+ * every interval seconds, and finish() at the end. The file is written to a temporary file, synced and renamed
+ * over the old one, so a kill never leaves it half written. When the stop flag is set (SIGTERM of the scheduler,
+ * Ctrl-C), update() writes the file at once and tells the kernel to return the count of the finished work.
+ */
+class Checkpoint {
+    public:
+    using Clock = std::chrono::steady_clock;
+
+    Checkpoint(const std::string& path, bool resume, double interval = CHECKPOINT_INTERVAL);
+    void setStop(const std::atomic<bool>* flag) { stop = flag; }
+
+    CheckpointState start(const std::string& run);
+    bool update(const CheckpointState& state);
+    void finish(const CheckpointState& state);
+
+    bool isStopped() const { return stopped; }
+    double getFraction() const;
+
+    static std::string getRun(const std::string& algorithm, const std::string& path, long long parameter);
+
+    private:
+    void save(const CheckpointState& state);
+
+    std::string path;
+    bool resume;
+    double interval;
+    const std::atomic<bool>* stop = nullptr;
+
+    std::string run;
+    CheckpointState last;
+    Clock::time_point lastSave;
+    bool stopped = false;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "Control.h"
+
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * @param callback called from one counting thread at a time, never concurrently; if it throws the count stops
+ * and rethrowError() throws the exception
+ * @param interval seconds between two calls
+ */
+void Control::setProgress(const function<void(const ControlReport&)>& callback, double interval) {
+    progress = callback;
+    this->interval = interval;
+}
+
+/**
+ * Called by the kernel before its loop
+ * @param work units of work of the whole count
+ */
+void Control::start(long long work) {
+    total = work;
+    done = 0;
+    startTime = Clock::now();
+    nextReport = (long long) (interval * 1e9);
+    error = nullptr;
+    reporting = false;
+    stopped = (cancel != nullptr && cancel->load()) || startTime >= deadline;
+}
+
+/**
+ * Called by the kernel after a block
+ * @param work units of work of the block
+ */
+void Control::advance(long long work) {
+    done.fetch_add(work, memory_order_relaxed);
+    if (cancel != nullptr && cancel->load(memory_order_relaxed)) {
+        stopped.store(true, memory_order_relaxed);
+    }
+    if (deadline != Clock::time_point::max() || progress) {
+        check();
+    }
+}
+
+void Control::check() {
+    Clock::time_point now = Clock::now();
+    if (now >= deadline) {
+        stopped.store(true, memory_order_relaxed);
+    }
+    if (!progress) return;
+    long long elapsed = chrono::duration_cast<chrono::nanoseconds>(now - startTime).count();
+    long long next = nextReport.load(memory_order_relaxed);
+    if (elapsed < next) return;
+    // A callback slower than the interval is still running when the next report is due: skip it
+    if (reporting.exchange(true, memory_order_acquire)) return;
+    // The thread that moves the next report time forward is the one that reports
+    if (nextReport.compare_exchange_strong(next, elapsed + (long long) (interval * 1e9))) {
+        try {
+            progress(getReport());
+        } catch (...) {
+            error = current_exception(); // guarded by reporting
+            stopped.store(true, memory_order_relaxed);
+        }
+    }
+    reporting.store(false, memory_order_release);
+}
+
+/**
+ * @return fraction of the work done, 1 if there was none
+ */
+double Control::getFraction() const {
+    return total > 0 ? min(1.0, (double) done.load() / (double) total) : 1;
+}
+
+ControlReport Control::getReport() const {
+    ControlReport report;
+    report.done = done.load();
+    report.total = total;
+    report.fraction = getFraction();
+    report.elapsed = chrono::duration<double>(Clock::now() - startTime).count();
+    report.rate = report.elapsed > 0 ? (double) report.done / report.elapsed : 0;
+    report.eta = report.rate > 0 ? (double) (total - report.done) / report.rate : 0;
+    return report;
+}
+
+/**
+ * Called after the kernel: throw the exception of the progress callback, if it threw one
+ */
+void Control::rethrowError() const {
+    if (error) rethrow_exception(error);
+}
@@ -0,0 +1,67 @@
+#ifndef LEARNING_MASSIVE_DATA_CONTROL_H
+#define LEARNING_MASSIVE_DATA_CONTROL_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <exception>
+
+#define CONTROL_BLOCK 64 //nodes a kernel counts between two checks, the chunk of its dynamic schedule
+
+/**
+ * Progress of a kernel, in its units of work: edges of the DAG for the CSR backend, nodes for the compressed and
+ * Roaring ones, pairs of nodes for the matrix kernels, edges for better
+ */
+struct ControlReport {
+    long long done = 0;
+    long long total = 0;
+    double fraction = 0;
+    double elapsed = 0;   // seconds since the start
+    double rate = 0;      // units per second
+    double eta = 0;       // seconds left at this rate
+};
+
+/**
+ * Cooperative cancellation, deadline and progress of a long count. The kernel counts in blocks of CONTROL_BLOCK
+ * nodes: before a block it skips it if isStopped(), after it it calls advance() with the work of the block.
+ * A stopped kernel returns the count of the blocks it finished and getFraction() tells how much of the work
+ * they are. The cancel flag is polled with a relaxed load, the clock is read only with a deadline or a progress
+ * callback, and the callback is called by one counting thread at a time, never concurrently, at most every
+ * interval seconds: a report that comes due while the previous one is running is skipped. An exception thrown by
+ * the callback stops the count and is kept, rethrowError() throws it after the parallel region.
+ */
+class Control {
+    public:
+    using Clock = std::chrono::steady_clock;
+
+    void setCancel(const std::atomic<bool>* flag) { cancel = flag; }
+    void setDeadline(Clock::time_point time) { deadline = time; }
+    void setProgress(const std::function<void(const ControlReport&)>& callback, double interval);
+
+    void start(long long total);
+    bool isStopped() const { return stopped.load(std::memory_order_relaxed); }
+    void advance(long long work);
+
+    bool isComplete() const { return !isStopped() || done.load() >= total; }
+    double getFraction() const;
+    ControlReport getReport() const;
+    void rethrowError() const;
+
+    private:
+    void check();
+
+    const std::atomic<bool>* cancel = nullptr;
+    Clock::time_point deadline = Clock::time_point::max();
+    std::function<void(const ControlReport&)> progress;
+    double interval = 1;
+
+    long long total = 0;
+    Clock::time_point startTime;
+    std::atomic<bool> stopped {false};
+    std::atomic<long long> done {0};
+    std::atomic<long long> nextReport {0}; // ns since the start
+    std::atomic<bool> reporting {false};   // a thread is calling progress
+    std::exception_ptr error;              // thrown by progress
+};
+
+#endif
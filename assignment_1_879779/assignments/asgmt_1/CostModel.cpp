@@ -0,0 +1,244 @@
+#include "CostModel.h"
+#include "Memory.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <map>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+#define THREAD_OVERHEAD_NS 20000 //cost of waking up one more thread of the team
+
+CostModel::CostModel() {
+    coefficients = {{"node", 2.4}, {"edge_matrix", 2.1}, {"fast", 1.7}, {"better", 1.8}, {"precompute", 2.1},
+                    {"forward_merge", 5.2}, {"forward_adaptive", 4.2}, {"forward_roaring", 2.2}};
+    efficiency = 0.8;
+}
+
+/**
+ * Size, density, degrees, wedges and the work of the forward algorithm, which is computed from the out-degrees
+ * of the degree-ordered DAG without building it
+ * @param graph undirected graph
+ * @return
+ */
+GraphStats CostModel::getStats(const CSR& graph) {
+    GraphStats stats;
+    long long n = graph.nNodes;
+    stats.nNodes = n;
+    stats.nEdges = (long long) graph.neighbors.size() / 2;
+    stats.density = n > 1 ? 2.0 * (double) stats.nEdges / ((double) n * (double) (n - 1)) : 0;
+    stats.avgDegree = n > 0 ? 2.0 * (double) stats.nEdges / (double) n : 0;
+
+    auto lower = [&graph](int u, int v) {
+        return graph.degree(u) < graph.degree(v) || (graph.degree(u) == graph.degree(v) && u < v);
+    };
+    vector<long long> outDegree(n, 0);
+    for (int u = 0; u < n; u++) {
+        long long d = graph.degree(u);
+        stats.maxDegree = max(stats.maxDegree, d);
+        stats.wedges += d * (d - 1) / 2;
+        for (long long i = graph.offsets[u]; i < graph.offsets[u + 1]; i++) {
+            if (lower(u, graph.neighbors[i])) outDegree[u]++;
+        }
+    }
+    stats.degreeSkew = stats.avgDegree > 0 ? (double) stats.maxDegree / stats.avgDegree : 0;
+
+    // One intersection of N+(u) and N+(v) for each edge u->v of the DAG
+    for (int u = 0; u < n; u++) {
+        for (long long i = graph.offsets[u]; i < graph.offsets[u + 1]; i++) {
+            int v = graph.neighbors[i];
+            if (!lower(u, v)) continue;
+            double shorter = (double) min(outDegree[u], outDegree[v]), longer = (double) max(outDegree[u], outDegree[v]);
+            stats.mergeWork += shorter + longer;
+            stats.adaptiveWork += shorter == 0 ? 1 : longer < GALLOP_RATIO * shorter ? shorter + longer : shorter * (1 + log2(longer / shorter));
+            stats.probeWork += (double) outDegree[v] + 1;
+        }
+    }
+    return stats;
+}
+
+string CostModel::getKey(const string& algorithm, const string& backend, IntersectionKernel kernel) {
+    if (backend == "csr") return kernel == INTERSECT_MERGE ? "forward_merge" : "forward_adaptive";
+    if (backend == "roaring") return "forward_roaring";
+    if (algorithm == "edge") return "edge_matrix";
+    return algorithm;
+}
+
+/**
+ * Units of work of one timed run of an algorithm, the precomputation of fast excluded
+ * @return 0 for the algorithms the model does not cover
+ */
+double CostModel::getWork(const string& algorithm, const string& backend, IntersectionKernel kernel, const GraphStats& stats) {
+    double n = (double) stats.nNodes, m = (double) stats.nEdges;
+    if (backend == "csr" && algorithm == "edge") return kernel == INTERSECT_MERGE ? stats.mergeWork : stats.adaptiveWork;
+    if (backend == "roaring" && algorithm == "edge") return stats.probeWork;
+    if (backend != "matrix") return 0;
+    if (algorithm == "node") return n * n / 2 + m * n / 2;   // pairs scanned, then the third node of each edge
+    if (algorithm == "edge") return n * n / 2 + m * n;       // pairs scanned, then a row intersection of each edge
+    if (algorithm == "better") return m * n;                 // a row intersection of each edge
+    if (algorithm == "fast") return n * n / 2;               // pairs scanned
+    return 0;
+}
+
+/**
+ * Predicted seconds of one run with nThreads, including the precomputation of fast
+ */
+double CostModel::predict(const string& algorithm, const string& backend, IntersectionKernel kernel, const GraphStats& stats, int nThreads) const {
+    double ns = coefficients.at(getKey(algorithm, backend, kernel)) * getWork(algorithm, backend, kernel, stats);
+    if (algorithm == "better") nThreads = 1; // sequential only
+    ns = ns / (1 + (nThreads - 1) * efficiency) + (nThreads - 1) * THREAD_OVERHEAD_NS;
+    if (algorithm == "fast") {
+        double n = (double) stats.nNodes;
+        ns += coefficients.at("precompute") * n * n * n / 2;
+    }
+    return ns / 1e9;
+}
+
+/**
+ * Pick the representation, algorithm, intersection kernel and thread count with the lowest predicted time
+ * among those whose footprint fits in the memory budget
+ * @param stats
+ * @param memoryBudget bytes, 0 not checked
+ * @param maxThreads
+ * @param chooseThreads pick the best count up to maxThreads, otherwise run with maxThreads
+ * @return
+ */
+Selection CostModel::select(const GraphStats& stats, long long memoryBudget, int maxThreads, bool chooseThreads) const {
+    vector<Selection> candidates = {{"node", "matrix"}, {"edge", "matrix"}, {"fast", "matrix"}, {"better", "matrix"},
+                                    {"edge", "csr", INTERSECT_MERGE}, {"edge", "csr", INTERSECT_ADAPTIVE}, {"edge", "roaring"}};
+    Selection best;
+    best.predictedSeconds = -1;
+    for (Selection& candidate: candidates) {
+        long long footprint = Memory::estimateFootprint(candidate.algorithm, candidate.backend, stats.nNodes, stats.nEdges, 0, 0);
+        if (memoryBudget > 0 && footprint > memoryBudget) continue;
+
+        int first = chooseThreads ? 1 : maxThreads;
+        int last = candidate.algorithm == "better" ? 1 : maxThreads;
+        for (int p = min(first, last); p <= last; p++) {
+            double seconds = predict(candidate.algorithm, candidate.backend, candidate.kernel, stats, p);
+            // Fewer threads unless more are at least 5% faster
+            if (p == min(first, last) || seconds < 0.95 * candidate.predictedSeconds) {
+                candidate.nThreads = p;
+                candidate.predictedSeconds = seconds;
+            }
+        }
+        if (best.predictedSeconds < 0 || candidate.predictedSeconds < best.predictedSeconds) best = candidate;
+    }
+    if (best.predictedSeconds < 0) {
+        throw runtime_error("no in-memory algorithm fits in the memory budget of " + Memory::format(memoryBudget));
+    }
+    return best;
+}
+
+/**
+ * Read the "name value" lines of a file written by save, '#' starts a comment
+ * @param path
+ */
+void CostModel::load(const string& path) {
+    ifstream in(path);
+    if (!in.is_open()) {
+        throw runtime_error("unable to open " + path);
+    }
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        stringstream fields(line);
+        string name;
+        double value;
+        if (!(fields >> name >> value)) {
+            throw runtime_error("invalid line in " + path + ": " + line);
+        }
+        if (name == "efficiency") efficiency = value;
+        else if (coefficients.count(name)) coefficients[name] = value;
+        else throw runtime_error("unknown coefficient " + name + " in " + path);
+    }
+}
+
+void CostModel::save(const string& path) const {
+    ofstream out(path, ios::trunc);
+    if (!out.is_open()) {
+        throw runtime_error("unable to open " + path);
+    }
+    out << "# ns per unit of work of each algorithm, see CostModel\n" << setprecision(6);
+    for (const auto& [name, value]: coefficients) {
+        out << name << " " << value << "\n";
+    }
+    out << "efficiency " << efficiency << endl;
+}
+
+/**
+ * Value of a "key": "value" string of a results file
+ */
+static string getJsonString(const string& json, const string& key) {
+    size_t start = json.find("\"" + key + "\": \"");
+    if (start == string::npos) return "";
+    start += key.size() + 5;
+    return json.substr(start, json.find('"', start) - start);
+}
+
+/**
+ * Value of the first "key": number after position from, NAN if missing
+ */
+static double getJsonNumber(const string& json, const string& key, size_t from) {
+    size_t start = json.find("\"" + key + "\": ", from);
+    return start == string::npos ? NAN : strtod(json.c_str() + start + key.size() + 4, nullptr);
+}
+
+/**
+ * Fit the coefficients to results saved by the driver (results_*.json): the median of the 1-thread runs divided
+ * by the work of the graph gives a coefficient (geometric mean over the files), the speedups of the other thread
+ * counts give the parallel efficiency (mean). Coefficients without results keep their value.
+ * @param resultPaths
+ * @return No. of results used
+ */
+int CostModel::calibrate(const vector<string>& resultPaths) {
+    map<string, pair<double, int>> logSums;  // sum of log coefficients, no. of samples
+    double efficiencySum = 0;
+    int nEfficiencies = 0, nUsed = 0;
+
+    for (const string& path: resultPaths) {
+        ifstream in(path);
+        stringstream buffer;
+        buffer << in.rdbuf();
+        string json = buffer.str();
+
+        string algorithm = getJsonString(json, "algorithm"), backend = getJsonString(json, "backend");
+        IntersectionKernel kernel = getJsonString(json, "kernel") == "adaptive" ? INTERSECT_ADAPTIVE : INTERSECT_MERGE;
+        double work = atof(getJsonString(json, "work").c_str());
+        if (!(work > 0) || !coefficients.count(getKey(algorithm, backend, kernel))) continue;
+
+        bool used = false;
+        for (size_t at = json.find("{\"threads\": "); at != string::npos; at = json.find("{\"threads\": ", at + 1)) {
+            double threads = getJsonNumber(json, "threads", at), median = getJsonNumber(json, "median", at);
+            double speedup = getJsonNumber(json, "speedup", at);
+            if (threads == 1 && median > 0) {
+                auto& [sum, count] = logSums[getKey(algorithm, backend, kernel)];
+                sum += log(median / work);
+                count++;
+                used = true;
+            } else if (threads > 1 && speedup > 0 && algorithm != "better") {
+                efficiencySum += (speedup - 1) / (threads - 1);
+                nEfficiencies++;
+                used = true;
+            }
+        }
+        nUsed += used;
+    }
+
+    for (const auto& [key, sample]: logSums) {
+        coefficients[key] = exp(sample.first / sample.second);
+    }
+    if (logSums.count("edge_matrix")) {
+        coefficients["precompute"] = coefficients["edge_matrix"]; // same bit tests, not timed by the driver
+    }
+    if (nEfficiencies > 0) {
+        efficiency = min(1.0, max(0.05, efficiencySum / nEfficiencies));
+    }
+    return nUsed;
+}
@@ -0,0 +1,65 @@
+#ifndef LEARNING_MASSIVE_DATA_COST_MODEL_H
+#define LEARNING_MASSIVE_DATA_COST_MODEL_H
+
+#include "Graph_csr.h"
+
+#include <vector>
+#include <string>
+#include <map>
+
+/**
+ * Statistics of an undirected graph computed in O(n + m) from its CSR
+ */
+struct GraphStats {
+    long long nNodes = 0;
+    long long nEdges = 0;
+    double density = 0;
+    long long maxDegree = 0;
+    double avgDegree = 0;
+    double degreeSkew = 0;       // max degree / average degree
+    long long wedges = 0;        // paths of length 2, sum of d(d-1)/2
+    double mergeWork = 0;        // elements scanned by the forward algorithm with the merge intersection
+    double adaptiveWork = 0;     // same with the adaptive intersection
+    double probeWork = 0;        // bits set and tested by the forward algorithm on the Roaring rows
+};
+
+/**
+ * Algorithm picked by the selector and its predicted cost
+ */
+struct Selection {
+    std::string algorithm;
+    std::string backend;
+    IntersectionKernel kernel = INTERSECT_MERGE;
+    int nThreads = 1;
+    double predictedSeconds = 0;
+};
+
+/**
+ * Predicted running time of each triangle counting algorithm: coefficient (ns per unit of work) times the work
+ * on the graph, where the unit depends on the algorithm (bit tests for the matrix ones, list elements for the
+ * forward one), and a parallel efficiency e so that p threads take T1 / (1 + (p - 1) e).
+ * The default coefficients are placeholders that only rank the algorithms roughly, --calibrate replaces them with
+ * a fit of calibrate() to the saved benchmark results of the host.
+ */
+class CostModel {
+    public:
+    CostModel();
+
+    static GraphStats getStats(const CSR& graph);
+    static double getWork(const std::string& algorithm, const std::string& backend, IntersectionKernel kernel, const GraphStats& stats);
+
+    double predict(const std::string& algorithm, const std::string& backend, IntersectionKernel kernel, const GraphStats& stats, int nThreads) const;
+    Selection select(const GraphStats& stats, long long memoryBudget, int maxThreads, bool chooseThreads) const;
+
+    void load(const std::string& path);
+    void save(const std::string& path) const;
+    int calibrate(const std::vector<std::string>& resultPaths);
+
+    private:
+    static std::string getKey(const std::string& algorithm, const std::string& backend, IntersectionKernel kernel);
+
+    std::map<std::string, double> coefficients;  // ns per unit of work, by getKey
+    double efficiency;
+};
+
+#endif
@@ -0,0 +1,420 @@
+#include "Decompress.h"
+#include "Trace.h"
+
+#include <queue>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <string>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <stdexcept>
+#include <condition_variable>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace std;
+
+/**
+ * Source of the decompressed bytes of a file
+ */
+class Inflater {
+    public:
+    explicit Inflater(const string& path) : path(path), file(fopen(path.c_str(), "rb")), input(DECOMPRESS_INPUT) {
+        if (file == nullptr) {
+            throw runtime_error("unable to open " + path);
+        }
+    }
+    virtual ~Inflater() { fclose(file); }
+
+    /**
+     * @return bytes written to out, less than capacity only at the end of the file
+     */
+    virtual size_t read(char* out, size_t capacity) = 0;
+
+    /**
+     * Compressed bytes decompressed so far
+     */
+    long long getConsumed() const { return consumed - (long long) getBuffered(); }
+
+    protected:
+    size_t fill() {
+        size_t n = fread(input.data(), 1, input.size(), file);
+        consumed += (long long) n;
+        return n;
+    }
+    virtual size_t getBuffered() const { return 0; }
+
+    string path;
+    FILE* file;
+    vector<unsigned char> input;
+    long long consumed = 0;
+};
+
+class PlainInflater : public Inflater {
+    public:
+    using Inflater::Inflater;
+
+    size_t read(char* out, size_t capacity) override {
+        size_t n = fread(out, 1, capacity, file);
+        consumed += (long long) n;
+        return n;
+    }
+};
+
+#ifdef HAVE_ZLIB
+class GzipInflater : public Inflater {
+    public:
+    explicit GzipInflater(const string& path) : Inflater(path) {
+        if (inflateInit2(&stream, 15 + 32) != Z_OK) { // gzip or zlib header
+            throw runtime_error("zlib: unable to start inflating " + path);
+        }
+    }
+    ~GzipInflater() override { inflateEnd(&stream); }
+
+    size_t read(char* out, size_t capacity) override {
+        stream.next_out = (Bytef*) out;
+        stream.avail_out = (uInt) capacity;
+        while (stream.avail_out > 0) {
+            if (stream.avail_in == 0) {
+                size_t n = fill();
+                if (n == 0) {
+                    if (!ended) throw runtime_error(path + " is truncated");
+                    break;
+                }
+                stream.next_in = input.data();
+                stream.avail_in = (uInt) n;
+            }
+            if (ended) { // another member follows
+                inflateReset(&stream);
+                ended = false;
+            }
+            int status = inflate(&stream, Z_NO_FLUSH);
+            if (status == Z_STREAM_END) {
+                ended = true;
+            } else if (status != Z_OK) {
+                throw runtime_error(path + ": corrupt gzip data" + (stream.msg != nullptr ? string(", ") + stream.msg : ""));
+            }
+        }
+        return capacity - stream.avail_out;
+    }
+
+    protected:
+    size_t getBuffered() const override { return stream.avail_in; }
+
+    private:
+    z_stream stream {};
+    bool ended = false; // at the end of a member
+};
+#endif
+
+#ifdef HAVE_ZSTD
+class ZstdInflater : public Inflater {
+    public:
+    explicit ZstdInflater(const string& path) : Inflater(path), stream(ZSTD_createDStream()) {
+        if (stream == nullptr) {
+            throw runtime_error("zstd: unable to start decompressing " + path);
+        }
+        ZSTD_initDStream(stream);
+    }
+    ~ZstdInflater() override { ZSTD_freeDStream(stream); }
+
+    size_t read(char* out, size_t capacity) override {
+        ZSTD_outBuffer output {out, capacity, 0};
+        while (output.pos < output.size) {
+            if (in.pos == in.size) {
+                size_t n = fill();
+                if (n == 0) {
+                    if (remaining != 0) throw runtime_error(path + " is truncated");
+                    break;
+                }
+                in = {input.data(), n, 0};
+            }
+            remaining = ZSTD_decompressStream(stream, &output, &in);
+            if (ZSTD_isError(remaining)) {
+                throw runtime_error(path + ": corrupt zstd data, " + ZSTD_getErrorName(remaining));
+            }
+        }
+        return output.pos;
+    }
+
+    protected:
+    size_t getBuffered() const override { return in.size - in.pos; }
+
+    private:
+    ZSTD_DStream* stream;
+    ZSTD_inBuffer in {nullptr, 0, 0};
+    size_t remaining = 0; // 0 at the end of a frame
+};
+#endif
+
+static unique_ptr<Inflater> openInflater(const string& path) {
+    Compression compression = Decompress::detect(path);
+    if (!Decompress::isSupported(compression)) {
+        throw runtime_error(path + " is " + Decompress::getName(compression) + " compressed, this build has no "
+                            + (compression == COMPRESSION_GZIP ? "zlib" : "libzstd"));
+    }
+    switch (compression) {
+#ifdef HAVE_ZLIB
+        case COMPRESSION_GZIP: return make_unique<GzipInflater>(path);
+#endif
+#ifdef HAVE_ZSTD
+        case COMPRESSION_ZSTD: return make_unique<ZstdInflater>(path);
+#endif
+        default: return make_unique<PlainInflater>(path);
+    }
+}
+
+/**
+ * Chunk buffers shared by the decompressing thread and the parsers, as in prod-cons-condition.cpp: the producer
+ * takes a free buffer, fills it and queues it, a parser takes a full buffer, parses it and gives it back
+ */
+class ChunkRing {
+    public:
+    explicit ChunkRing(int nSlots) : buffers(nSlots) {
+        for (int i = 0; i < nSlots; i++) free.push(i);
+    }
+
+    /**
+     * @return a free slot, -1 once closed
+     */
+    int acquire() {
+        unique_lock<mutex> guard(lock);
+        while (free.empty() && !closed) freeCv.wait(guard);
+        if (closed) return -1;
+        int slot = free.front();
+        free.pop();
+        return slot;
+    }
+
+    void publish(long long sequence, int slot) {
+        lock_guard<mutex> guard(lock);
+        full.push({sequence, slot});
+        fullCv.notify_one();
+    }
+
+    /**
+     * @return false once closed and every full slot has been taken
+     */
+    bool take(long long& sequence, int& slot) {
+        unique_lock<mutex> guard(lock);
+        while (full.empty() && !closed) fullCv.wait(guard);
+        if (full.empty()) return false;
+        tie(sequence, slot) = full.front();
+        full.pop();
+        return true;
+    }
+
+    void release(int slot) {
+        lock_guard<mutex> guard(lock);
+        free.push(slot);
+        freeCv.notify_one();
+    }
+
+    /**
+     * No more chunks: at the end of the file, or on an error to stop the producer
+     */
+    void close() {
+        lock_guard<mutex> guard(lock);
+        closed = true;
+        freeCv.notify_all();
+        fullCv.notify_all();
+    }
+
+    vector<char>& operator[](int slot) { return buffers[slot]; }
+
+    private:
+    mutex lock;
+    condition_variable freeCv, fullCv;
+    queue<int> free;
+    queue<pair<long long, int>> full;
+    vector<vector<char>> buffers;
+    bool closed = false;
+};
+
+/**
+ * @param path
+ * @return compression of the file from its first bytes
+ */
+Compression Decompress::detect(const string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        throw runtime_error("unable to open " + path);
+    }
+    unsigned char magic[4] = {};
+    size_t n = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+    if (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) return COMPRESSION_GZIP;
+    if (n == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) return COMPRESSION_ZSTD;
+    return COMPRESSION_NONE;
+}
+
+bool Decompress::isSupported(Compression compression) {
+    switch (compression) {
+#ifdef HAVE_ZLIB
+        case COMPRESSION_GZIP: return true;
+#endif
+#ifdef HAVE_ZSTD
+        case COMPRESSION_ZSTD: return true;
+#endif
+        case COMPRESSION_NONE: return true;
+        default: return false;
+    }
+}
+
+string Decompress::getName(Compression compression) {
+    return compression == COMPRESSION_GZIP ? "gzip" : compression == COMPRESSION_ZSTD ? "zstd" : "none";
+}
+
+/**
+ * @return path without its .gz or .zst extension, so that the extension of the content is the last one
+ */
+string Decompress::stripExtension(const string& path) {
+    string extension = filesystem::path(path).extension().string();
+    transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char) tolower(c); });
+    return extension == ".gz" || extension == ".zst" ? path.substr(0, path.size() - extension.size()) : path;
+}
+
+/**
+ * First bytes of the content of a file, decompressed if it is compressed
+ * @param path
+ * @param bytes at most
+ * @param consumed receives the bytes of the file they were decompressed from
+ * @return
+ */
+string Decompress::readHead(const string& path, size_t bytes, long long* consumed) {
+    unique_ptr<Inflater> inflater = openInflater(path);
+    string head(bytes, '\0');
+    head.resize(inflater->read(head.data(), bytes));
+    if (consumed != nullptr) *consumed = inflater->getConsumed();
+    return head;
+}
+
+/**
+ * Edges of the lines in [first, last), as GraphMat::getEdges: '#' lines skipped, lines without two ids ignored.
+ * *last must end a number, e.g. '\n' or '\0'.
+ */
+void Decompress::parseEdges(const char* first, const char* last, vector<pair<int, int>>& edges) {
+    for (const char* line = first; line < last; ) {
+        auto* lineEnd = (const char*) memchr(line, '\n', last - line);
+        if (lineEnd == nullptr) lineEnd = last;
+        if (line < lineEnd && *line != '#') {
+            char* end;
+            long u = strtol(line, &end, 10);
+            char* endV;
+            long v = strtol(end, &endV, 10);
+            if (end != line && endV != end && endV <= lineEnd) edges.emplace_back((int) u, (int) v);
+        }
+        line = lineEnd + 1;
+    }
+}
+
+/**
+ * Edge list of a compressed (or plain) file, decompressed by one thread while nThreads parse it
+ * @param path
+ * @param nThreads parsers
+ * @return one pair for each edge line, in the order of the file
+ */
+vector<pair<int, int>> Decompress::getEdges(const string& path, int nThreads) {
+    TRACE_SCOPE("parse");
+    nThreads = max(1, nThreads);
+    unique_ptr<Inflater> inflater = openInflater(path);
+    ChunkRing ring(DECOMPRESS_SLOTS * nThreads);
+    mutex errorLock;
+    exception_ptr error;
+    auto fail = [&]() {
+        lock_guard<mutex> guard(errorLock);
+        if (!error) error = current_exception();
+        ring.close();
+    };
+
+    // Producer: chunks of at least DECOMPRESS_CHUNK bytes ending with a whole line, the rest carried over
+    thread producer([&]() {
+        TRACE_SCOPE("decompress");
+        try {
+            vector<char> carry;
+            bool end = false;
+            for (long long sequence = 0; !end; sequence++) {
+                int slot = ring.acquire();
+                if (slot < 0) return;
+                vector<char>& text = ring[slot];
+                text.assign(carry.begin(), carry.end());
+                size_t newline = string::npos;
+                while (!end && newline == string::npos) {
+                    size_t before = text.size();
+                    text.resize(before + DECOMPRESS_CHUNK);
+                    size_t n = inflater->read(text.data() + before, DECOMPRESS_CHUNK);
+                    text.resize(before + n);
+                    end = n < DECOMPRESS_CHUNK;
+                    for (size_t i = text.size(); i > before; i--) {
+                        if (text[i - 1] == '\n') {
+                            newline = i - 1;
+                            break;
+                        }
+                    }
+                }
+                size_t cut = end ? text.size() : newline + 1;
+                carry.assign(text.begin() + (long) cut, text.end());
+                text.resize(cut);
+                text.push_back('\0');
+                ring.publish(sequence, slot);
+            }
+            ring.close();
+        } catch (...) {
+            fail();
+        }
+    });
+
+    // Consumers: each parses whole chunks into its own list, tagged with the position of the chunk
+    vector<vector<pair<long long, vector<pair<int, int>>>>> parsed(nThreads);
+    vector<thread> parsers;
+    for (int t = 0; t < nThreads; t++) {
+        parsers.emplace_back([&, t]() {
+            TRACE_SCOPE("parse chunks");
+            try {
+                long long sequence;
+                int slot;
+                while (ring.take(sequence, slot)) {
+                    vector<pair<int, int>> edges;
+                    const vector<char>& text = ring[slot];
+                    parseEdges(text.data(), text.data() + text.size() - 1, edges);
+                    ring.release(slot);
+                    parsed[t].emplace_back(sequence, std::move(edges));
+                }
+            } catch (...) {
+                fail();
+            }
+        });
+    }
+    producer.join();
+    for (thread& parser: parsers) parser.join();
+    if (error) {
+        rethrow_exception(error);
+    }
+
+    vector<pair<long long, vector<pair<int, int>>*>> chunks;
+    size_t nEdges = 0;
+    for (auto& list: parsed) {
+        for (auto& [sequence, edges]: list) {
+            chunks.emplace_back(sequence, &edges);
+            nEdges += edges.size();
+        }
+    }
+    sort(chunks.begin(), chunks.end());
+    vector<pair<int, int>> edges;
+    edges.reserve(nEdges);
+    for (auto& chunk: chunks) {
+        edges.insert(edges.end(), chunk.second->begin(), chunk.second->end());
+        vector<pair<int, int>>().swap(*chunk.second);
+    }
+    return edges;
+}
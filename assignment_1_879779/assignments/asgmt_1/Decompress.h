@@ -0,0 +1,37 @@
+#ifndef LEARNING_MASSIVE_DATA_DECOMPRESS_H
+#define LEARNING_MASSIVE_DATA_DECOMPRESS_H
+
+#include <vector>
+#include <string>
+#include <utility>
+
+#define DECOMPRESS_CHUNK (1 << 20) //bytes of text in a chunk handed to a parser
+#define DECOMPRESS_INPUT (1 << 17) //compressed bytes read from the file at a time
+#define DECOMPRESS_SLOTS 4 //chunks of the ring for each parser, bounds the decompressed text in memory
+
+/**
+ * Compression of a file, recognised from its magic bytes: gzip (1f 8b, .gz, also zlib streams) or zstd
+ * (28 b5 2f fd, .zst). Both allow several concatenated members or frames.
+ */
+enum Compression { COMPRESSION_NONE, COMPRESSION_GZIP, COMPRESSION_ZSTD };
+
+/**
+ * Reads compressed edge lists without writing the text to disk. getEdges is a pipeline modelled on the
+ * producer/consumer of lessons-examples/std-threads/prod-cons-condition.cpp: one thread decompresses into a ring
+ * of chunk buffers cut at line ends, the parser threads take the chunks and parse them, so decompression and
+ * parsing overlap. The buffers are reused, at most DECOMPRESS_SLOTS per parser exist at a time.
+ * gzip needs zlib and zstd needs libzstd at build time (HAVE_ZLIB, HAVE_ZSTD), see isSupported.
+ */
+class Decompress {
+    public:
+    static Compression detect(const std::string& path);
+    static bool isSupported(Compression compression);
+    static std::string getName(Compression compression);
+    static std::string stripExtension(const std::string& path);
+
+    static std::string readHead(const std::string& path, size_t bytes, long long* consumed = nullptr);
+    static std::vector<std::pair<int, int>> getEdges(const std::string& path, int nThreads);
+    static void parseEdges(const char* first, const char* last, std::vector<std::pair<int, int>>& edges);
+};
+
+#endif
@@ -0,0 +1,180 @@
+#include "Graph_clique.h"
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * Write the intersection of two sorted lists of nodes in out
+ * @return No. of nodes written
+ */
+size_t GraphClique::intersectInto(const int* a, const int* aEnd, const int* b, const int* bEnd, int* out) {
+    int* write = out;
+    while (a < aEnd && b < bEnd) {
+        if (*a < *b) {
+            a++;
+        } else if (*b < *a) {
+            b++;
+        } else {
+            *write++ = *a;
+            a++;
+            b++;
+        }
+    }
+    return write - out;
+}
+
+/**
+ * Roots sorted by decreasing out-degree, so that the heaviest ones are scheduled first
+ * and the light ones fill the gaps at the end of the parallel loop
+ */
+vector<int> GraphClique::getRootOrder(const CSR& dag) {
+    vector<int> roots(dag.nNodes);
+    iota(roots.begin(), roots.end(), 0);
+    stable_sort(roots.begin(), roots.end(), [&dag](int a, int b) { return dag.degree(a) > dag.degree(b); });
+    return roots;
+}
+
+/**
+ * Run count(root, buffers) for every root in parallel and sum the results.
+ * Each thread allocates its levels of buffers once, every buffer can hold the longest out-neighbour list.
+ */
+template<typename Count>
+static long long sumOverRoots(const CSR& dag, const vector<int>& roots, int levels, int nThreads, Count count) {
+    long long maxDegree = 0;
+    for (int u = 0; u < dag.nNodes; u++) {
+        maxDegree = max(maxDegree, dag.degree(u));
+    }
+
+    long long total = 0;
+    #pragma omp parallel num_threads(nThreads) reduction(+:total) shared(dag, roots, levels, maxDegree, count) default(none)
+    {
+        vector<vector<int>> storage(max(levels, 1), vector<int>(maxDegree));
+        vector<int*> buffers;
+        for (auto& buffer: storage) buffers.push_back(buffer.data());
+
+        #pragma omp for schedule(dynamic, 1)
+        for (size_t r = 0; r < roots.size(); r++) {
+            total += count(roots[r], buffers.data());
+        }
+    }
+    return total;
+}
+
+/**
+ * Count the (K)-cliques made of K nodes of candidates, which all follow the nodes already chosen.
+ * The candidates of the next level are written in buffers[0], so each level reuses its own buffer.
+ * @tparam K No. of nodes still to choose
+ * @param dag degree-ordered DAG
+ * @param candidates nodes adjacent to all the nodes already chosen
+ * @param nCandidates
+ * @param buffers one buffer for each of the next levels
+ * @return
+ */
+template<int K>
+long long GraphClique::countFrom(const CSR& dag, const int* candidates, size_t nCandidates, int* const* buffers) {
+    const int* adj = dag.neighbors.data();
+    long long count = 0;
+
+    if constexpr (K == 1) {
+        return (long long) nCandidates;
+    } else if constexpr (K == 2) {
+        // Last level: only the size of the intersection is needed, it is never written
+        for (size_t i = 0; i < nCandidates; i++) {
+            int v = candidates[i];
+            count += GraphCSR::getIntersection(candidates, candidates + nCandidates, adj + dag.offsets[v], adj + dag.offsets[v + 1]);
+        }
+    } else {
+        for (size_t i = 0; i < nCandidates; i++) {
+            int v = candidates[i];
+            size_t next = intersectInto(candidates, candidates + nCandidates, adj + dag.offsets[v], adj + dag.offsets[v + 1], buffers[0]);
+            if (next >= K - 1) {
+                count += countFrom<K - 1>(dag, buffers[0], next, buffers + 1);
+            }
+        }
+    }
+    return count;
+}
+
+/**
+ * Same as countFrom<K> with k known only at runtime
+ */
+long long GraphClique::countFrom(const CSR& dag, int k, const int* candidates, size_t nCandidates, int* const* buffers) {
+    const int* adj = dag.neighbors.data();
+    long long count = 0;
+
+    if (k == 1) {
+        return (long long) nCandidates;
+    } else if (k == 2) {
+        for (size_t i = 0; i < nCandidates; i++) {
+            int v = candidates[i];
+            count += GraphCSR::getIntersection(candidates, candidates + nCandidates, adj + dag.offsets[v], adj + dag.offsets[v + 1]);
+        }
+    } else {
+        for (size_t i = 0; i < nCandidates; i++) {
+            int v = candidates[i];
+            size_t next = intersectInto(candidates, candidates + nCandidates, adj + dag.offsets[v], adj + dag.offsets[v + 1], buffers[0]);
+            if (next >= k - 1) {
+                count += countFrom(dag, k - 1, buffers[0], next, buffers + 1);
+            }
+        }
+    }
+    return count;
+}
+
+/**
+ * Count the K-cliques of the graph, K >= 3 known at compile time so that the recursion is unrolled.
+ * Every clique is found once, from its lowest ranked node, by intersecting the out-neighbour lists.
+ * @tparam K
+ * @param dag graph returned by GraphCSR::orientByDegree
+ * @param nThreads
+ * @return No. of K-cliques in graph
+ */
+template<int K>
+long long GraphClique::countCliques_k(const CSR& dag, int nThreads) {
+    static_assert(K >= 3, "use countCliques for k < 3");
+    const int* adj = dag.neighbors.data();
+
+    return sumOverRoots(dag, getRootOrder(dag), K - 3, nThreads, [&dag, adj](int u, int* const* buffers) {
+        return countFrom<K - 1>(dag, adj + dag.offsets[u], (size_t) dag.degree(u), buffers);
+    });
+}
+
+template long long GraphClique::countCliques_k<3>(const CSR& dag, int nThreads);
+template long long GraphClique::countCliques_k<4>(const CSR& dag, int nThreads);
+template long long GraphClique::countCliques_k<5>(const CSR& dag, int nThreads);
+
+/**
+ * Count the k-cliques of the graph, k = 3 is the number of triangles.
+ * k = 3, 4, 5 use the specialised versions, the others the generic recursion.
+ * @param dag graph returned by GraphCSR::orientByDegree
+ * @param k size of the cliques
+ * @param nThreads
+ * @return No. of k-cliques in graph
+ */
+long long GraphClique::countCliques(const CSR& dag, int k, int nThreads) {
+    switch (k) {
+        case 1:
+            return dag.nNodes;
+        case 2:
+            return (long long) dag.neighbors.size();
+        case 3:
+            return countCliques_k<3>(dag, nThreads);
+        case 4:
+            return countCliques_k<4>(dag, nThreads);
+        case 5:
+            return countCliques_k<5>(dag, nThreads);
+        default:
+            if (k < 1) {
+                throw invalid_argument("clique size must be positive");
+            }
+    }
+
+    const int* adj = dag.neighbors.data();
+    return sumOverRoots(dag, getRootOrder(dag), k - 3, nThreads, [&dag, adj, k](int u, int* const* buffers) {
+        return countFrom(dag, k - 1, adj + dag.offsets[u], (size_t) dag.degree(u), buffers);
+    });
+}
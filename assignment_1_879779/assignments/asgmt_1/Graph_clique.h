@@ -0,0 +1,24 @@
+#ifndef LEARNING_MASSIVE_DATA_GRAPH_CLIQUE_H
+#define LEARNING_MASSIVE_DATA_GRAPH_CLIQUE_H
+
+#include "Graph_csr.h"
+
+#include <vector>
+
+class GraphClique {
+    public:
+    static long long countCliques(const CSR& dag, int k, int nThreads);
+
+    template<int K>
+    static long long countCliques_k(const CSR& dag, int nThreads);
+
+    private:
+    template<int K>
+    static long long countFrom(const CSR& dag, const int* candidates, size_t nCandidates, int* const* buffers);
+    static long long countFrom(const CSR& dag, int k, const int* candidates, size_t nCandidates, int* const* buffers);
+
+    static size_t intersectInto(const int* a, const int* aEnd, const int* b, const int* bEnd, int* out);
+    static std::vector<int> getRootOrder(const CSR& dag);
+};
+
+#endif
@@ -0,0 +1,264 @@
+#include "Graph_compressed.h"
+#include "Trace.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+static int getByteLength(uint32_t value) {
+    return value < (1u << 8) ? 1 : value < (1u << 16) ? 2 : value < (1u << 24) ? 3 : 4;
+}
+
+static int getVarintLength(uint32_t value) {
+    int length = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        length++;
+    }
+    return length;
+}
+
+/**
+ * Rank of each node in the order of degree, ties broken by id: the order of GraphCSR::orientByDegree
+ */
+vector<int> GraphCompressed::getRanks(const CSR& graph) {
+    vector<int> order(graph.nNodes);
+    for (int u = 0; u < graph.nNodes; u++) order[u] = u;
+    stable_sort(order.begin(), order.end(), [&graph](int u, int v) { return graph.degree(u) < graph.degree(v); });
+    vector<int> rank(graph.nNodes);
+    for (int r = 0; r < graph.nNodes; r++) rank[order[r]] = r;
+    return rank;
+}
+
+/**
+ * Bytes of the encoding of a sorted row of ranks greater than u
+ */
+size_t GraphCompressed::getRowBytes(const int* row, size_t size, int u) {
+    size_t bytes = getVarintLength((uint32_t) size) + (size + 3) / 4; // degree, control
+    int previous = u;
+    for (size_t i = 0; i < size; i++) {
+        bytes += getByteLength((uint32_t) (row[i] - previous - 1));
+        previous = row[i];
+    }
+    return bytes;
+}
+
+void GraphCompressed::encodeRow(const int* row, size_t size, int u, uint8_t* out) {
+    for (uint32_t degree = (uint32_t) size; ; degree >>= 7) {
+        *out++ = (uint8_t) ((degree & 0x7f) | (degree >= 0x80 ? 0x80 : 0));
+        if (degree < 0x80) break;
+    }
+    int previous = u;
+    for (size_t start = 0; start < size; start += COMPRESSED_BLOCK) {
+        size_t count = min(size - start, (size_t) COMPRESSED_BLOCK);
+        uint8_t* control = out;
+        uint8_t* values = out + (count + 3) / 4;
+        memset(control, 0, (count + 3) / 4);
+        for (size_t i = 0; i < count; i++) {
+            uint32_t gap = (uint32_t) (row[start + i] - previous - 1);
+            int length = getByteLength(gap);
+            control[i / 4] |= (uint8_t) ((length - 1) << (2 * (i % 4)));
+            for (int b = 0; b < length; b++) *values++ = (uint8_t) (gap >> (8 * b));
+            previous = row[start + i];
+        }
+        out = values;
+    }
+}
+
+const uint8_t* GraphCompressed::readDegree(const uint8_t* in, uint32_t& degree) {
+    degree = 0;
+    for (int shift = 0; ; shift += 7) {
+        uint8_t byte = *in++;
+        degree |= (uint32_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return in;
+    }
+}
+
+uint32_t GraphCompressed::getDegree(const CompressedCSR& dag, int u) {
+    uint32_t degree;
+    readDegree(dag.data.data() + dag.offsets[u], degree);
+    return degree;
+}
+
+/**
+ * Decode count values of a block into out
+ * @param in start of the block
+ * @param count
+ * @param previous last value decoded, updated
+ * @param out
+ * @return start of the next block
+ */
+const uint8_t* GraphCompressed::decodeBlock(const uint8_t* in, int count, int& previous, int* out) {
+    const uint8_t* control = in;
+    const uint8_t* values = in + (count + 3) / 4;
+    int value = previous;
+    for (int i = 0; i < count; i++) {
+        int length = ((control[i / 4] >> (2 * (i % 4))) & 3) + 1;
+        uint32_t gap;
+        memcpy(&gap, values, sizeof(gap)); // the padding makes the 4-byte load safe at the end
+        gap &= length == 4 ? 0xffffffffu : (1u << (8 * length)) - 1;
+        values += length;
+        value += (int) gap + 1;
+        out[i] = value;
+    }
+    previous = value;
+    return values;
+}
+
+/**
+ * Relabel the nodes by degree, orient the edges from lower to higher rank and compress the rows, in two parallel
+ * passes: the size of every row, then the encoding at its offset
+ * @param graph undirected graph
+ * @param nThreads
+ * @return
+ */
+CompressedCSR GraphCompressed::compress(const CSR& graph, int nThreads) {
+    TRACE_SCOPE("compress");
+    int n = graph.nNodes;
+    vector<int> rank = getRanks(graph);
+    vector<int> node(n);
+    for (int u = 0; u < n; u++) node[rank[u]] = u;
+
+    CompressedCSR dag;
+    dag.nNodes = n;
+    dag.offsets.assign(n + 1, 0);
+
+    // Rows in the new labels, built per thread in a reused buffer
+    auto getRow = [&graph, &rank, &node](int r, vector<int>& row) {
+        int u = node[r];
+        row.clear();
+        for (long long i = graph.offsets[u]; i < graph.offsets[u + 1]; i++) {
+            int s = rank[graph.neighbors[i]];
+            if (s > r) row.push_back(s);
+        }
+        sort(row.begin(), row.end());
+    };
+
+    long long nNeighbors = 0;
+    #pragma omp parallel num_threads(nThreads) reduction(+:nNeighbors) shared(dag, getRow, n) default(none)
+    {
+        vector<int> row;
+        #pragma omp for schedule(dynamic, 1024)
+        for (int r = 0; r < n; r++) {
+            getRow(r, row);
+            nNeighbors += (long long) row.size();
+            dag.offsets[r + 1] = getRowBytes(row.data(), row.size(), r);
+        }
+    }
+    dag.nNeighbors = nNeighbors;
+    for (int r = 0; r < n; r++) {
+        dag.offsets[r + 1] += dag.offsets[r];
+    }
+    dag.data.assign(dag.offsets[n] + 3, 0);
+
+    #pragma omp parallel num_threads(nThreads) shared(dag, getRow, n) default(none)
+    {
+        vector<int> row;
+        #pragma omp for schedule(dynamic, 1024)
+        for (int r = 0; r < n; r++) {
+            getRow(r, row);
+            encodeRow(row.data(), row.size(), r, dag.data.data() + dag.offsets[r]);
+        }
+    }
+    return dag;
+}
+
+void GraphCompressed::decodeRow(const CompressedCSR& dag, int u, vector<int>& row) {
+    uint32_t degree;
+    const uint8_t* in = readDegree(dag.data.data() + dag.offsets[u], degree);
+    row.resize(degree);
+    int previous = u;
+    for (size_t start = 0; start < row.size(); start += COMPRESSED_BLOCK) {
+        in = decodeBlock(in, (int) min(row.size() - start, (size_t) COMPRESSED_BLOCK), previous, row.data() + start);
+    }
+}
+
+/**
+ * Decode every row, to measure the decode throughput
+ * @return sum of the decoded values, so the decoding is not optimised away
+ */
+long long GraphCompressed::decodeAll(const CompressedCSR& dag, int nThreads) {
+    long long sum = 0;
+    #pragma omp parallel num_threads(nThreads) reduction(+:sum) shared(dag) default(none)
+    {
+        int block[COMPRESSED_BLOCK];
+        #pragma omp for schedule(dynamic, 1024)
+        for (int u = 0; u < dag.nNodes; u++) {
+            uint32_t degree;
+            const uint8_t* in = readDegree(dag.data.data() + dag.offsets[u], degree);
+            int previous = u;
+            for (uint32_t start = 0; start < degree; start += COMPRESSED_BLOCK) {
+                int count = (int) min(degree - start, (uint32_t) COMPRESSED_BLOCK);
+                in = decodeBlock(in, count, previous, block);
+                for (int i = 0; i < count; i++) sum += block[i];
+            }
+        }
+    }
+    return sum;
+}
+
+/**
+ * Size of the intersection of a decoded row with the row of v, which is decoded and merged one block at a time
+ * and only until a is exhausted
+ */
+long long GraphCompressed::intersect(const int* a, const int* aEnd, const CompressedCSR& dag, int v) {
+    int block[COMPRESSED_BLOCK];
+    uint32_t degree;
+    const uint8_t* in = readDegree(dag.data.data() + dag.offsets[v], degree);
+    int previous = v;
+    long long count = 0;
+    for (uint32_t start = 0; start < degree && a < aEnd; start += COMPRESSED_BLOCK) {
+        int size = (int) min(degree - start, (uint32_t) COMPRESSED_BLOCK);
+        in = decodeBlock(in, size, previous, block);
+        const int* b = block;
+        const int* bEnd = block + size;
+        while (a < aEnd && b < bEnd) {
+            if (*a < *b) {
+                a++;
+            } else if (*b < *a) {
+                b++;
+            } else {
+                count++;
+                a++;
+                b++;
+            }
+        }
+    }
+    return count;
+}
+
+/**
+ * Forward algorithm on the compressed DAG: the row of u is decoded once into a buffer of the thread, the row of
+ * each out-neighbour v is decoded block by block while it is intersected with it
+ * @param dag
+ * @param nThreads
+ * @param control cancellation, deadline and progress in nodes, may be null
+ * @return No. of triangles in graph, of the blocks of nodes counted before a stop
+ */
+long long GraphCompressed::countTriangles_forward(const CompressedCSR& dag, int nThreads, Control* control) {
+    long long count = 0;
+    int nBlocks = (dag.nNodes + CONTROL_BLOCK - 1) / CONTROL_BLOCK;
+    if (control) control->start(dag.nNodes);
+
+    #pragma omp parallel num_threads(nThreads) reduction(+:count) shared(dag, control, nBlocks) default(none)
+    {
+        TRACE_SCOPE("count thread");
+        vector<int> row;
+        #pragma omp for schedule(dynamic)
+        for (int block = 0; block < nBlocks; block++) {
+            if (control && control->isStopped()) continue;
+            int first = block * CONTROL_BLOCK, last = min(dag.nNodes, first + CONTROL_BLOCK);
+            for (int u = first; u < last; u++) {
+                decodeRow(dag, u, row);
+                for (size_t i = 0; i + 1 < row.size(); i++) {
+                    // only the neighbours after v in the row of u can be in the row of v
+                    count += intersect(row.data() + i + 1, row.data() + row.size(), dag, row[i]);
+                }
+            }
+            if (control) control->advance(last - first);
+        }
+    }
+    return count;
+}
@@ -0,0 +1,43 @@
+#ifndef LEARNING_MASSIVE_DATA_GRAPH_COMPRESSED_H
+#define LEARNING_MASSIVE_DATA_GRAPH_COMPRESSED_H
+
+#include "Graph_csr.h"
+
+#include <vector>
+#include <cstdint>
+
+#define COMPRESSED_BLOCK 64 //values per block of a compressed row, decoded at once
+
+/**
+ * Degree-ordered DAG with compressed rows. Nodes are relabelled by degree (rank 0 has the lowest degree) and each
+ * node keeps its neighbours of higher rank, so the row of u is sorted and starts after u.
+ * A row is stored as its degree (LEB128 varint), then the gaps between consecutive neighbours (the first one from
+ * u) minus one, in blocks of COMPRESSED_BLOCK values laid out like StreamVByte: the 2-bit byte lengths of the
+ * block, 4 per control byte, then the little-endian bytes of the values.
+ */
+struct CompressedCSR {
+    int nNodes = 0;
+    ArenaVector<uint64_t> offsets;   // byte of data where the row of each node starts, nNodes + 1
+    ArenaVector<uint8_t> data;       // rows, followed by 3 bytes of padding for the 4-byte loads of the decoder
+    long long nNeighbors = 0;
+};
+
+class GraphCompressed {
+    public:
+    static CompressedCSR compress(const CSR& graph, int nThreads);
+    static uint32_t getDegree(const CompressedCSR& dag, int u);
+    static void decodeRow(const CompressedCSR& dag, int u, std::vector<int>& row);
+    static long long decodeAll(const CompressedCSR& dag, int nThreads);
+
+    static long long countTriangles_forward(const CompressedCSR& dag, int nThreads, Control* control = nullptr);
+
+    private:
+    static std::vector<int> getRanks(const CSR& graph);
+    static size_t getRowBytes(const int* row, size_t size, int u);
+    static void encodeRow(const int* row, size_t size, int u, uint8_t* out);
+    static const uint8_t* readDegree(const uint8_t* in, uint32_t& degree);
+    static const uint8_t* decodeBlock(const uint8_t* in, int count, int& previous, int* out);
+    static long long intersect(const int* a, const int* aEnd, const CompressedCSR& dag, int v);
+};
+
+#endif
@@ -0,0 +1,566 @@
+#include "Graph_csr.h"
+#include "Trace.h"
+
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+#include <functional>
+#include <climits>
+#include <omp.h>
+
+using namespace std;
+
+#define SNAPSHOT_MAGIC "TRICSR01" //first 8 bytes of a snapshot file
+
+/**
+ * Exclusive prefix sum of values[0 .. n) in place, with one block of values for each thread: the blocks are summed,
+ * their totals scanned, then each block is scanned again starting from the total of the blocks before it
+ * @return sum of all the values
+ */
+static long long prefixSum(long long* values, long long n, int nThreads) {
+    vector<long long> totals(nThreads + 1, 0);
+    long long sum = 0;
+
+    #pragma omp parallel num_threads(nThreads) shared(values, n, totals, sum) default(none)
+    {
+        int thread = omp_get_thread_num(), team = omp_get_num_threads();
+        long long first = n * thread / team, last = n * (thread + 1) / team;
+        long long blockSum = 0;
+        for (long long i = first; i < last; i++) blockSum += values[i];
+        totals[thread + 1] = blockSum;
+        #pragma omp barrier
+        #pragma omp single
+        {
+            for (int t = 0; t < team; t++) totals[t + 1] += totals[t];
+            sum = totals[team];
+        }
+        long long running = totals[thread];
+        for (long long i = first; i < last; i++) {
+            long long value = values[i];
+            values[i] = running;
+            running += value;
+        }
+    }
+    return sum;
+}
+
+/**
+ * Move the deduplicated rows of graph into a new array of the exact size, in parallel by blocks of rows.
+ * A row that lost duplicates has -(its new length) - 1 in its last slot, see buildCsr.
+ */
+static void compactRows(CSR& graph, long long nUnique, int nThreads) {
+    TRACE_SCOPE("compact");
+    ArenaVector<int> compact(nUnique);
+    vector<long long> totals(nThreads + 1, 0);
+    long long* offsets = graph.offsets.data();
+    const int* neighbors = graph.neighbors.data();
+    int nNodes = graph.nNodes;
+    auto rowLength = [neighbors](long long start, long long end) {
+        return end > start && neighbors[end - 1] < 0 ? -(long long) neighbors[end - 1] - 1 : end - start;
+    };
+
+    #pragma omp parallel num_threads(nThreads) shared(compact, totals, offsets, neighbors, nNodes, rowLength) default(none)
+    {
+        int thread = omp_get_thread_num(), team = omp_get_num_threads();
+        int first = (int) ((long long) nNodes * thread / team), last = (int) ((long long) nNodes * (thread + 1) / team);
+        long long blockLength = 0;
+        for (int u = first; u < last; u++) blockLength += rowLength(offsets[u], offsets[u + 1]);
+        totals[thread + 1] = blockLength;
+        long long blockEnd = offsets[last]; // overwritten by the next block once it starts moving its rows
+        #pragma omp barrier
+        #pragma omp single
+        for (int t = 0; t < team; t++) totals[t + 1] += totals[t];
+
+        // offsets[u + 1] is read before the row u + 1 overwrites it
+        long long write = totals[thread], start = offsets[first];
+        for (int u = first; u < last; u++) {
+            long long end = u + 1 == last ? blockEnd : offsets[u + 1];
+            long long length = rowLength(start, end);
+            copy(neighbors + start, neighbors + start + length, compact.begin() + write);
+            offsets[u] = write;
+            write += length;
+            start = end;
+        }
+    }
+    offsets[nNodes] = nUnique;
+    graph.neighbors.swap(compact);
+}
+
+/**
+ * Build the undirected CSR of nEdges edges, edge(i) returns the i-th as a pair of ints.
+ * Each edge is stored in both directions, self-loops and duplicated edges (also A-B and B-A) are dropped.
+ * Only the offsets and the neighbours are allocated (and, if there are duplicates, the compacted neighbours), every
+ * pass is parallel: degree histogram, prefix sum, scatter, sort and deduplication of each row.
+ * With symmetric = false the edges are arcs, stored only in the row of their source.
+ * @param nNodes No. of nodes in the graph, raised if an edge references a bigger id
+ */
+template<bool symmetric = true, typename EdgeAt>
+static CSR buildCsr(int nNodes, long long nEdges, int nThreads, EdgeAt edge) {
+    TRACE_SCOPE("csr build");
+    CSR graph;
+    int maxId = nNodes - 1;
+    #pragma omp parallel for num_threads(nThreads) reduction(max:maxId) shared(nEdges, edge) default(none)
+    for (long long i = 0; i < nEdges; i++) {
+        auto [u, v] = edge(i);
+        maxId = max(maxId, max(u, v));
+    }
+    graph.nNodes = nNodes = maxId + 1;
+
+    // Degree histogram in offsets[u], then its exclusive prefix sum: offsets[u] is the first slot of row u.
+    // The counters are only updated atomically when there are several threads, a locked add costs about 10x more.
+    bool concurrent = nThreads > 1;
+    graph.offsets.assign(nNodes + 1, 0);
+    long long* offsets = graph.offsets.data();
+    #pragma omp parallel for num_threads(nThreads) shared(nEdges, edge, offsets, concurrent) default(none)
+    for (long long i = 0; i < nEdges; i++) {
+        auto [u, v] = edge(i);
+        if (u == v) continue;
+        if (concurrent) {
+            #pragma omp atomic
+            offsets[u]++;
+            if (symmetric) {
+                #pragma omp atomic
+                offsets[v]++;
+            }
+        } else {
+            offsets[u]++;
+            if (symmetric) offsets[v]++;
+        }
+    }
+    long long nNeighbors = prefixSum(offsets, nNodes, nThreads);
+
+    // offsets[u] is the cursor of row u and ends at the first slot of row u + 1, shifting it gives the offsets
+    graph.neighbors.resize(nNeighbors);
+    int* neighbors = graph.neighbors.data();
+    #pragma omp parallel for num_threads(nThreads) shared(nEdges, edge, offsets, neighbors, concurrent) default(none)
+    for (long long i = 0; i < nEdges; i++) {
+        auto [u, v] = edge(i);
+        if (u == v) continue;
+        if (concurrent) {
+            long long at;
+            #pragma omp atomic capture
+            at = offsets[u]++;
+            neighbors[at] = v;
+            if (symmetric) {
+                #pragma omp atomic capture
+                at = offsets[v]++;
+                neighbors[at] = u;
+            }
+        } else {
+            neighbors[offsets[u]++] = v;
+            if (symmetric) neighbors[offsets[v]++] = u;
+        }
+    }
+    memmove(offsets + 1, offsets, nNodes * sizeof(long long));
+    offsets[0] = 0;
+
+    // Sort each row and remove the duplicates: a row that loses some keeps its new length in its last slot
+    TRACE_SCOPE("dedupe");
+    long long nDuplicates = 0;
+    #pragma omp parallel for num_threads(nThreads) schedule(dynamic, 256) reduction(+:nDuplicates) shared(nNodes, offsets, neighbors) default(none)
+    for (int u = 0; u < nNodes; u++) {
+        int* first = neighbors + offsets[u];
+        int* last = neighbors + offsets[u + 1];
+        sort(first, last);
+        int* end = unique(first, last);
+        if (end < last) {
+            nDuplicates += last - end;
+            last[-1] = -(int) (end - first) - 1;
+        }
+    }
+    if (nDuplicates > 0) {
+        compactRows(graph, nNeighbors - nDuplicates, nThreads);
+    }
+    return graph;
+}
+
+/**
+ * Node ids of caller-owned arrays must be in [0, INT_MAX), checked before anything is allocated
+ */
+template<typename T>
+static void checkIds(const T* sources, const T* targets, long long nEdges, long long stride, int nThreads) {
+    long long firstBad = nEdges;
+    #pragma omp parallel for num_threads(nThreads) reduction(min:firstBad) shared(sources, targets, nEdges, stride) default(none)
+    for (long long i = 0; i < nEdges; i++) {
+        T u = sources[i * stride], v = targets[i * stride];
+        if (u < 0 || v < 0 || u >= (T) INT_MAX || v >= (T) INT_MAX) {
+            firstBad = min(firstBad, i);
+        }
+    }
+    if (firstBad < nEdges) {
+        throw invalid_argument("node id out of range in edge " + to_string(firstBad));
+    }
+}
+
+/**
+ * Build the undirected CSR of a list of edges.
+ * Each edge is stored in both directions, self-loops and duplicated edges (also A-B and B-A) are dropped.
+ * @param nNodes No. of nodes in the graph, raised if an edge references a bigger id
+ * @param edges
+ * @param nThreads
+ * @return
+ */
+CSR GraphCSR::fromEdges(int nNodes, const vector<pair<int, int>>& edges, int nThreads) {
+    return buildCsr(nNodes, (long long) edges.size(), nThreads, [&edges](long long i) { return edges[i]; });
+}
+
+/**
+ * Build the directed CSR of a list of arcs: the row of u holds its out-neighbours, or its in-neighbours if
+ * reversed. Self-loops and duplicated arcs are dropped, u->v and v->u are both kept.
+ * @param nNodes No. of nodes in the graph, raised if an arc references a bigger id
+ * @param arcs
+ * @param reversed store each arc in the row of its target
+ * @param nThreads
+ * @return
+ */
+CSR GraphCSR::fromArcs(int nNodes, const vector<pair<int, int>>& arcs, bool reversed, int nThreads) {
+    if (reversed) {
+        return buildCsr<false>(nNodes, (long long) arcs.size(), nThreads, [&arcs](long long i) {
+            return pair<int, int>(arcs[i].second, arcs[i].first);
+        });
+    }
+    return buildCsr<false>(nNodes, (long long) arcs.size(), nThreads, [&arcs](long long i) { return arcs[i]; });
+}
+
+/**
+ * Build the undirected CSR of edges read in place from caller-owned arrays, edge i is
+ * sources[i * stride] - targets[i * stride]: an interleaved array of pairs is sources = edges, targets = edges + 1,
+ * stride = 2, two separate columns are stride = 1
+ * @param nNodes No. of nodes in the graph, raised if an edge references a bigger id
+ * @param sources
+ * @param targets
+ * @param nEdges
+ * @param stride in elements
+ * @param nThreads
+ * @return
+ */
+CSR GraphCSR::fromEdges(int nNodes, const int* sources, const int* targets, long long nEdges, long long stride,
+                        int nThreads) {
+    checkIds(sources, targets, nEdges, stride, nThreads);
+    return buildCsr(nNodes, nEdges, nThreads, [=](long long i) {
+        return pair<int, int>(sources[i * stride], targets[i * stride]);
+    });
+}
+
+CSR GraphCSR::fromEdges(int nNodes, const long long* sources, const long long* targets, long long nEdges,
+                        long long stride, int nThreads) {
+    checkIds(sources, targets, nEdges, stride, nThreads);
+    return buildCsr(nNodes, nEdges, nThreads, [=](long long i) {
+        return pair<int, int>((int) sources[i * stride], (int) targets[i * stride]);
+    });
+}
+
+/**
+ * Keep only the edges going from the lower to the higher ranked node, where nodes are ranked by (degree, id).
+ * Every triangle appears exactly once as u->v, u->w, v->w and every node keeps at most sqrt(2m) out-neighbours.
+ * @param graph undirected graph
+ * @param nThreads
+ * @return degree-ordered DAG
+ */
+CSR GraphCSR::orientByDegree(const CSR& graph, int nThreads) {
+    TRACE_SCOPE("reorder");
+    auto lower = [&graph](int u, int v) {
+        return graph.degree(u) < graph.degree(v) || (graph.degree(u) == graph.degree(v) && u < v);
+    };
+
+    CSR dag;
+    dag.nNodes = graph.nNodes;
+    dag.offsets.assign(graph.nNodes + 1, 0);
+    long long* offsets = dag.offsets.data();
+    #pragma omp parallel for num_threads(nThreads) schedule(dynamic, 256) shared(graph, lower, offsets) default(none)
+    for (int u = 0; u < graph.nNodes; u++) {
+        for (long long i = graph.offsets[u]; i < graph.offsets[u + 1]; i++) {
+            if (lower(u, graph.neighbors[i])) offsets[u]++;
+        }
+    }
+    offsets[graph.nNodes] = prefixSum(offsets, graph.nNodes, nThreads);
+
+    // Rows stay sorted by id since they are filtered in order
+    dag.neighbors.resize(offsets[graph.nNodes]);
+    int* neighbors = dag.neighbors.data();
+    #pragma omp parallel for num_threads(nThreads) schedule(dynamic, 256) shared(graph, lower, offsets, neighbors) default(none)
+    for (int u = 0; u < graph.nNodes; u++) {
+        long long write = offsets[u];
+        for (long long i = graph.offsets[u]; i < graph.offsets[u + 1]; i++) {
+            if (lower(u, graph.neighbors[i])) neighbors[write++] = graph.neighbors[i];
+        }
+    }
+    return dag;
+}
+
+/**
+ * List of the edges of the graph, each one once as (u, v) with u < v
+ * @param graph undirected graph
+ * @return
+ */
+vector<pair<int, int>> GraphCSR::getEdges(const CSR& graph) {
+    vector<pair<int, int>> edges;
+    edges.reserve(graph.neighbors.size() / 2);
+    for (int u = 0; u < graph.nNodes; u++) {
+        for (long long i = graph.offsets[u]; i < graph.offsets[u + 1]; i++) {
+            if (u < graph.neighbors[i]) edges.emplace_back(u, graph.neighbors[i]);
+        }
+    }
+    return edges;
+}
+
+/**
+ * Write the graph in a binary snapshot: magic, nNodes (int32), no. of neighbours (int64), offsets, neighbours.
+ * Loading it back skips parsing, deduplication and sorting.
+ * @param graph
+ * @param path
+ */
+void GraphCSR::saveSnapshot(const CSR& graph, const string& path) {
+    ofstream out(path, ios::binary | ios::trunc);
+    long long nNeighbors = (long long) graph.neighbors.size();
+    out.write(SNAPSHOT_MAGIC, 8);
+    out.write(reinterpret_cast<const char*>(&graph.nNodes), sizeof(graph.nNodes));
+    out.write(reinterpret_cast<const char*>(&nNeighbors), sizeof(nNeighbors));
+    out.write(reinterpret_cast<const char*>(graph.offsets.data()), (streamsize) (graph.offsets.size() * sizeof(long long)));
+    out.write(reinterpret_cast<const char*>(graph.neighbors.data()), (streamsize) (nNeighbors * sizeof(int)));
+    if (!out) {
+        throw runtime_error("unable to write " + path);
+    }
+}
+
+/**
+ * Read the magic and the sizes of a snapshot, leaving the stream at the offsets
+ */
+void GraphCSR::readSnapshotHeader(istream& in, const string& path, int& nNodes, long long& nNeighbors) {
+    char magic[8];
+    if (!in.read(magic, 8) || memcmp(magic, SNAPSHOT_MAGIC, 8) != 0) {
+        throw runtime_error(path + " is not a graph snapshot");
+    }
+    in.read(reinterpret_cast<char*>(&nNodes), sizeof(nNodes));
+    in.read(reinterpret_cast<char*>(&nNeighbors), sizeof(nNeighbors));
+    if (!in) {
+        throw runtime_error(path + " is truncated");
+    }
+}
+
+/**
+ * Size of the graph of a snapshot, without loading it
+ * @param path
+ * @param nNodes
+ * @param nNeighbors twice the no. of edges
+ */
+void GraphCSR::getSnapshotSize(const string& path, int& nNodes, long long& nNeighbors) {
+    ifstream in(path, ios::binary);
+    readSnapshotHeader(in, path, nNodes, nNeighbors);
+}
+
+/**
+ * @return true if the file starts with the magic of a snapshot
+ */
+bool GraphCSR::isSnapshot(const string& path) {
+    ifstream in(path, ios::binary);
+    char magic[8];
+    return in.read(magic, 8) && memcmp(magic, SNAPSHOT_MAGIC, 8) == 0;
+}
+
+/**
+ * Read a graph written by saveSnapshot
+ * @param path
+ * @return
+ */
+CSR GraphCSR::loadSnapshot(const string& path) {
+    TRACE_SCOPE("load snapshot");
+    ifstream in(path, ios::binary);
+    CSR graph;
+    long long nNeighbors;
+    readSnapshotHeader(in, path, graph.nNodes, nNeighbors);
+    graph.offsets.resize(graph.nNodes + 1);
+    graph.neighbors.resize(nNeighbors);
+    in.read(reinterpret_cast<char*>(graph.offsets.data()), (streamsize) (graph.offsets.size() * sizeof(long long)));
+    in.read(reinterpret_cast<char*>(graph.neighbors.data()), (streamsize) (nNeighbors * sizeof(int)));
+    if (!in) {
+        throw runtime_error(path + " is truncated");
+    }
+    return graph;
+}
+
+/**
+ * Size of the intersection of two sorted lists of nodes (merge based)
+ * @return No. of nodes in common
+ */
+long long GraphCSR::getIntersection(const int* a, const int* aEnd, const int* b, const int* bEnd) {
+    long long count = 0;
+    while (a < aEnd && b < bEnd) {
+        if (*a < *b) {
+            a++;
+        } else if (*b < *a) {
+            b++;
+        } else {
+            count++;
+            a++;
+            b++;
+        }
+    }
+    return count;
+}
+
+/**
+ * Size of the intersection of two sorted lists of nodes: merge if they have similar lengths, otherwise each node
+ * of the shorter list is searched in the longer one, galloping from the position of the previous node.
+ * Costs O(s log(l/s)) instead of O(s + l) for lists of lengths s << l.
+ * @return No. of nodes in common
+ */
+long long GraphCSR::getIntersection_adaptive(const int* a, const int* aEnd, const int* b, const int* bEnd) {
+    if (aEnd - a > bEnd - b) {
+        swap(a, b);
+        swap(aEnd, bEnd);
+    }
+    if ((bEnd - b) < GALLOP_RATIO * (aEnd - a)) {
+        return getIntersection(a, aEnd, b, bEnd);
+    }
+
+    long long count = 0;
+    for (; a < aEnd && b < bEnd; a++) {
+        long long step = 1;
+        while (step < bEnd - b && b[step] < *a) step *= 2;
+        b = lower_bound(b + step / 2, b + min<long long>(step + 1, bEnd - b), *a);
+        if (b < bEnd && *b == *a) {
+            count++;
+            b++;
+        }
+    }
+    return count;
+}
+
+/**
+ * Forward algorithm: for each edge u->v of the degree-ordered DAG, TRIANGLES += N+(u) ∩ N+(v).
+ * Each triangle is found once, so there is no need to divide by 3.
+ * @param dag graph returned by orientByDegree
+ * @param kernel merge, or adaptive for graphs whose out-degrees are very skewed
+ * @param control cancellation, deadline and progress in edges of the DAG, may be null
+ * @return No. of triangles in graph, of the nodes counted before a stop
+ */
+long long GraphCSR::countTriangles_forward_seq(const CSR& dag, IntersectionKernel kernel, Control* control) {
+    long long count = 0;
+    const int* adj = dag.neighbors.data();
+    if (control) control->start((long long) dag.neighbors.size());
+
+    for (int first = 0; first < dag.nNodes; first += CONTROL_BLOCK) {
+        if (control && control->isStopped()) break;
+        int last = min(dag.nNodes, first + CONTROL_BLOCK);
+        for (int u = first; u < last; u++) {
+            for (long long i = dag.offsets[u]; i < dag.offsets[u + 1]; i++) {
+                int v = adj[i];
+                count += kernel == INTERSECT_MERGE
+                         ? getIntersection(adj + dag.offsets[u], adj + dag.offsets[u + 1], adj + dag.offsets[v], adj + dag.offsets[v + 1])
+                         : getIntersection_adaptive(adj + dag.offsets[u], adj + dag.offsets[u + 1], adj + dag.offsets[v], adj + dag.offsets[v + 1]);
+            }
+        }
+        if (control) control->advance(dag.offsets[last] - dag.offsets[first]);
+    }
+    return count;
+}
+
+// Dynamic scheduling since the out-degrees (and so the work per node) are skewed on real graphs
+/**
+ * Parallelized version of countTriangles_forward_seq
+ * @param dag graph returned by orientByDegree
+ * @param nThreads
+ * @param kernel
+ * @param control cancellation, deadline and progress in edges of the DAG, may be null
+ * @return No. of triangles in graph, of the blocks of nodes counted before a stop
+ */
+long long GraphCSR::countTriangles_forward_multi(const CSR& dag, int nThreads, IntersectionKernel kernel, Control* control) {
+    long long count = 0;
+    const int* adj = dag.neighbors.data();
+    int nBlocks = (dag.nNodes + CONTROL_BLOCK - 1) / CONTROL_BLOCK;
+    if (control) control->start((long long) dag.neighbors.size());
+
+    #pragma omp parallel num_threads(nThreads) reduction(+:count) shared(dag, adj, kernel, control, nBlocks) default(none)
+    {
+        TRACE_SCOPE("count thread");
+        #pragma omp for schedule(dynamic)
+        for (int block = 0; block < nBlocks; block++) {
+            if (control && control->isStopped()) continue;
+            int first = block * CONTROL_BLOCK, last = min(dag.nNodes, first + CONTROL_BLOCK);
+            for (int u = first; u < last; u++) {
+                for (long long i = dag.offsets[u]; i < dag.offsets[u + 1]; i++) {
+                    int v = adj[i];
+                    count += kernel == INTERSECT_MERGE
+                             ? getIntersection(adj + dag.offsets[u], adj + dag.offsets[u + 1], adj + dag.offsets[v], adj + dag.offsets[v + 1])
+                             : getIntersection_adaptive(adj + dag.offsets[u], adj + dag.offsets[u + 1], adj + dag.offsets[v], adj + dag.offsets[v + 1]);
+                }
+            }
+            if (control) control->advance(dag.offsets[last] - dag.offsets[first]);
+        }
+    }
+    return count;
+}
+
+/**
+ * Call found(w) for each node w in common between two sorted lists (merge based)
+ */
+template<typename F>
+static void forEachCommon(const int* a, const int* aEnd, const int* b, const int* bEnd, F found) {
+    while (a < aEnd && b < bEnd) {
+        if (*a < *b) {
+            a++;
+        } else if (*b < *a) {
+            b++;
+        } else {
+            found(*a);
+            a++;
+            b++;
+        }
+    }
+}
+
+/**
+ * Triangles of each node with the forward algorithm: every triangle u->v, u->w, v->w found adds one to u, v and w
+ * @param dag graph returned by orientByDegree
+ * @param nThreads
+ * @return No. of triangles of each node
+ */
+vector<long long> GraphCSR::countLocalTriangles_forward(const CSR& dag, int nThreads) {
+    vector<long long> local(dag.nNodes, 0);
+    const int* adj = dag.neighbors.data();
+
+    #pragma omp parallel for num_threads(nThreads) schedule(dynamic, 64) shared(dag, adj, local) default(none)
+    for (int u = 0; u < dag.nNodes; u++) {
+        long long own = 0;
+        for (long long i = dag.offsets[u]; i < dag.offsets[u + 1]; i++) {
+            int v = adj[i];
+            long long found = 0;
+            forEachCommon(adj + dag.offsets[u], adj + dag.offsets[u + 1], adj + dag.offsets[v], adj + dag.offsets[v + 1], [&](int w) {
+                #pragma omp atomic
+                local[w]++;
+                found++;
+            });
+            if (found) {
+                #pragma omp atomic
+                local[v] += found;
+            }
+            own += found;
+        }
+        #pragma omp atomic
+        local[u] += own;
+    }
+    return local;
+}
+
+/**
+ * Call visit(u, v, w) once for each triangle, with u->v, u->w and v->w in the DAG.
+ * With more than one thread visit is called concurrently from all of them.
+ * @param dag graph returned by orientByDegree
+ * @param nThreads
+ * @param visit
+ */
+void GraphCSR::enumerateTriangles_forward(const CSR& dag, int nThreads, const function<void(int, int, int)>& visit) {
+    const int* adj = dag.neighbors.data();
+
+    #pragma omp parallel for num_threads(nThreads) schedule(dynamic, 64) shared(dag, adj, visit) default(none)
+    for (int u = 0; u < dag.nNodes; u++) {
+        for (long long i = dag.offsets[u]; i < dag.offsets[u + 1]; i++) {
+            int v = adj[i];
+            forEachCommon(adj + dag.offsets[u], adj + dag.offsets[u + 1], adj + dag.offsets[v], adj + dag.offsets[v + 1],
+                          [&](int w) { visit(u, v, w); });
+        }
+    }
+}
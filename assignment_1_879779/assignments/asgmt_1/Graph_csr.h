@@ -0,0 +1,62 @@
+#ifndef LEARNING_MASSIVE_DATA_GRAPH_CSR_H
+#define LEARNING_MASSIVE_DATA_GRAPH_CSR_H
+
+#include "Arena.h"
+#include "Control.h"
+
+#include <vector>
+#include <utility>
+#include <string>
+#include <istream>
+#include <functional>
+
+#define GALLOP_RATIO 16 //the adaptive intersection gallops when a list is this many times longer than the other
+
+/**
+ * Compressed sparse row adjacency: the neighbours of node u are neighbors[offsets[u] .. offsets[u+1]), sorted.
+ * Both arrays live in the Arena, huge-page backed once they are large.
+ */
+struct CSR {
+    int nNodes = 0;
+    ArenaVector<long long> offsets;
+    ArenaVector<int> neighbors;
+
+    long long degree(int u) const { return offsets[u + 1] - offsets[u]; }
+};
+
+/**
+ * How two sorted lists of neighbours are intersected
+ */
+enum IntersectionKernel { INTERSECT_MERGE, INTERSECT_ADAPTIVE };
+
+class GraphCSR {
+    public:
+    static CSR fromEdges(int nNodes, const std::vector<std::pair<int, int>>& edges, int nThreads = 1);
+    static CSR fromEdges(int nNodes, const int* sources, const int* targets, long long nEdges, long long stride = 1,
+                         int nThreads = 1);
+    static CSR fromEdges(int nNodes, const long long* sources, const long long* targets, long long nEdges,
+                         long long stride = 1, int nThreads = 1);
+    static CSR fromArcs(int nNodes, const std::vector<std::pair<int, int>>& arcs, bool reversed = false, int nThreads = 1);
+    static CSR orientByDegree(const CSR& graph, int nThreads = 1);
+    static std::vector<std::pair<int, int>> getEdges(const CSR& graph);
+
+    static void saveSnapshot(const CSR& graph, const std::string& path);
+    static CSR loadSnapshot(const std::string& path);
+    static void getSnapshotSize(const std::string& path, int& nNodes, long long& nNeighbors);
+    static bool isSnapshot(const std::string& path);
+
+    static long long countTriangles_forward_seq(const CSR& dag, IntersectionKernel kernel = INTERSECT_MERGE,
+                                                Control* control = nullptr);
+    static long long countTriangles_forward_multi(const CSR& dag, int nThreads, IntersectionKernel kernel = INTERSECT_MERGE,
+                                                  Control* control = nullptr);
+    static std::vector<long long> countLocalTriangles_forward(const CSR& dag, int nThreads);
+    static void enumerateTriangles_forward(const CSR& dag, int nThreads, const std::function<void(int, int, int)>& visit);
+
+    static long long getIntersection(const int* a, const int* aEnd, const int* b, const int* bEnd);
+    static long long getIntersection_adaptive(const int* a, const int* aEnd, const int* b, const int* bEnd);
+
+    private:
+    static void readSnapshotHeader(std::istream& in, const std::string& path, int& nNodes, long long& nNeighbors);
+};
+
+#endif
@@ -0,0 +1,187 @@
+#include "Graph_directed.h"
+#include "Trace.h"
+
+#include <vector>
+#include <array>
+#include <string>
+#include <omp.h>
+
+using namespace std;
+
+long long TriangleCensus::getTotal() const {
+    long long total = 0;
+    for (long long count: counts) total += count;
+    return total;
+}
+
+/**
+ * Build the out and in adjacency of a list of arcs and the degree-ordered DAG of the symmetrised graph, with the
+ * directions of each of its edges. Self-loops and duplicated arcs are dropped.
+ * @param nNodes No. of nodes in the graph, raised if an arc references a bigger id
+ * @param arcs u->v for each pair (u, v)
+ * @param nThreads
+ * @return
+ */
+DirectedCSR GraphDirected::fromArcs(int nNodes, const vector<pair<int, int>>& arcs, int nThreads) {
+    DirectedCSR graph;
+    graph.out = GraphCSR::fromArcs(nNodes, arcs, false, nThreads);
+    graph.in = GraphCSR::fromArcs(nNodes, arcs, true, nThreads);
+    graph.dag = GraphCSR::orientByDegree(GraphCSR::fromEdges(nNodes, arcs, nThreads), nThreads);
+
+    // The rows of the DAG, of the out and of the in adjacency are sorted, one merge finds the arcs of each edge
+    TRACE_SCOPE("directions");
+    const CSR& dag = graph.dag;
+    const CSR& out = graph.out;
+    const CSR& in = graph.in;
+    graph.directions.resize(dag.neighbors.size());
+    uint8_t* directions = graph.directions.data();
+    #pragma omp parallel for num_threads(nThreads) schedule(dynamic, 256) shared(dag, out, in, directions) default(none)
+    for (int u = 0; u < dag.nNodes; u++) {
+        const int* outNext = out.neighbors.data() + out.offsets[u];
+        const int* outEnd = out.neighbors.data() + out.offsets[u + 1];
+        const int* inNext = in.neighbors.data() + in.offsets[u];
+        const int* inEnd = in.neighbors.data() + in.offsets[u + 1];
+        for (long long i = dag.offsets[u]; i < dag.offsets[u + 1]; i++) {
+            int v = dag.neighbors[i];
+            while (outNext < outEnd && *outNext < v) outNext++;
+            while (inNext < inEnd && *inNext < v) inNext++;
+            directions[i] = (outNext < outEnd && *outNext == v ? DIRECTION_FORWARD : 0)
+                          | (inNext < inEnd && *inNext == v ? DIRECTION_BACKWARD : 0);
+        }
+    }
+    return graph;
+}
+
+/**
+ * Type of a triangle from the directions of its pairs, each DIRECTION_FORWARD | DIRECTION_BACKWARD of the
+ * arcs from the first node of the pair to the second
+ * @param uv
+ * @param uw
+ * @param vw
+ * @return
+ */
+TriangleType GraphDirected::classify(int uv, int uw, int vw) {
+    const int both = DIRECTION_FORWARD | DIRECTION_BACKWARD;
+    int mutual = (uv == both) + (uw == both) + (vw == both);
+    if (mutual == 3) return TRIANGLE_300;
+    if (mutual == 2) return TRIANGLE_210;
+
+    // Arcs each node sends inside the triangle
+    int outU = (uv & DIRECTION_FORWARD) + (uw & DIRECTION_FORWARD);
+    int outV = (uv & DIRECTION_BACKWARD) / 2 + (vw & DIRECTION_FORWARD);
+    int outW = (uw & DIRECTION_BACKWARD) / 2 + (vw & DIRECTION_BACKWARD) / 2;
+    if (mutual == 0) {
+        return outU == 1 && outV == 1 && outW == 1 ? TRIANGLE_030C : TRIANGLE_030T;
+    }
+    // The node outside the mutual pair sends to both, to none or to one of them
+    int outOther = uv == both ? outW : uw == both ? outV : outU;
+    return outOther == 2 ? TRIANGLE_120D : outOther == 0 ? TRIANGLE_120U : TRIANGLE_120C;
+}
+
+/**
+ * Type of every combination of directions, indexed by uv | uw << 2 | vw << 4
+ */
+static array<uint8_t, 64> getTypes() {
+    array<uint8_t, 64> types {};
+    for (int uv = 1; uv < 4; uv++)
+        for (int uw = 1; uw < 4; uw++)
+            for (int vw = 1; vw < 4; vw++)
+                types[uv | uw << 2 | vw << 4] = (uint8_t) GraphDirected::classify(uv, uw, vw);
+    return types;
+}
+
+/**
+ * Call found(a, b) for each node in common between two sorted lists, with where it is in each of them (merge
+ * based, as GraphCSR::getIntersection)
+ */
+template<typename F>
+static void forEachCommon(const int* a, const int* aEnd, const int* b, const int* bEnd, F found) {
+    while (a < aEnd && b < bEnd) {
+        if (*a < *b) {
+            a++;
+        } else if (*b < *a) {
+            b++;
+        } else {
+            found(a, b);
+            a++;
+            b++;
+        }
+    }
+}
+
+/**
+ * Directed triangle census with the forward algorithm: every triangle u->v, u->w, v->w of the DAG is found
+ * once by intersecting the rows of u and v, and the directions of its three edges, at the positions of v and w
+ * in the rows, give its type. The nodes are split between the threads in dynamic chunks, each thread counts
+ * the types on its own and the counts of the nodes are added atomically.
+ * @param graph
+ * @param nThreads
+ * @param local also count the triangles of each type of every node
+ * @return
+ */
+TriangleCensus GraphDirected::countCensus(const DirectedCSR& graph, int nThreads, bool local) {
+    static const array<uint8_t, 64> types = getTypes();
+    const CSR& dag = graph.dag;
+    const int* adj = dag.neighbors.data();
+    const uint8_t* directions = graph.directions.data();
+    TriangleCensus census;
+    if (local) census.local.assign(dag.nNodes, {});
+    long long* nodes = local ? census.local.data()->data() : nullptr; // N_TRIANGLE_TYPES counts for each node
+
+    #pragma omp parallel num_threads(nThreads) shared(dag, adj, directions, census, nodes) default(none)
+    {
+        array<long long, N_TRIANGLE_TYPES> counts {};
+        #pragma omp for schedule(dynamic, 64) nowait
+        for (int u = 0; u < dag.nNodes; u++) {
+            array<long long, N_TRIANGLE_TYPES> own {};
+            for (long long i = dag.offsets[u]; i < dag.offsets[u + 1]; i++) {
+                int v = adj[i];
+                int uv = directions[i];
+                array<long long, N_TRIANGLE_TYPES> found {};
+                forEachCommon(adj + dag.offsets[u], adj + dag.offsets[u + 1], adj + dag.offsets[v], adj + dag.offsets[v + 1],
+                              [&](const int* a, const int* b) {
+                    int type = types[uv | directions[a - adj] << 2 | directions[b - adj] << 4];
+                    found[type]++;
+                    if (nodes != nullptr) {
+                        #pragma omp atomic
+                        nodes[(long long) *a * N_TRIANGLE_TYPES + type]++;
+                    }
+                });
+                for (int type = 0; type < N_TRIANGLE_TYPES; type++) {
+                    if (nodes != nullptr && found[type] > 0) {
+                        #pragma omp atomic
+                        nodes[(long long) v * N_TRIANGLE_TYPES + type] += found[type];
+                    }
+                    own[type] += found[type];
+                }
+            }
+            for (int type = 0; type < N_TRIANGLE_TYPES; type++) {
+                if (nodes != nullptr && own[type] > 0) {
+                    #pragma omp atomic
+                    nodes[(long long) u * N_TRIANGLE_TYPES + type] += own[type];
+                }
+                counts[type] += own[type];
+            }
+        }
+        #pragma omp critical
+        for (int type = 0; type < N_TRIANGLE_TYPES; type++) {
+            census.counts[type] += counts[type];
+        }
+    }
+    return census;
+}
+
+/**
+ * @return MAN code of the type, e.g. 030T
+ */
+string GraphDirected::getName(TriangleType type) {
+    static const string names[N_TRIANGLE_TYPES] = {"030T", "030C", "120D", "120U", "120C", "210", "300"};
+    return names[type];
+}
+
+string GraphDirected::getDescription(TriangleType type) {
+    static const string descriptions[N_TRIANGLE_TYPES] = {
+        "transitive", "cyclic", "transitive, both targets reciprocated", "transitive, both sources reciprocated",
+        "cyclic, one pair reciprocated", "two pairs reciprocated", "all pairs reciprocated"};
+    return descriptions[type];
+}
@@ -0,0 +1,64 @@
+#ifndef LEARNING_MASSIVE_DATA_GRAPH_DIRECTED_H
+#define LEARNING_MASSIVE_DATA_GRAPH_DIRECTED_H
+
+#include "Graph_csr.h"
+
+#include <vector>
+#include <array>
+#include <string>
+#include <utility>
+#include <cstdint>
+
+#define DIRECTION_FORWARD 1 //the input has the arc u->v of the DAG edge u->v
+#define DIRECTION_BACKWARD 2 //the input has the arc v->u of the DAG edge u->v
+
+/**
+ * Types of the triangles of a directed graph: the triads of the Holland-Leinhardt census in which every pair of
+ * nodes is connected, named by their mutual and asymmetric pairs. The types with mutual pairs are the
+ * reciprocated variants of 030T and 030C.
+ *  030T  a->b, a->c, b->c (transitive)
+ *  030C  a->b, b->c, c->a (cyclic)
+ *  120D  a<->b, c->a, c->b
+ *  120U  a<->b, a->c, b->c
+ *  120C  a<->b, a->c, c->b
+ *  210   a<->b, b<->c, a->c
+ *  300   a<->b, b<->c, a<->c
+ */
+enum TriangleType {
+    TRIANGLE_030T, TRIANGLE_030C, TRIANGLE_120D, TRIANGLE_120U, TRIANGLE_120C, TRIANGLE_210, TRIANGLE_300,
+    N_TRIANGLE_TYPES
+};
+
+/**
+ * Directed graph: its out and in adjacency, and the symmetrised graph oriented by degree where each edge u->v
+ * keeps the directions of the input arcs between u and v. Each triangle is in the DAG once, as for the undirected
+ * forward algorithm, and its type is read from the directions of its three edges.
+ */
+struct DirectedCSR {
+    CSR out;                            // out-neighbours of each node
+    CSR in;                             // in-neighbours of each node
+    CSR dag;                            // see GraphCSR::orientByDegree
+    ArenaVector<uint8_t> directions;    // of each DAG edge, DIRECTION_FORWARD | DIRECTION_BACKWARD
+};
+
+/**
+ * Triangles of each type, for the graph and, if asked for, for each node
+ */
+struct TriangleCensus {
+    std::array<long long, N_TRIANGLE_TYPES> counts {};
+    std::vector<std::array<long long, N_TRIANGLE_TYPES>> local; // of each node, empty if not computed
+
+    long long getTotal() const;
+};
+
+class GraphDirected {
+    public:
+    static DirectedCSR fromArcs(int nNodes, const std::vector<std::pair<int, int>>& arcs, int nThreads = 1);
+    static TriangleCensus countCensus(const DirectedCSR& graph, int nThreads, bool local = false);
+
+    static TriangleType classify(int uv, int uw, int vw);
+    static std::string getName(TriangleType type);
+    static std::string getDescription(TriangleType type);
+};
+
+#endif
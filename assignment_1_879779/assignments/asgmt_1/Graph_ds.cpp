@@ -1,25 +1,43 @@
 #include "Graph_ds.h"
+#include "Trace.h"
+#include "Decompress.h"
 
 #include <iostream>
 #include <vector>
 #include <numeric>
 #include <random>
 #include <fstream>
+#include <iomanip>
+#include <string>
+#include <stdexcept>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
 
 using namespace std;
 
+/**
+ * Pairs of nodes i < j, the units of work of the matrix kernels: row i has n - 1 - i of them
+ */
+static long long getPairs(size_t nNodes) {
+    return (long long) nNodes * ((long long) nNodes - 1) / 2;
+}
+
 /**
  * Count the number of triangles in an undirected graph
  * Iterate over all possible combinations of three vertices in the graph.
  * For each triple of vertices (i, j, k), check if there are edges between all three vertices.
  * @param graph
+ * @param control cancellation, deadline and progress in pairs of nodes, may be null
  * @return No. of triangles in graph
  */
-int GraphMat::countTriangles_node_seq(const vector<vector<bool>>& graph) {
+int GraphMat::countTriangles_node_seq(const vector<vector<bool>>& graph, Control* control) {
     int count = 0;
+    if (control) control->start(getPairs(graph.size()));
 
     // Loop through all possible combinations of nodes
     for (int i = 0; i < graph.size(); i++) {
+        if (control && control->isStopped()) break;
         for (int j = i + 1; j < graph.size(); j++) {
             if (graph[i][j]) {
                 for (int k = j + 1; k < graph.size(); k++) {
@@ -30,6 +48,7 @@ int GraphMat::countTriangles_node_seq(const vector<vector<bool>>& graph) {
                 }
             }
         }
+        if (control) control->advance((long long) graph.size() - i - 1);
     }
     // Return the total count of triangles
     return count;
@@ -40,17 +59,22 @@ int GraphMat::countTriangles_node_seq(const vector<vector<bool>>& graph) {
  * TRIANGLES += N(u) ∩ N(v)
  * TRIANGLES /= 3
  * @param graph
- * @return No. of triangles in graph
+ * @param control cancellation, deadline and progress in pairs of nodes, may be null
+ * @return No. of triangles in graph, a third of the triangles of the edges counted before a stop
  */
-int GraphMat::countTriangles_edge_seq(const vector<vector<bool>>& graph) {
+int GraphMat::countTriangles_edge_seq(const vector<vector<bool>>& graph, Control* control) {
     int count = 0;
+    if (control) control->start(getPairs(graph.size()));
 
     // Loop through all edges
-    for (int i = 0; i < graph.size(); i++)
+    for (int i = 0; i < graph.size(); i++) {
+        if (control && control->isStopped()) break;
         for (int j = i + 1; j < graph.size(); j++)
             if (graph[i][j]){
                 count += getIntersection(graph[i], graph[j], i, j);
             }
+        if (control) control->advance((long long) graph.size() - i - 1);
+    }
     // Return the total count of triangles/3, to subtract duplicates
     return count/3;
 }
@@ -83,14 +107,17 @@ int GraphMat::getIntersection(const vector<bool>& nodeARow, const vector<bool>&
  * Parallelized version of countTriangles_node_seq
  * @param graph
  * @param nThreads
+ * @param control cancellation, deadline and progress in pairs of nodes, may be null
  * @return
  */
-int GraphMat::countTriangles_node_multi(const vector<vector<bool>>& graph, int nThreads) {
+int GraphMat::countTriangles_node_multi(const vector<vector<bool>>& graph, int nThreads, Control* control) {
     int count = 0;
+    if (control) control->start(getPairs(graph.size()));
 
     // Loop through all possible combinations of nodes in parallel
-    #pragma omp parallel for num_threads(nThreads) reduction(+:count) schedule(dynamic) shared(graph) default(none)
+    #pragma omp parallel for num_threads(nThreads) reduction(+:count) schedule(dynamic) shared(graph, control) default(none)
     for (int i = 0; i < graph.size(); i++) {
+        if (control && control->isStopped()) continue;
         for (int j = i + 1; j < graph.size(); j++) {
             if (graph[i][j]) {
                 for (int k = j + 1; k < graph.size(); k++) {
@@ -101,6 +128,7 @@ int GraphMat::countTriangles_node_multi(const vector<vector<bool>>& graph, int n
                 }
             }
         }
+        if (control) control->advance((long long) graph.size() - i - 1);
     }
     // Return the total count of triangles
     return count;
@@ -114,18 +142,26 @@ int GraphMat::countTriangles_node_multi(const vector<vector<bool>>& graph, int n
  * Parallelized version of countTriangles_edge_seq
  * @param graph
  * @param nThreads
+ * @param control cancellation, deadline and progress in pairs of nodes, may be null
  * @return
  */
-int GraphMat::countTriangles_edge_multi(const vector<vector<bool>>& graph, int nThreads) {
+int GraphMat::countTriangles_edge_multi(const vector<vector<bool>>& graph, int nThreads, Control* control) {
     int count = 0;
+    if (control) control->start(getPairs(graph.size()));
 
     // Loop through all edges in parallel
-    #pragma omp parallel for num_threads(nThreads) reduction(+:count) schedule(dynamic) shared(graph) default(none)
-    for (int i = 0; i < graph.size(); i++) {
-        for (int j = i + 1; j < graph.size(); j++) {
-            if (graph[i][j]) {
-                count += getIntersection(graph[i], graph[j], i, j);
+    #pragma omp parallel num_threads(nThreads) reduction(+:count) shared(graph, control) default(none)
+    {
+        TRACE_SCOPE("count thread");
+        #pragma omp for schedule(dynamic)
+        for (int i = 0; i < graph.size(); i++) {
+            if (control && control->isStopped()) continue;
+            for (int j = i + 1; j < graph.size(); j++) {
+                if (graph[i][j]) {
+                    count += getIntersection(graph[i], graph[j], i, j);
+                }
             }
+            if (control) control->advance((long long) graph.size() - i - 1);
         }
     }
     // Return the total count of triangles/3, to subtract duplicates
@@ -139,7 +175,7 @@ int GraphMat::countTriangles_edge_multi(const vector<vector<bool>>& graph, int n
  * @return
  */
 vector<vector<bool>> GraphMat::getGraph(int nNodes, const string& path) {
-    auto start = chrono::high_resolution_clock::now();
+    TRACE_SCOPE("parse");
     // Read graph from file
     ifstream inputFile (path);
     vector<vector<bool>> graph(nNodes, vector<bool>(nNodes, false));
@@ -157,10 +193,6 @@ vector<vector<bool>> GraphMat::getGraph(int nNodes, const string& path) {
         inputFile.close();
     }
 
-    auto end = chrono::high_resolution_clock::now();
-    auto elapsed = chrono::duration_cast<chrono::milliseconds> (end - start);
-    cout << "Graph creation: " << elapsed.count() << " ms." << endl;
-
     long double maxEdges = nNodes * ((long double)nNodes - 1) / 2;
     long double density = nNodes / maxEdges;
     cout << "number of nodes: " << nNodes << ", number of edges: " << nEdges << ", density: " << fixed << setprecision(5) << density << endl;
@@ -168,6 +200,38 @@ vector<vector<bool>> GraphMat::getGraph(int nNodes, const string& path) {
     return graph;
 }
 
+/**
+ * Get the list of edges from a file of edges, without building the adjacency matrix.
+ * Lines starting with '#' (SNAP headers) are skipped, self-loops and duplicates are kept as they are.
+ * gzip and zstd files are decompressed in memory while they are parsed, see Decompress::getEdges.
+ * @param path Path of the file containing all the edges of the graph
+ * @param nThreads threads parsing a compressed file
+ * @return One pair (u, v) for each line of the file
+ */
+vector<pair<int, int>> GraphMat::getEdges(const string& path, int nThreads) {
+    if (Decompress::detect(path) != COMPRESSION_NONE) {
+        return Decompress::getEdges(path, nThreads);
+    }
+    TRACE_SCOPE("parse");
+    ifstream inputFile (path);
+    if (!inputFile.is_open()) {
+        throw runtime_error("unable to open " + path);
+    }
+
+    vector<pair<int, int>> edges;
+    string line;
+    while (getline(inputFile, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        char* end;
+        long u = strtol(line.c_str(), &end, 10);
+        char* endV;
+        long v = strtol(end, &endV, 10);
+        if (end == line.c_str() || endV == end) continue; // not an edge
+        edges.emplace_back((int) u, (int) v);
+    }
+    return edges;
+}
+
 /**
  * Create a graph given number of nodes and density
  * @param nNodes
@@ -175,7 +239,7 @@ vector<vector<bool>> GraphMat::getGraph(int nNodes, const string& path) {
  * @return
  */
 vector<vector<bool>> GraphMat::getGraph_dense(int nNodes, double density) {
-    auto start = chrono::high_resolution_clock::now();
+    TRACE_SCOPE("generate");
     vector<vector<bool>> graph(nNodes, vector<bool>(nNodes, false));
     int nEdges = 0;
 
@@ -194,10 +258,6 @@ vector<vector<bool>> GraphMat::getGraph_dense(int nNodes, double density) {
         }
     }
 
-    auto end = chrono::high_resolution_clock::now();
-    auto elapsed = chrono::duration_cast<chrono::milliseconds> (end - start);
-    cout << "Graph creation: " << elapsed.count() << " ms." << endl;
-
     long double maxEdges = nNodes*((long double)nNodes-1)/2;
     long double actual_density = nEdges / maxEdges;
     cout << "number of nodes: " << nNodes << ", number of edges: " << nEdges << ", density: " << fixed << setprecision(5) << actual_density << endl;
@@ -205,19 +265,74 @@ vector<vector<bool>> GraphMat::getGraph_dense(int nNodes, double density) {
     return graph;
 }
 
+/**
+ * Create the list of edges of a random graph given number of nodes and density, without the adjacency matrix.
+ * The gap to the next edge is drawn from a geometric distribution (Batagelj & Brandes),
+ * so the cost is linear in the number of edges instead of in the number of pairs of nodes.
+ * @param nNodes
+ * @param density probability of each edge
+ * @param seed
+ * @return edges (u, v) with u > v
+ */
+vector<pair<int, int>> GraphMat::getEdges_dense(int nNodes, double density, unsigned seed) {
+    TRACE_SCOPE("generate");
+    vector<pair<int, int>> edges;
+    if (density <= 0) return edges;
+
+    mt19937 gen(seed);
+    uniform_real_distribution<double> dis(0, 1);
+    double logSkip = density < 1 ? log(1 - density) : 0;
+
+    long long v = 1, w = -1;
+    while (v < nNodes) {
+        w += 1 + (density < 1 ? (long long) floor(log(1 - dis(gen)) / logSkip) : 0);
+        while (w >= v && v < nNodes) {
+            w -= v;
+            v++;
+        }
+        if (v < nNodes) {
+            edges.emplace_back((int) v, (int) w);
+        }
+    }
+    return edges;
+}
+
+/**
+ * Create the adjacency matrix of a list of edges, self-loops are dropped
+ * @param nNodes No. of nodes in the graph, raised if an edge references a bigger id
+ * @param edges
+ * @return
+ */
+vector<vector<bool>> GraphMat::fromEdges(int nNodes, const vector<pair<int, int>>& edges) {
+    TRACE_SCOPE("matrix build");
+    for (auto [u, v]: edges) {
+        nNodes = max(nNodes, max(u, v) + 1);
+    }
+    vector<vector<bool>> graph(nNodes, vector<bool>(nNodes, false));
+    for (auto [u, v]: edges) {
+        if (u == v) continue;
+        graph[u][v] = true;
+        graph[v][u] = true;
+    }
+    return graph;
+}
+
 //Extra part not delivered by deadline
 
 /**
  * Precompute the intersection for all couple of node
  * @param graph
+ * @param control cancellation, deadline and progress in pairs of nodes, may be null
  * @return
  */
-vector<vector<int>> GraphMat::precomputeIntersection(const vector<vector<bool>> &graph) {
-    auto start = chrono::high_resolution_clock::now();
+vector<vector<int>> GraphMat::precomputeIntersection(const vector<vector<bool>> &graph, Control* control) {
+    TRACE_SCOPE("precompute");
     vector<vector<int>> allInts(graph.size(), vector<int>(graph.size()));
+    if (control) control->start(getPairs(graph.size()));
 
-    #pragma omp parallel for num_threads(2) schedule(dynamic) shared(graph, allInts) default(none)
+    #pragma omp parallel for num_threads(2) schedule(dynamic) shared(graph, allInts, control) default(none)
     for (int i = 0; i < graph.size(); i++) {
+        if (control && control->isStopped()) continue;
         for (int j = i+1; j < graph.size(); j++) {
             int count = 0;
             for (int z = 0; z < graph.size(); z++) {
@@ -228,27 +343,29 @@ vector<vector<int>> GraphMat::precomputeIntersection(const vector<vector<bool>>
             allInts[i][j] = count;
             allInts[j][i] = count;
         }
+        if (control) control->advance((long long) graph.size() - i - 1);
     }
-
-    auto end = chrono::high_resolution_clock::now();
-    auto elapsed = chrono::duration_cast<chrono::milliseconds> (end - start);
-    cout << "All intersection computation: " << elapsed.count() << " ms." << endl;
     return allInts;
 }
 
 /**
  * Same sequential algorithm but with constant time for intersection
  * @param graph
+ * @param control cancellation, deadline and progress in pairs of nodes, may be null
  * @return
  */
-int GraphMat::ctTr_edgeFast_seq(const vector<vector<bool>> &graph, const vector<vector<int>>& allInts) {
+int GraphMat::ctTr_edgeFast_seq(const vector<vector<bool>> &graph, const vector<vector<int>>& allInts, Control* control) {
     int count = 0;
+    if (control) control->start(getPairs(graph.size()));
     // Loop through all edges
-    for (int i = 0; i < graph.size(); i++)
+    for (int i = 0; i < graph.size(); i++) {
+        if (control && control->isStopped()) break;
         for (int j = i + 1; j < graph.size(); j++)
             if (graph[i][j]){
                 count += allInts[i][j];
             }
+        if (control) control->advance((long long) graph.size() - i - 1);
+    }
     // Return the total count of triangles/3, to subtract duplicates
     return count/3;
 }
@@ -257,19 +374,24 @@ int GraphMat::ctTr_edgeFast_seq(const vector<vector<bool>> &graph, const vector<
  * Same parallelized algorithm but with constant time for intersection
  * @param graph
  * @param nThreads
+ * @param control cancellation, deadline and progress in pairs of nodes, may be null
  * @return
  */
-int GraphMat::ctTr_edgeFast_multi(const vector<vector<bool>> &graph, int nThreads, const vector<vector<int>>& allInts) {
+int GraphMat::ctTr_edgeFast_multi(const vector<vector<bool>> &graph, int nThreads, const vector<vector<int>>& allInts,
+                                  Control* control) {
     int count = 0;
+    if (control) control->start(getPairs(graph.size()));
 
     // Loop through all edges in parallel
-    #pragma omp parallel for num_threads(nThreads) reduction(+:count) schedule(dynamic) shared(graph, allInts) default(none)
+    #pragma omp parallel for num_threads(nThreads) reduction(+:count) schedule(dynamic) shared(graph, allInts, control) default(none)
     for (int i = 0; i < graph.size(); i++) {
+        if (control && control->isStopped()) continue;
         for (int j = i + 1; j < graph.size(); j++) {
             if (graph[i][j]) {
                 count += allInts[i][j];
             }
         }
+        if (control) control->advance((long long) graph.size() - i - 1);
     }
     // Return the total count of triangles/3, to subtract duplicates
     return count / 3;
@@ -282,12 +404,19 @@ int GraphMat::ctTr_edgeFast_multi(const vector<vector<bool>> &graph, int nThread
 // this way we skip all the 0s, this is useful especially if we have large sparse graph
 // we still need the adjacency matrix for the intersection (in the end it will be the same thing)
 // complexity O(#edges * #nodes), which in worst case would still be n^3 but at least we don't check useless cells
-int GraphMat::better_algo(const vector<vector<bool>>& graph, const vector<pair<int, int>>& all_edges){
+int GraphMat::better_algo(const vector<vector<bool>>& graph, const vector<pair<int, int>>& all_edges, Control* control){
     int count = 0;
+    if (control) control->start((long long) all_edges.size());
 
     // Loop through all existent edges
-    for (auto [x,y]: all_edges) {
-        count += getIntersection(graph[x], graph[y], x, y);
+    for (size_t first = 0; first < all_edges.size(); first += CONTROL_BLOCK) {
+        if (control && control->isStopped()) break;
+        size_t last = min(all_edges.size(), first + CONTROL_BLOCK);
+        for (size_t e = first; e < last; e++) {
+            auto [x, y] = all_edges[e];
+            count += getIntersection(graph[x], graph[y], x, y);
+        }
+        if (control) control->advance((long long) (last - first));
     }// since each edge is repeated only once (if A-B, then there is no B-A in the list), there is no need to sort the list and check if x<y
 
     // Return the total count of triangles/3, to subtract duplicates
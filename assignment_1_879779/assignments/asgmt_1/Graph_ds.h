@@ -1,29 +1,37 @@
 #ifndef LEARNING_MASSIVE_DATA_GRAPH_DS_H
 #define LEARNING_MASSIVE_DATA_GRAPH_DS_H
 
-#include <vector>
+#include "Control.h"
 
-using namespace std;
+#include <vector>
+#include <string>
+#include <utility>
 
 class GraphMat {
     public:
-    static int countTriangles_node_seq(const vector<vector<bool>>& graph);
-    static int countTriangles_edge_seq(const vector<vector<bool>>& graph);
+    static int countTriangles_node_seq(const std::vector<std::vector<bool>>& graph, Control* control = nullptr);
+    static int countTriangles_edge_seq(const std::vector<std::vector<bool>>& graph, Control* control = nullptr);
 
-    static int countTriangles_node_multi(const vector<vector<bool>>& graph, int nThreads);
-    static int countTriangles_edge_multi(const vector<vector<bool>>& graph, int nThreads);
+    static int countTriangles_node_multi(const std::vector<std::vector<bool>>& graph, int nThreads, Control* control = nullptr);
+    static int countTriangles_edge_multi(const std::vector<std::vector<bool>>& graph, int nThreads, Control* control = nullptr);
 
-    static vector<vector<bool>> getGraph_dense(int nNodes, double density);
-    static vector<vector<bool>> getGraph(int nNodes, const string& path);
+    static std::vector<std::vector<bool>> getGraph_dense(int nNodes, double density);
+    static std::vector<std::vector<bool>> getGraph(int nNodes, const std::string& path);
+    static std::vector<std::pair<int, int>> getEdges(const std::string& path, int nThreads = 1);
+    static std::vector<std::pair<int, int>> getEdges_dense(int nNodes, double density, unsigned seed);
+    static std::vector<std::vector<bool>> fromEdges(int nNodes, const std::vector<std::pair<int, int>>& edges);
 
-    static vector<vector<int>> precomputeIntersection(const vector<vector<bool>>& graph);
-    static int ctTr_edgeFast_seq(const vector<vector<bool>>& graph, const vector<vector<int>>& allInts);
-    static int ctTr_edgeFast_multi(const vector<vector<bool>>& graph, int nThreads, const vector<vector<int>>& allInts);
+    static std::vector<std::vector<int>> precomputeIntersection(const std::vector<std::vector<bool>>& graph, Control* control = nullptr);
+    static int ctTr_edgeFast_seq(const std::vector<std::vector<bool>>& graph, const std::vector<std::vector<int>>& allInts,
+                                 Control* control = nullptr);
+    static int ctTr_edgeFast_multi(const std::vector<std::vector<bool>>& graph, int nThreads, const std::vector<std::vector<int>>& allInts,
+                                   Control* control = nullptr);
 
-    static int better_algo(const vector<vector<bool>>& graph, const vector<pair<int, int>>& all_edges);
+    static int better_algo(const std::vector<std::vector<bool>>& graph, const std::vector<std::pair<int, int>>& all_edges,
+                           Control* control = nullptr);
 
     private:
-    static int getIntersection(const vector<bool>& nodeARow, const vector<bool>& nodeBCol, int nodeA, int nodeB);
+    static int getIntersection(const std::vector<bool>& nodeARow, const std::vector<bool>& nodeBCol, int nodeA, int nodeB);
 };
 
 #endif
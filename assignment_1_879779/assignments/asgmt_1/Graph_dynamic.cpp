@@ -0,0 +1,235 @@
+#include "Graph_dynamic.h"
+#include "RadixSort.h"
+
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+static uint64_t getKey(int u, int v) {
+    if (u > v) swap(u, v);
+    return RadixSort::pack(u, v);
+}
+
+/**
+ * Position of v in the sorted row of u
+ */
+static size_t getPosition(const vector<int>& row, int v) {
+    return lower_bound(row.begin(), row.end(), v) - row.begin();
+}
+
+DynamicGraph::DynamicGraph(int nNodes) : adj(nNodes), support(nNodes), local(nNodes, 0) {}
+
+/**
+ * Build the graph and its counts by inserting all the edges as a single batch
+ * @param nNodes No. of nodes in the graph, raised if an edge references a bigger id
+ * @param edges
+ * @param nThreads
+ */
+DynamicGraph::DynamicGraph(int nNodes, const vector<pair<int, int>>& edges, int nThreads) : DynamicGraph(nNodes) {
+    applyBatch(edges, {}, nThreads);
+}
+
+void DynamicGraph::ensureNode(int node) {
+    if (node >= adj.size()) {
+        adj.resize(node + 1);
+        support.resize(node + 1);
+        local.resize(node + 1, 0);
+    }
+}
+
+bool DynamicGraph::hasEdge(int u, int v) const {
+    if (u < 0 || v < 0 || u >= adj.size() || v >= adj.size()) return false;
+    return binary_search(adj[u].begin(), adj[u].end(), v);
+}
+
+long long DynamicGraph::getLocalTriangles(int node) const {
+    return node < local.size() ? local[node] : 0;
+}
+
+/**
+ * @return No. of triangles the edge (u, v) belongs to, 0 if it is not an edge
+ */
+long long DynamicGraph::getEdgeTriangles(int u, int v) const {
+    if (!hasEdge(u, v)) return 0;
+    return support[u][getPosition(adj[u], v)];
+}
+
+/**
+ * Canonical sorted keys of the edges of a batch, without self-loops and duplicates.
+ * @param batch
+ * @param present keep only the edges that are already in the graph (deletions) or only the ones that are not (insertions)
+ * @param nThreads
+ * @return
+ */
+vector<uint64_t> DynamicGraph::normalize(const vector<pair<int, int>>& batch, bool present, int nThreads) const {
+    vector<uint64_t> keys;
+    keys.reserve(batch.size());
+    for (auto [u, v]: batch) {
+        if (u != v && hasEdge(u, v) == present) keys.push_back(getKey(u, v));
+    }
+    RadixSort::sort(keys, nThreads);
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+// A triangle can contain up to three edges of the same batch, and each of them would find it.
+// It is only counted by the smallest of its batch edges, so every edge of a batch can be processed in parallel
+// against the graph that contains the whole batch (insertions: after adding it, deletions: before removing it).
+/**
+ * Add (op = +1) or remove (op = -1) the triangles that contain at least one edge of the batch
+ * @param batch sorted canonical keys, all in the graph
+ * @param op
+ * @param nThreads
+ */
+void DynamicGraph::updateCounts(const vector<uint64_t>& batch, int op, int nThreads) {
+    long long found = 0;
+
+    #pragma omp parallel for num_threads(nThreads) reduction(+:found) schedule(dynamic, 16) shared(batch, op) default(none)
+    for (size_t e = 0; e < batch.size(); e++) {
+        int u = (int) (batch[e] >> 32), v = (int) (uint32_t) batch[e];
+        const vector<int>& rowU = adj[u];
+        const vector<int>& rowV = adj[v];
+        auto isCountedBefore = [&batch, e](uint64_t key) {
+            return key < batch[e] && binary_search(batch.begin(), batch.end(), key);
+        };
+
+        long long edgeFound = 0;
+        size_t i = 0, j = 0;
+        while (i < rowU.size() && j < rowV.size()) {
+            if (rowU[i] < rowV[j]) {
+                i++;
+            } else if (rowV[j] < rowU[i]) {
+                j++;
+            } else {
+                int w = rowU[i];
+                if (!isCountedBefore(getKey(u, w)) && !isCountedBefore(getKey(v, w))) {
+                    size_t wu = getPosition(adj[w], u), wv = getPosition(adj[w], v);
+                    #pragma omp atomic
+                    support[u][i] += op;
+                    #pragma omp atomic
+                    support[v][j] += op;
+                    #pragma omp atomic
+                    support[w][wu] += op;
+                    #pragma omp atomic
+                    support[w][wv] += op;
+                    #pragma omp atomic
+                    local[w] += op;
+                    edgeFound++;
+                }
+                i++;
+                j++;
+            }
+        }
+
+        if (edgeFound > 0) {
+            size_t uv = getPosition(rowU, v), vu = getPosition(rowV, u);
+            #pragma omp atomic
+            support[u][uv] += op * edgeFound;
+            #pragma omp atomic
+            support[v][vu] += op * edgeFound;
+            #pragma omp atomic
+            local[u] += op * edgeFound;
+            #pragma omp atomic
+            local[v] += op * edgeFound;
+        }
+        found += edgeFound;
+    }
+    triangles += op * found;
+}
+
+/**
+ * Group the endpoints of a batch by node: returns (node, neighbour) pairs sorted by node and the start of each group
+ */
+static pair<vector<pair<int, int>>, vector<size_t>> groupByNode(const vector<uint64_t>& batch) {
+    vector<pair<int, int>> halves;
+    halves.reserve(2 * batch.size());
+    for (uint64_t key: batch) {
+        int u = (int) (key >> 32), v = (int) (uint32_t) key;
+        halves.emplace_back(u, v);
+        halves.emplace_back(v, u);
+    }
+    sort(halves.begin(), halves.end());
+
+    vector<size_t> starts;
+    for (size_t i = 0; i < halves.size(); i++) {
+        if (i == 0 || halves[i].first != halves[i - 1].first) starts.push_back(i);
+    }
+    starts.push_back(halves.size());
+    return {halves, starts};
+}
+
+/**
+ * Merge the new neighbours in the sorted rows, with support 0. Rows are independent so they are merged in parallel.
+ */
+void DynamicGraph::insertEdges(const vector<uint64_t>& batch, int nThreads) {
+    auto [halves, starts] = groupByNode(batch);
+    size_t nGroups = starts.size() - 1;
+
+    #pragma omp parallel for num_threads(nThreads) schedule(dynamic, 16) shared(halves, starts, nGroups) default(none)
+    for (size_t g = 0; g < nGroups; g++) {
+        int u = halves[starts[g]].first;
+        vector<int> row;
+        vector<long long> rowSupport;
+        row.reserve(adj[u].size() + starts[g + 1] - starts[g]);
+        rowSupport.reserve(row.capacity());
+
+        size_t i = 0, j = starts[g];
+        while (i < adj[u].size() || j < starts[g + 1]) {
+            if (j == starts[g + 1] || (i < adj[u].size() && adj[u][i] < halves[j].second)) {
+                row.push_back(adj[u][i]);
+                rowSupport.push_back(support[u][i++]);
+            } else {
+                row.push_back(halves[j++].second);
+                rowSupport.push_back(0);
+            }
+        }
+        adj[u] = move(row);
+        support[u] = move(rowSupport);
+    }
+    nEdges += (long long) batch.size();
+}
+
+/**
+ * Drop the deleted neighbours from the rows, compacting them in place, in parallel over the rows
+ */
+void DynamicGraph::removeEdges(const vector<uint64_t>& batch, int nThreads) {
+    auto [halves, starts] = groupByNode(batch);
+    size_t nGroups = starts.size() - 1;
+
+    #pragma omp parallel for num_threads(nThreads) schedule(dynamic, 16) shared(halves, starts, nGroups) default(none)
+    for (size_t g = 0; g < nGroups; g++) {
+        int u = halves[starts[g]].first;
+        size_t write = 0, j = starts[g];
+        for (size_t i = 0; i < adj[u].size(); i++) {
+            while (j < starts[g + 1] && halves[j].second < adj[u][i]) j++;
+            if (j < starts[g + 1] && halves[j].second == adj[u][i]) continue;
+            adj[u][write] = adj[u][i];
+            support[u][write++] = support[u][i];
+        }
+        adj[u].resize(write);
+        support[u].resize(write);
+    }
+    nEdges -= (long long) batch.size();
+}
+
+/**
+ * Apply a batch of updates, the deletions first and then the insertions.
+ * Deletions of missing edges, insertions of existing edges, self-loops and duplicates are ignored.
+ * Each edge of the batch costs one intersection of the neighbourhoods of its endpoints.
+ * @param insertions
+ * @param deletions
+ * @param nThreads
+ */
+void DynamicGraph::applyBatch(const vector<pair<int, int>>& insertions, const vector<pair<int, int>>& deletions, int nThreads) {
+    vector<uint64_t> removed = normalize(deletions, true, nThreads);
+    updateCounts(removed, -1, nThreads);
+    removeEdges(removed, nThreads);
+
+    for (auto [u, v]: insertions) {
+        ensureNode(max(u, v));
+    }
+    vector<uint64_t> added = normalize(insertions, false, nThreads);
+    insertEdges(added, nThreads);
+    updateCounts(added, +1, nThreads);
+}
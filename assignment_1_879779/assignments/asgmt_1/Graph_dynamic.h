@@ -0,0 +1,41 @@
+#ifndef LEARNING_MASSIVE_DATA_GRAPH_DYNAMIC_H
+#define LEARNING_MASSIVE_DATA_GRAPH_DYNAMIC_H
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+/**
+ * Undirected graph that keeps its global, per-node and per-edge triangle counts exact
+ * while batches of edges are inserted and deleted.
+ */
+class DynamicGraph {
+    public:
+    explicit DynamicGraph(int nNodes = 0);
+    DynamicGraph(int nNodes, const std::vector<std::pair<int, int>>& edges, int nThreads);
+
+    void applyBatch(const std::vector<std::pair<int, int>>& insertions, const std::vector<std::pair<int, int>>& deletions, int nThreads);
+
+    bool hasEdge(int u, int v) const;
+    int getNumNodes() const { return (int) adj.size(); }
+    long long getNumEdges() const { return nEdges; }
+
+    long long getTriangles() const { return triangles; }
+    long long getLocalTriangles(int node) const;
+    long long getEdgeTriangles(int u, int v) const;
+
+    private:
+    std::vector<uint64_t> normalize(const std::vector<std::pair<int, int>>& batch, bool present, int nThreads) const;
+    void updateCounts(const std::vector<uint64_t>& batch, int op, int nThreads);
+    void insertEdges(const std::vector<uint64_t>& batch, int nThreads);
+    void removeEdges(const std::vector<uint64_t>& batch, int nThreads);
+    void ensureNode(int node);
+
+    std::vector<std::vector<int>> adj;            // sorted neighbours of each node
+    std::vector<std::vector<long long>> support;  // support[u][i]: triangles of the edge (u, adj[u][i])
+    std::vector<long long> local;                 // triangles of each node
+    long long triangles = 0;
+    long long nEdges = 0;
+};
+
+#endif
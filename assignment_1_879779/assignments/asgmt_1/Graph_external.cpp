@@ -0,0 +1,355 @@
+#include "Graph_external.h"
+#include "Graph_csr.h"
+#include "RadixSort.h"
+#include "ScratchDir.h"
+#include "Trace.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <queue>
+#include <future>
+#include <chrono>
+#include <memory>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+#define MIN_BUDGET (1 << 20) //smallest memory budget accepted, in bytes
+
+/**
+ * File opened read-only for sequential reads, closed when it goes out of scope so that no path leaks it
+ */
+class InputFile {
+    public:
+    explicit InputFile(const string& path) : fd(open(path.c_str(), O_RDONLY)) {
+        if (fd < 0) {
+            throw runtime_error("unable to open " + path + ": " + strerror(errno));
+        }
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    ~InputFile() { close(fd); }
+    InputFile(const InputFile&) = delete;
+    InputFile& operator=(const InputFile&) = delete;
+
+    int get() const { return fd; }
+
+    private:
+    int fd;
+};
+
+ExternalSorter::ExternalSorter(const string& dir, long long memoryBudget, int nThreads, ExternalStats& stats)
+        : dir(dir), capacity(max<long long>(memoryBudget / (long long) sizeof(uint64_t), 1024)), nThreads(nThreads),
+          stats(stats) {
+    buffer.reserve(capacity);
+}
+
+ExternalSorter::~ExternalSorter() {
+    for (const auto& run: runs) {
+        filesystem::remove(run);
+    }
+}
+
+void ExternalSorter::add(uint64_t key) {
+    buffer.push_back(key);
+    if (buffer.size() == capacity) spill();
+}
+
+/**
+ * Write the sorted buffer to a new run file, sorted in place so that the buffer is the whole memory budget
+ */
+void ExternalSorter::spill() {
+    RadixSort::sortInPlace(buffer, nThreads);
+    buffer.erase(unique(buffer.begin(), buffer.end()), buffer.end());
+
+    string run = dir + "/run_" + to_string(runs.size()) + ".bin";
+    ofstream out(run, ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char*>(buffer.data()), (streamsize) (buffer.size() * sizeof(uint64_t)));
+    if (!out) {
+        throw runtime_error("unable to write " + run);
+    }
+    stats.bytesWritten += (long long) (buffer.size() * sizeof(uint64_t));
+    runs.push_back(run);
+    buffer.clear();
+}
+
+/**
+ * Emit all the keys added so far in increasing order, each key once.
+ * The memory budget is split between the read buffers of the runs.
+ * @param emit
+ */
+void ExternalSorter::merge(const function<void(uint64_t)>& emit) {
+    if (runs.empty()) {
+        // Everything fit in memory, no need to go through the disk
+        RadixSort::sortInPlace(buffer, nThreads);
+        buffer.erase(unique(buffer.begin(), buffer.end()), buffer.end());
+        for (uint64_t key: buffer) emit(key);
+        buffer = vector<uint64_t>();
+        return;
+    }
+    if (!buffer.empty()) spill();
+    buffer = vector<uint64_t>();
+
+    struct Run {
+        unique_ptr<InputFile> file;
+        long long offset, size;
+        vector<uint64_t> keys;
+        size_t next;
+    };
+    size_t runKeys = max<size_t>(capacity / runs.size(), 512);
+    vector<Run> readers(runs.size());
+    for (int r = 0; r < runs.size(); r++) {
+        readers[r].file = make_unique<InputFile>(runs[r]);
+        readers[r].offset = 0;
+        readers[r].size = (long long) filesystem::file_size(runs[r]);
+        readers[r].next = 0;
+    }
+    auto refill = [&](Run& run) {
+        long long bytes = min<long long>((long long) (runKeys * sizeof(uint64_t)), run.size - run.offset);
+        run.keys.resize(bytes / sizeof(uint64_t));
+        GraphExternal::preadAll(run.file->get(), run.keys.data(), bytes, run.offset, stats);
+        run.offset += bytes;
+        run.next = 0;
+        return !run.keys.empty();
+    };
+
+    // Min-heap of (key, run) holding the smallest unread key of each run
+    priority_queue<pair<uint64_t, int>, vector<pair<uint64_t, int>>, greater<>> heap;
+    for (int r = 0; r < readers.size(); r++) {
+        if (refill(readers[r])) heap.emplace(readers[r].keys[readers[r].next++], r);
+    }
+
+    bool first = true;
+    uint64_t last = 0;
+    while (!heap.empty()) {
+        auto [key, r] = heap.top();
+        heap.pop();
+        if (first || key != last) emit(key);
+        first = false;
+        last = key;
+
+        Run& run = readers[r];
+        if (run.next < run.keys.size() || refill(run)) heap.emplace(run.keys[run.next++], r);
+    }
+}
+
+/**
+ * Read exactly bytes from the file at offset, retrying on short reads
+ */
+void GraphExternal::preadAll(int fd, void* buffer, long long bytes, long long offset, ExternalStats& stats) {
+    char* out = static_cast<char*>(buffer);
+    while (bytes > 0) {
+        ssize_t n = pread(fd, out, bytes, offset);
+        if (n <= 0) {
+            throw runtime_error("short read from graph file");
+        }
+        out += n;
+        bytes -= n;
+        offset += n;
+        stats.bytesRead += n;
+    }
+}
+
+// External-memory version of the forward algorithm (MGT, Hu et al. / Chu & Cheng):
+//  1. the canonical edges (u < v) are sorted and deduplicated on disk, computing the degrees;
+//  2. every edge is oriented from the lower to the higher (degree, id) node and sorted again,
+//     writing the out-neighbour lists of the degree-ordered DAG to one adjacency file;
+//  3. the adjacency file is cut in chunks of consecutive nodes that fit in half of the budget; for each chunk,
+//     the whole file is scanned sequentially and every u->v with v in the chunk adds |N+(u) ∩ N+(v)|.
+// Each triangle u->v->w is counted once, when the chunk of v is in memory. The scan reads blocks of nodes
+// with pread while the previous block is being intersected (double buffering), so disk and CPU overlap.
+// Only the node offsets (8 bytes per node) have to stay in memory besides the budget.
+/**
+ * Count the triangles of the graph in the file of edges without loading the whole graph in memory
+ * @param path Path of the file containing all the edges of the graph
+ * @param memoryBudget bytes used by the sort buffers, the in-memory chunk and the read-ahead blocks
+ * @param nThreads threads intersecting the nodes of a block in parallel
+ * @param tmpDir directory where to create the directory of the sorted runs and the adjacency file, removed at the end
+ * @param stats counters updated while counting
+ * @param checkpoint saves the passes and the nodes of the current pass scanned so far and skips those of the run
+ * it resumes, may be nullptr. The adjacency file is rebuilt when resuming.
+ * @return No. of triangles in graph, of the work done so far if the checkpoint stopped it
+ */
+long long GraphExternal::countTriangles_external(const string& path, long long memoryBudget, int nThreads,
+                                                 const string& tmpDir, ExternalStats& stats, Checkpoint* checkpoint) {
+    if (memoryBudget < MIN_BUDGET) {
+        throw invalid_argument("memory budget must be at least " + to_string(MIN_BUDGET) + " bytes");
+    }
+    ifstream inputFile (path);
+    if (!inputFile.is_open()) {
+        throw runtime_error("unable to open " + path);
+    }
+    CheckpointState saved;
+    if (checkpoint != nullptr) {
+        saved = checkpoint->start(Checkpoint::getRun("external", path, memoryBudget));
+        if (saved.total > 0 && saved.done == saved.total) return saved.count; // finished before being stopped
+    }
+    ScratchDir scratch(tmpDir, "triangles_ext_");
+    const string& dir = scratch.getPath();
+
+    // 1. Canonical edges sorted on disk, degrees computed during the merge
+    vector<int> degree;
+    long long nEdges = 0;
+    {
+        TRACE_SCOPE("external sort");
+        ExternalSorter sorter(dir, memoryBudget, nThreads, stats);
+        string line;
+        while (getline(inputFile, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            char* end;
+            long u = strtol(line.c_str(), &end, 10);
+            char* endV;
+            long v = strtol(end, &endV, 10);
+            if (end == line.c_str() || endV == end || u == v) continue; // not an edge or self-loop
+            if (u > v) swap(u, v);
+            sorter.add(RadixSort::pack((int) u, (int) v));
+        }
+        inputFile.close();
+
+        ofstream out(dir + "/edges.bin", ios::binary | ios::trunc);
+        sorter.merge([&](uint64_t key) {
+            int u = (int) (key >> 32), v = (int) (uint32_t) key;
+            if (v >= degree.size()) degree.resize(v + 1, 0);
+            degree[u]++;
+            degree[v]++;
+            out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+            nEdges++;
+        });
+        stats.bytesWritten += nEdges * (long long) sizeof(uint64_t);
+    }
+    int nNodes = (int) degree.size();
+
+    // 2. Orient the edges by degree and write the out-neighbour lists, the offsets stay in memory
+    vector<long long> offsets(nNodes + 1, 0);
+    {
+        TRACE_SCOPE("reorder");
+        // A quarter of the budget reads the sorted edges back, the rest is the sort buffer
+        long long readBudget = memoryBudget / 4;
+        ExternalSorter sorter(dir, memoryBudget - readBudget, nThreads, stats);
+        // The file and the read buffer are released before the merge
+        {
+            InputFile edges(dir + "/edges.bin");
+            vector<uint64_t> keys(max<long long>(readBudget / (long long) sizeof(uint64_t), 1024));
+            for (long long read = 0; read < nEdges; ) {
+                long long n = min<long long>((long long) keys.size(), nEdges - read);
+                preadAll(edges.get(), keys.data(), n * (long long) sizeof(uint64_t), read * (long long) sizeof(uint64_t), stats);
+                for (long long i = 0; i < n; i++) {
+                    int u = (int) (keys[i] >> 32), v = (int) (uint32_t) keys[i];
+                    if (degree[v] < degree[u] || (degree[v] == degree[u] && v < u)) swap(u, v);
+                    sorter.add(RadixSort::pack(u, v));
+                }
+                read += n;
+            }
+        }
+        filesystem::remove(dir + "/edges.bin");
+
+        ofstream out(dir + "/adj.bin", ios::binary | ios::trunc);
+        sorter.merge([&](uint64_t key) {
+            int v = (int) (uint32_t) key;
+            offsets[(key >> 32) + 1]++;
+            out.write(reinterpret_cast<const char*>(&v), sizeof(v));
+        });
+        stats.bytesWritten += nEdges * (long long) sizeof(int);
+        for (int u = 0; u < nNodes; u++) {
+            offsets[u + 1] += offsets[u];
+        }
+    }
+    degree = vector<int>();
+
+    // 3. Chunks of consecutive nodes whose lists fit in half of the budget, blocks of an eighth for the scan
+    long long chunkInts = memoryBudget / 2 / (long long) sizeof(int);
+    long long blockInts = memoryBudget / 8 / (long long) sizeof(int);
+    auto nextRange = [&offsets, nNodes](int first, long long maxInts) {
+        int last = first + 1; // a node with a longer list than maxInts gets a range on its own
+        while (last < nNodes && offsets[last + 1] - offsets[first] <= maxInts) last++;
+        return last;
+    };
+    vector<pair<int, int>> chunks;
+    for (int first = 0; first < nNodes; first = chunks.back().second) {
+        chunks.emplace_back(first, nextRange(first, chunkInts));
+    }
+    stats.nPasses = (int) chunks.size();
+    long long nChunks = (long long) chunks.size();
+    if (saved.total > 0 && (saved.total != nChunks || saved.next > nNodes)) {
+        throw runtime_error("the checkpoint does not match the passes of the graph");
+    }
+
+    // Declared before the read-ahead futures, whose destructors wait for the read in flight before it is closed
+    InputFile adjacency(dir + "/adj.bin");
+
+    struct Block {
+        int first = 0, last = 0;
+        vector<int> data;
+    };
+    auto readBlock = [&](int first, vector<int> data) {
+        Block block;
+        block.first = first;
+        block.last = first < nNodes ? nextRange(first, blockInts) : first;
+        data.resize(offsets[block.last] - offsets[first]);
+        preadAll(adjacency.get(), data.data(), (long long) (data.size() * sizeof(int)), offsets[first] * (long long) sizeof(int), stats);
+        block.data = move(data);
+        return block;
+    };
+
+    long long count = saved.count;
+    bool stopped = false;
+    vector<int> chunk;
+    for (int pass = (int) saved.done; pass < chunks.size(); pass++) {
+        TRACE_SCOPE("pass");
+        auto [lo, hi] = chunks[pass];
+        stats.pass = pass + 1;
+        chunk.resize(offsets[hi] - offsets[lo]);
+        preadAll(adjacency.get(), chunk.data(), (long long) (chunk.size() * sizeof(int)), offsets[lo] * (long long) sizeof(int), stats);
+        const int* inChunk = chunk.data() - offsets[lo];
+
+        int start = pass == saved.done ? (int) saved.next : 0;
+        future<Block> next = async(launch::async, readBlock, start, vector<int>());
+        while (true) {
+            auto waitStart = chrono::high_resolution_clock::now();
+            Block block = next.get();
+            auto waitEnd = chrono::high_resolution_clock::now();
+            stats.ioWaitMicros += chrono::duration_cast<chrono::microseconds> (waitEnd - waitStart).count();
+            if (block.first == block.last) break;
+            next = async(launch::async, readBlock, block.last, vector<int>());
+
+            const int* inBlock = block.data.data() - offsets[block.first];
+            #pragma omp parallel for num_threads(nThreads) reduction(+:count) schedule(dynamic, 64) shared(block, offsets, inBlock, inChunk, lo, hi) default(none)
+            for (int u = block.first; u < block.last; u++) {
+                const int* first = inBlock + offsets[u];
+                const int* last = inBlock + offsets[u + 1];
+                // Only the out-neighbours of u that are in the chunk, lists are sorted by id
+                for (const int* v = lower_bound(first, last, lo); v < last && *v < hi; v++) {
+                    count += GraphCSR::getIntersection(first, last, inChunk + offsets[*v], inChunk + offsets[*v + 1]);
+                }
+            }
+
+            stats.computeMicros += chrono::duration_cast<chrono::microseconds> (chrono::high_resolution_clock::now() - waitEnd).count();
+            stats.progress = (pass + (double) offsets[block.last] / max<long long>(nEdges, 1)) / (double) chunks.size();
+            if (checkpoint != nullptr && checkpoint->update({nChunks, pass, block.last, count})) {
+                stopped = true;
+                break;
+            }
+        }
+        if (stopped) break;
+        cout << "Pass " << pass + 1 << "/" << chunks.size() << ", bytes read: " << stats.bytesRead << endl;
+    }
+    if (stopped) {
+        return count;
+    }
+    if (checkpoint != nullptr) {
+        checkpoint->finish({nChunks, nChunks, 0, count});
+    }
+    stats.progress = 1;
+
+    cout << "I/O wait: " << stats.ioWaitMicros / 1000 << " ms, intersections: " << stats.computeMicros / 1000 << " ms." << endl;
+
+    return count;
+}
@@ -0,0 +1,58 @@
+#ifndef LEARNING_MASSIVE_DATA_GRAPH_EXTERNAL_H
+#define LEARNING_MASSIVE_DATA_GRAPH_EXTERNAL_H
+
+#include "Checkpoint.h"
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+/**
+ * Counters of an out-of-core count, updated while it runs so that they can be polled from another thread.
+ * If ioWaitMicros dominates computeMicros the count is I/O-bound.
+ */
+struct ExternalStats {
+    std::atomic<long long> bytesRead {0};
+    std::atomic<long long> bytesWritten {0};
+    std::atomic<long long> ioWaitMicros {0};   // time spent waiting for the read-ahead of the adjacency file
+    std::atomic<long long> computeMicros {0};  // time spent intersecting
+    std::atomic<int> pass {0};
+    std::atomic<int> nPasses {0};
+    std::atomic<double> progress {0};          // fraction of the counting phase completed
+};
+
+/**
+ * Sort of 64-bit keys that do not fit in memory: runs of at most memoryBudget bytes are radix sorted in place,
+ * spilled to disk and merged at the end, dropping the duplicated keys.
+ */
+class ExternalSorter {
+    public:
+    ExternalSorter(const std::string& dir, long long memoryBudget, int nThreads, ExternalStats& stats);
+    ~ExternalSorter();
+
+    void add(uint64_t key);
+    void merge(const std::function<void(uint64_t)>& emit);
+
+    private:
+    void spill();
+
+    std::string dir;
+    size_t capacity;
+    int nThreads;               // of the in-memory sort of each run
+    std::vector<uint64_t> buffer;
+    std::vector<std::string> runs;
+    ExternalStats& stats;
+};
+
+class GraphExternal {
+    public:
+    static long long countTriangles_external(const std::string& path, long long memoryBudget, int nThreads,
+                                             const std::string& tmpDir, ExternalStats& stats,
+                                             Checkpoint* checkpoint = nullptr);
+
+    static void preadAll(int fd, void* buffer, long long bytes, long long offset, ExternalStats& stats);
+};
+
+#endif
@@ -0,0 +1,194 @@
+#include "Graph_partition.h"
+#include "Graph_csr.h"
+#include "ScratchDir.h"
+#include "Trace.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * Color of a node, given by a hash of its id so that colors are balanced whatever the numbering of the input
+ * @param node
+ * @param nColors
+ * @return color in [0, nColors)
+ */
+int GraphPartition::getColor(int node, int nColors) {
+    uint64_t x = (uint64_t) (uint32_t) node;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (int) (x % (uint64_t) nColors);
+}
+
+/**
+ * Index of the bucket holding the edges between two colors, one bucket for each unordered pair (diagonal included)
+ * @param colorA
+ * @param colorB
+ * @param nColors
+ * @return bucket index in [0, nColors*(nColors+1)/2)
+ */
+int GraphPartition::getBucket(int colorA, int colorB, int nColors) {
+    if (colorA > colorB) swap(colorA, colorB);
+    return colorA * nColors - colorA * (colorA - 1) / 2 + (colorB - colorA);
+}
+
+/**
+ * Load the edges of some buckets from disk
+ * @param dir directory holding the bucket files
+ * @param buckets
+ * @return all the edges of the buckets
+ */
+vector<pair<int, int>> GraphPartition::readBuckets(const string& dir, const vector<int>& buckets) {
+    vector<pair<int, int>> edges;
+    for (int bucket: buckets) {
+        string file = dir + "/" + to_string(bucket) + ".bin";
+        if (!filesystem::exists(file)) continue; // no edge between the two colors
+        size_t nEdges = filesystem::file_size(file) / (2 * sizeof(int));
+        size_t first = edges.size();
+        edges.resize(first + nEdges);
+
+        ifstream in(file, ios::binary);
+        in.read(reinterpret_cast<char*>(edges.data() + first), (streamsize) (nEdges * 2 * sizeof(int)));
+    }
+    return edges;
+}
+
+// Every node gets one of c colors. A triangle whose nodes have the color set S (|S| = 1, 2 or 3) is contained
+// in the induced subgraph of every color set T ⊇ S with |T| <= 3, so counting the triangles t(T) of each of these
+// c(c+1)(c+2)/6 subgraphs and combining them with inclusion-exclusion counts each triangle exactly once:
+//    total = sum_{|T|=3} t(T) - (c-3) * sum_{|T|=2} t(T) + (1 + (c-1)(c-4)/2) * sum_{|T|=1} t(T)
+// A subgraph on 3 colors holds about 9/c^2 of the edges, so c is the knob that bounds the peak memory.
+/**
+ * Count the triangles of the graph in the file of edges one color subgraph at a time.
+ * The file is streamed once to split the edges by the colors of their nodes in binary bucket files,
+ * then each subgraph is loaded from the buckets and counted exactly with the forward algorithm.
+ * @param path Path of the file containing all the edges of the graph
+ * @param nColors No. of colors, the peak memory is about 9/nColors^2 of the whole graph
+ * @param nThreads threads used by the counting of each subgraph
+ * @param tmpDir directory where to create the directory of the buckets, removed at the end
+ * @param checkpoint saves the subgraphs counted so far and skips those of the run it resumes, may be nullptr
+ * @return No. of triangles in graph, of the subgraphs counted so far if the checkpoint stopped it
+ */
+long long GraphPartition::countTriangles_colorful(const string& path, int nColors, int nThreads, const string& tmpDir,
+                                                  Checkpoint* checkpoint) {
+    if (nColors < 1) {
+        throw invalid_argument("number of colors must be positive");
+    }
+    ifstream inputFile (path);
+    if (!inputFile.is_open()) {
+        throw runtime_error("unable to open " + path);
+    }
+
+    // The color sets of the subgraphs, in the order of the checkpoint units
+    vector<vector<int>> subgraphs;
+    for (int a = 0; a < nColors; a++) {
+        subgraphs.push_back({a});
+        for (int b = a + 1; b < nColors; b++) {
+            subgraphs.push_back({a, b});
+            for (int c = b + 1; c < nColors; c++) {
+                subgraphs.push_back({a, b, c});
+            }
+        }
+    }
+    CheckpointState saved;
+    if (checkpoint != nullptr) {
+        saved = checkpoint->start(Checkpoint::getRun("colorful", path, nColors));
+        if (saved.done == (long long) subgraphs.size()) return saved.count; // finished before being stopped
+    }
+
+    ScratchDir scratch(tmpDir, "triangles_");
+    const string& dir = scratch.getPath();
+
+    // Split the edges in the buckets, appending to the bucket file whenever its buffer is full
+    int nBuckets = nColors * (nColors + 1) / 2;
+    long long nEdges = 0;
+    {
+        TRACE_SCOPE("split");
+        vector<vector<int>> buffers(nBuckets);
+        auto flush = [&dir, &buffers](int bucket) {
+            ofstream out(dir + "/" + to_string(bucket) + ".bin", ios::binary | ios::app);
+            out.write(reinterpret_cast<const char*>(buffers[bucket].data()), (streamsize) (buffers[bucket].size() * sizeof(int)));
+            buffers[bucket].clear();
+        };
+
+        string line;
+        while (getline(inputFile, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            char* end;
+            long u = strtol(line.c_str(), &end, 10);
+            char* endV;
+            long v = strtol(end, &endV, 10);
+            if (end == line.c_str() || endV == end || u == v) continue; // not an edge or self-loop
+
+            if (u > v) swap(u, v); // A-B and B-A end up in the same bucket and are merged by the CSR build
+            int bucket = getBucket(getColor((int) u, nColors), getColor((int) v, nColors), nColors);
+            buffers[bucket].push_back((int) u);
+            buffers[bucket].push_back((int) v);
+            if (buffers[bucket].size() >= 2 * BUCKET_BUFFER_EDGES) flush(bucket);
+            nEdges++;
+        }
+        inputFile.close();
+        for (int bucket = 0; bucket < nBuckets; bucket++) {
+            if (!buffers[bucket].empty()) flush(bucket);
+        }
+    }
+
+    // Weights of the subgraphs by number of colors, see the comment above
+    long long weights[4] = {0, 1 + (long long) (nColors - 1) * (nColors - 4) / 2, -(long long) (nColors - 3), 1};
+    long long count = saved.count;
+    size_t maxSubgraphEdges = 0;
+
+    auto countSubgraph = [&](const vector<int>& colors) {
+        long long weight = weights[colors.size()];
+        if (weight == 0) return;
+        TRACE_SCOPE("subgraph");
+
+        vector<int> buckets;
+        for (int i = 0; i < colors.size(); i++)
+            for (int j = i; j < colors.size(); j++)
+                buckets.push_back(getBucket(colors[i], colors[j], nColors));
+        vector<pair<int, int>> edges = readBuckets(dir, buckets);
+        maxSubgraphEdges = max(maxSubgraphEdges, edges.size());
+
+        // Relabel the nodes of the subgraph to [0, n) so the CSR is as small as the subgraph
+        vector<int> nodes;
+        nodes.reserve(2 * edges.size());
+        for (auto [u, v]: edges) {
+            nodes.push_back(u);
+            nodes.push_back(v);
+        }
+        sort(nodes.begin(), nodes.end());
+        nodes.erase(unique(nodes.begin(), nodes.end()), nodes.end());
+        for (auto& [u, v]: edges) {
+            u = (int) (lower_bound(nodes.begin(), nodes.end(), u) - nodes.begin());
+            v = (int) (lower_bound(nodes.begin(), nodes.end(), v) - nodes.begin());
+        }
+
+        CSR dag = GraphCSR::orientByDegree(GraphCSR::fromEdges((int) nodes.size(), edges));
+        count += weight * GraphCSR::countTriangles_forward_multi(dag, nThreads);
+    };
+
+    for (long long i = saved.done; i < (long long) subgraphs.size(); i++) {
+        countSubgraph(subgraphs[i]);
+        if (checkpoint != nullptr && checkpoint->update({(long long) subgraphs.size(), i + 1, 0, count})) {
+            return count;
+        }
+    }
+    if (checkpoint != nullptr) {
+        checkpoint->finish({(long long) subgraphs.size(), (long long) subgraphs.size(), 0, count});
+    }
+    cout << "number of edges: " << nEdges << ", largest subgraph: " << maxSubgraphEdges << " edges" << endl;
+
+    return count;
+}
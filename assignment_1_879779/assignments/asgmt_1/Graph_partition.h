@@ -0,0 +1,24 @@
+#ifndef LEARNING_MASSIVE_DATA_GRAPH_PARTITION_H
+#define LEARNING_MASSIVE_DATA_GRAPH_PARTITION_H
+
+#include "Checkpoint.h"
+
+#include <vector>
+#include <string>
+#include <utility>
+
+#define BUCKET_BUFFER_EDGES 8192 //edges kept in memory for each bucket before appending them to its file
+
+class GraphPartition {
+    public:
+    static long long countTriangles_colorful(const std::string& path, int nColors, int nThreads, const std::string& tmpDir,
+                                             Checkpoint* checkpoint = nullptr);
+
+    static int getColor(int node, int nColors);
+
+    private:
+    static int getBucket(int colorA, int colorB, int nColors);
+    static std::vector<std::pair<int, int>> readBuckets(const std::string& dir, const std::vector<int>& buckets);
+};
+
+#endif
@@ -0,0 +1,335 @@
+#include "Graph_reader.h"
+#include "Graph_ds.h"
+#include "Decompress.h"
+#include "Trace.h"
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <bit>
+#include <cctype>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+#define MATRIX_MARKET_BANNER "%%MatrixMarket" //first word of a Matrix Market file
+
+static mutex registryLock;
+
+static string toLower(string text) {
+    transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char) tolower(c); });
+    return text;
+}
+
+
+/**
+ * Next line that is not a comment (starting with the comment character), false at the end of the file
+ */
+static bool getDataLine(istream& in, string& line, char comment) {
+    while (getline(in, line)) {
+        if (line.empty() || line[0] != comment) return true;
+    }
+    return false;
+}
+
+/**
+ * Matrix Market header: banner, comments and the size line "rows cols entries"
+ * @return the stream, at the first entry
+ */
+static ifstream openMatrixMarket(const string& path, long long& nRows, long long& nCols, long long& nEntries) {
+    ifstream in(path);
+    string line;
+    if (!getline(in, line) || line.rfind(MATRIX_MARKET_BANNER, 0) != 0) {
+        throw runtime_error(path + " is not a Matrix Market file");
+    }
+    stringstream banner(toLower(line));
+    string word, object, layout;
+    banner >> word >> object >> layout;
+    if (object != "matrix" || layout != "coordinate") {
+        throw runtime_error(path + ": only Matrix Market coordinate matrices are graphs, not " + object + " " + layout);
+    }
+    if (!getDataLine(in, line, '%') || !(stringstream(line) >> nRows >> nCols >> nEntries)) {
+        throw runtime_error(path + ": missing the size line of the Matrix Market file");
+    }
+    return in;
+}
+
+/**
+ * Matrix Market coordinate file, entry "i j" is the edge (i - 1) - (j - 1) whatever its value
+ * @param path
+ * @param nNodes raised to the larger dimension of the matrix
+ * @param nThreads of the CSR build
+ * @return
+ */
+CSR GraphReader::readMatrixMarket(const string& path, int nNodes, int nThreads) {
+    TRACE_SCOPE("parse");
+    long long nRows, nCols, nEntries;
+    ifstream in = openMatrixMarket(path, nRows, nCols, nEntries);
+    vector<pair<int, int>> edges;
+    edges.reserve(nEntries);
+    string line;
+    while ((long long) edges.size() < nEntries && getDataLine(in, line, '%')) {
+        char* end;
+        long i = strtol(line.c_str(), &end, 10);
+        char* endJ;
+        long j = strtol(end, &endJ, 10);
+        if (end == line.c_str() || endJ == end) continue; // blank line
+        if (i < 1 || j < 1 || i > nRows || j > nCols) {
+            throw runtime_error(path + ": entry " + to_string(edges.size() + 1) + " is outside of the matrix");
+        }
+        edges.emplace_back((int) i - 1, (int) j - 1);
+    }
+    if ((long long) edges.size() < nEntries) {
+        throw runtime_error(path + " is truncated, " + to_string(edges.size()) + " of " + to_string(nEntries) + " entries");
+    }
+    return GraphCSR::fromEdges(max<int>(nNodes, (int) max(nRows, nCols)), edges, nThreads);
+}
+
+/**
+ * METIS adjacency file: header "n m [fmt [ncon]]", then one line per node with its 1-based neighbours, preceded
+ * by its size (fmt 1xx) and its ncon weights (fmt x1x), each neighbour followed by the weight of the edge (fmt xx1).
+ * Weights are skipped, an empty line is a node without neighbours.
+ * @param path
+ * @param nNodes raised to n
+ * @param nThreads of the CSR build
+ * @return
+ */
+CSR GraphReader::readMetis(const string& path, int nNodes, int nThreads) {
+    TRACE_SCOPE("parse");
+    ifstream in(path);
+    if (!in.is_open()) {
+        throw runtime_error("unable to open " + path);
+    }
+    string line;
+    long long n = 0, m = 0;
+    string fmt = "000";
+    int ncon = 0;
+    if (!getDataLine(in, line, '%')) {
+        throw runtime_error(path + " is empty");
+    }
+    stringstream header(line);
+    if (!(header >> n >> m)) {
+        throw runtime_error(path + ": bad METIS header \"" + line + "\"");
+    }
+    if (header >> fmt) {
+        fmt = string(3 - min<size_t>(fmt.size(), 3), '0') + fmt;
+        header >> ncon;
+    }
+    bool sizes = fmt[0] == '1', nodeWeights = fmt[1] == '1', edgeWeights = fmt[2] == '1';
+    if (nodeWeights && ncon == 0) ncon = 1;
+    int skip = (sizes ? 1 : 0) + (nodeWeights ? ncon : 0);
+
+    vector<pair<int, int>> edges;
+    edges.reserve(2 * m);
+    long long u = 0;
+    while (u < n && getline(in, line)) {
+        if (!line.empty() && line[0] == '%') continue;
+        const char* at = line.c_str();
+        for (int field = 0; ; field++) {
+            char* end;
+            long value = strtol(at, &end, 10);
+            if (end == at) break;
+            at = end;
+            if (field < skip) continue;
+            if (edgeWeights && (field - skip) % 2 == 1) continue;
+            if (value < 1 || value > n) {
+                throw runtime_error(path + ": node " + to_string(u + 1) + " has neighbour " + to_string(value) + " outside of 1.." + to_string(n));
+            }
+            edges.emplace_back((int) u, (int) value - 1);
+        }
+        u++;
+    }
+    if (u < n) {
+        throw runtime_error(path + " is truncated, " + to_string(u) + " of " + to_string(n) + " nodes");
+    }
+    return GraphCSR::fromEdges(max<int>(nNodes, (int) n), edges, nThreads);
+}
+
+/**
+ * Raw little-endian int32 (u, v) pairs. The file is mapped and the CSR is built straight from the mapping,
+ * without a copy of the edges.
+ * @param path
+ * @param nNodes raised if an edge has a larger id
+ * @param nThreads of the CSR build
+ * @return
+ */
+CSR GraphReader::readBinary(const string& path, int nNodes, int nThreads) {
+    TRACE_SCOPE("map");
+    if constexpr (endian::native != endian::little) {
+        throw runtime_error("binary edge lists are little-endian, this host is not");
+    }
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("unable to open " + path);
+    }
+    struct stat info {};
+    fstat(fd, &info);
+    long long size = info.st_size;
+    if (size % (2 * sizeof(int32_t)) != 0) {
+        close(fd);
+        throw runtime_error(path + ": " + to_string(size) + " bytes is not a whole number of int32 pairs");
+    }
+    if (size == 0) {
+        close(fd);
+        return GraphCSR::fromEdges(nNodes, vector<pair<int, int>>(), nThreads);
+    }
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        throw runtime_error("unable to map " + path);
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    const auto* pairs = (const int32_t*) mapped;
+    try {
+        CSR graph = GraphCSR::fromEdges(nNodes, pairs, pairs + 1, size / (long long) (2 * sizeof(int32_t)), 2, nThreads);
+        munmap(mapped, size);
+        return graph;
+    } catch (...) {
+        munmap(mapped, size);
+        throw;
+    }
+}
+
+/**
+ * SNAP text edge list, gzip or zstd compressed too, see GraphMat::getEdges
+ */
+CSR GraphReader::readSnap(const string& path, int nNodes, int nThreads) {
+    return GraphCSR::fromEdges(nNodes, GraphMat::getEdges(path, nThreads), nThreads);
+}
+
+/**
+ * Built-in formats, in the order they are detected
+ */
+vector<GraphFormat>& GraphReader::getRegistry() {
+    static vector<GraphFormat> registry = {
+            {"snapshot", {".csr", ".snapshot"},
+             [](const string& head) { return head.rfind("TRICSR01", 0) == 0; },
+             [](const string& path, int, int) { return GraphCSR::loadSnapshot(path); },
+             [](const string& path, long long& nNodes, long long& nEdges) {
+                 int n;
+                 long long nNeighbors;
+                 GraphCSR::getSnapshotSize(path, n, nNeighbors);
+                 nNodes = n;
+                 nEdges = nNeighbors / 2;
+                 return true;
+             }},
+            {"matrix-market", {".mtx", ".mm"},
+             [](const string& head) { return head.rfind(MATRIX_MARKET_BANNER, 0) == 0; },
+             readMatrixMarket,
+             [](const string& path, long long& nNodes, long long& nEdges) {
+                 long long nRows, nCols;
+                 openMatrixMarket(path, nRows, nCols, nEdges);
+                 nNodes = max(nRows, nCols);
+                 return true;
+             }},
+            {"metis", {".graph", ".metis"}, nullptr, readMetis,
+             [](const string& path, long long& nNodes, long long& nEdges) {
+                 ifstream in(path);
+                 string line;
+                 return getDataLine(in, line, '%') && (bool) (stringstream(line) >> nNodes >> nEdges);
+             }},
+            // Text never has a NUL byte, a binary list of ids below 2^24 has one in every int32
+            {"binary", {".bin", ".i32"},
+             [](const string& head) { return head.find('\0') != string::npos; },
+             readBinary,
+             [](const string& path, long long& nNodes, long long& nEdges) {
+                 nNodes = 0;
+                 nEdges = (long long) filesystem::file_size(path) / (long long) (2 * sizeof(int32_t));
+                 return true;
+             }},
+            {"snap", {".txt", ".edges", ".tsv"}, nullptr, readSnap, nullptr}};
+    return registry;
+}
+
+/**
+ * Add a format, or replace the one with the same name. Formats are detected in the order they were added.
+ */
+void GraphReader::registerFormat(const GraphFormat& format) {
+    lock_guard<mutex> guard(registryLock);
+    vector<GraphFormat>& registry = getRegistry();
+    auto it = find_if(registry.begin(), registry.end(), [&format](const GraphFormat& f) { return f.name == format.name; });
+    if (it != registry.end()) *it = format;
+    else registry.push_back(format);
+}
+
+vector<string> GraphReader::getFormats() {
+    lock_guard<mutex> guard(registryLock);
+    vector<string> names;
+    for (const GraphFormat& format: getRegistry()) names.push_back(format.name);
+    return names;
+}
+
+const GraphFormat& GraphReader::getFormat(const string& name) {
+    for (const GraphFormat& format: getRegistry()) {
+        if (format.name == name) return format;
+    }
+    throw invalid_argument("unknown graph format " + name);
+}
+
+/**
+ * Format of a file: the first whose content detector recognises its first bytes (snapshot magic, Matrix Market
+ * banner, NUL bytes of binary ids), then the first that claims its extension, otherwise snap. A gzip or zstd file
+ * is recognised from its decompressed first bytes and the extension before .gz or .zst.
+ * @param path
+ * @return name of the format
+ */
+string GraphReader::detectFormat(const string& path) {
+    string head = Decompress::readHead(path, READER_HEAD_BYTES);
+    string extension = toLower(filesystem::path(Decompress::stripExtension(path)).extension().string());
+    lock_guard<mutex> guard(registryLock);
+    for (const GraphFormat& format: getRegistry()) {
+        if (format.detect && format.detect(head)) return format.name;
+    }
+    for (const GraphFormat& format: getRegistry()) {
+        if (find(format.extensions.begin(), format.extensions.end(), extension) != format.extensions.end()) return format.name;
+    }
+    return "snap";
+}
+
+/**
+ * Read a graph file into the undirected CSR: self-loops and duplicates are dropped, both directions stored
+ * @param path
+ * @param format name of a registered format, or auto to detect it
+ * @param nNodes at least this many nodes, raised by the header or by the edges of the file
+ * @param nThreads of the CSR build
+ * @return
+ */
+CSR GraphReader::read(const string& path, const string& format, int nNodes, int nThreads) {
+    string name = format == "auto" ? detectFormat(path) : format;
+    Compression compression = Decompress::detect(path);
+    if (compression != COMPRESSION_NONE && name != "snap") {
+        throw runtime_error(path + ": only SNAP edge lists are read " + Decompress::getName(compression) + " compressed, not " + name);
+    }
+    function<CSR(const string&, int, int)> reader;
+    {
+        lock_guard<mutex> guard(registryLock);
+        reader = getFormat(name).read;
+    }
+    return reader(path, nNodes, nThreads);
+}
+
+/**
+ * Size of the graph of a file from its header, before reading it
+ * @return false if the format has no header with the size (snap) or the file is compressed
+ */
+bool GraphReader::getSize(const string& path, const string& format, long long& nNodes, long long& nEdges) {
+    if (Decompress::detect(path) != COMPRESSION_NONE) return false;
+    string name = format == "auto" ? detectFormat(path) : format;
+    function<bool(const string&, long long&, long long&)> getter;
+    {
+        lock_guard<mutex> guard(registryLock);
+        getter = getFormat(name).getSize;
+    }
+    return getter && getter(path, nNodes, nEdges);
+}
@@ -0,0 +1,51 @@
+#ifndef LEARNING_MASSIVE_DATA_GRAPH_READER_H
+#define LEARNING_MASSIVE_DATA_GRAPH_READER_H
+
+#include "Graph_csr.h"
+
+#include <vector>
+#include <string>
+#include <functional>
+
+#define READER_HEAD_BYTES 4096 //bytes of a file given to the detectors
+
+/**
+ * A file format of graphs: how to recognise it and how to read it into a CSR
+ */
+struct GraphFormat {
+    std::string name;
+    std::vector<std::string> extensions;                           // with the dot, lower case
+    std::function<bool(const std::string& head)> detect;           // first READER_HEAD_BYTES bytes, may be empty
+    std::function<CSR(const std::string& path, int nNodes, int nThreads)> read;
+    std::function<bool(const std::string& path, long long& nNodes, long long& nEdges)> getSize; // from the header
+};
+
+/**
+ * Registry of the graph file formats. Built in:
+ *   snapshot        binary CSR written by GraphCSR::saveSnapshot
+ *   matrix-market   Matrix Market coordinate file (.mtx), 1-based "i j [value]" entries, any field and symmetry
+ *   metis           METIS adjacency file (.graph, .metis): "n m [fmt [ncon]]", then the 1-based neighbours of each node
+ *   binary          raw little-endian int32 (u, v) pairs (.bin), read in place through mmap
+ *   snap            SNAP text edge list, one "u v" per line, '#' comments, also gzip or zstd compressed
+ * Every reader but the snapshot one builds the CSR with GraphCSR::fromEdges.
+ */
+class GraphReader {
+    public:
+    static void registerFormat(const GraphFormat& format);
+    static std::vector<std::string> getFormats();
+
+    static std::string detectFormat(const std::string& path);
+    static CSR read(const std::string& path, const std::string& format = "auto", int nNodes = 0, int nThreads = 1);
+    static bool getSize(const std::string& path, const std::string& format, long long& nNodes, long long& nEdges);
+
+    static CSR readMatrixMarket(const std::string& path, int nNodes, int nThreads);
+    static CSR readMetis(const std::string& path, int nNodes, int nThreads);
+    static CSR readBinary(const std::string& path, int nNodes, int nThreads);
+    static CSR readSnap(const std::string& path, int nNodes, int nThreads);
+
+    private:
+    static std::vector<GraphFormat>& getRegistry();
+    static const GraphFormat& getFormat(const std::string& name);
+};
+
+#endif
@@ -0,0 +1,282 @@
+#include "Graph_roaring.h"
+#include "Trace.h"
+
+#include <vector>
+#include <algorithm>
+#include <bit>
+
+using namespace std;
+
+/**
+ * Call f(id) for each id of a container, in order
+ */
+template<typename F>
+static void forEach(const RoaringGraph& graph, const Container& c, F f) {
+    int high = (int) c.key << 16;
+    if (c.type == CONTAINER_ARRAY) {
+        for (uint32_t i = 0; i < c.size; i++) f(high | graph.values[c.offset + i]);
+    } else if (c.type == CONTAINER_RUN) {
+        for (uint32_t r = 0; r < c.size; r++) {
+            int start = graph.values[c.offset + 2 * r], length = graph.values[c.offset + 2 * r + 1];
+            for (int low = start; low <= start + length; low++) f(high | low);
+        }
+    } else {
+        for (int w = 0; w < ROARING_BITMAP_WORDS; w++) {
+            for (uint64_t word = graph.words[c.offset + w]; word; word &= word - 1) {
+                f(high | (w << 6 | countr_zero(word)));
+            }
+        }
+    }
+}
+
+/**
+ * Bits [first, last] of a bitmap that are set
+ */
+static long long countRange(const uint64_t* bitmap, int first, int last) {
+    int firstWord = first >> 6, lastWord = last >> 6;
+    uint64_t firstMask = ~0ULL << (first & 63), lastMask = ~0ULL >> (63 - (last & 63));
+    if (firstWord == lastWord) return popcount(bitmap[firstWord] & firstMask & lastMask);
+    long long count = popcount(bitmap[firstWord] & firstMask) + popcount(bitmap[lastWord] & lastMask);
+    for (int w = firstWord + 1; w < lastWord; w++) count += popcount(bitmap[w]);
+    return count;
+}
+
+static bool testBit(const uint64_t* bitmap, int low) {
+    return (bitmap[low >> 6] >> (low & 63)) & 1;
+}
+
+/**
+ * Store the ids [first, last) of a row that share the key as the smallest container
+ */
+void GraphRoaring::addContainer(RoaringGraph& graph, uint16_t key, const int* first, const int* last) {
+    Container c;
+    c.key = key;
+    c.cardinality = (uint32_t) (last - first);
+    uint32_t nRuns = 0;
+    for (const int* at = first; at < last; at++) {
+        if (at == first || *at != at[-1] + 1) nRuns++;
+    }
+
+    long long arrayBytes = 2LL * c.cardinality, bitmapBytes = 8LL * ROARING_BITMAP_WORDS, runBytes = 4LL * nRuns;
+    if (runBytes < min(arrayBytes, bitmapBytes)) {
+        c.type = CONTAINER_RUN;
+        c.size = nRuns;
+        c.offset = graph.values.size();
+        for (const int* at = first; at < last; at++) {
+            if (at == first || *at != at[-1] + 1) {
+                graph.values.push_back((uint16_t) *at);
+                graph.values.push_back(0);
+            } else {
+                graph.values.back()++;
+            }
+        }
+    } else if (arrayBytes <= bitmapBytes) {
+        c.type = CONTAINER_ARRAY;
+        c.size = c.cardinality;
+        c.offset = graph.values.size();
+        for (const int* at = first; at < last; at++) graph.values.push_back((uint16_t) *at);
+    } else {
+        c.type = CONTAINER_BITMAP;
+        c.size = ROARING_BITMAP_WORDS;
+        c.offset = graph.words.size();
+        graph.words.resize(graph.words.size() + ROARING_BITMAP_WORDS, 0);
+        for (const int* at = first; at < last; at++) {
+            int low = *at & 0xffff;
+            graph.words[c.offset + (low >> 6)] |= 1ULL << (low & 63);
+        }
+    }
+    graph.containers.push_back(c);
+}
+
+/**
+ * Convert the rows of a DAG (GraphCSR::orientByDegree) to Roaring bitmaps
+ * @param dag
+ * @return
+ */
+RoaringGraph GraphRoaring::fromDag(const CSR& dag) {
+    TRACE_SCOPE("roaring build");
+    RoaringGraph graph;
+    graph.nNodes = dag.nNodes;
+    graph.nNeighbors = (long long) dag.neighbors.size();
+    graph.rows.assign(dag.nNodes + 1, 0);
+    for (int u = 0; u < dag.nNodes; u++) {
+        const int* first = dag.neighbors.data() + dag.offsets[u];
+        const int* end = dag.neighbors.data() + dag.offsets[u + 1];
+        while (first < end) {
+            uint16_t key = (uint16_t) (*first >> 16);
+            const int* last = lower_bound(first, end, ((int) key + 1) << 16);
+            addContainer(graph, key, first, last);
+            first = last;
+        }
+        graph.rows[u + 1] = graph.containers.size();
+    }
+    graph.containers.shrink_to_fit();
+    graph.values.shrink_to_fit();
+    graph.words.shrink_to_fit();
+    return graph;
+}
+
+void GraphRoaring::getRowCounts(const RoaringGraph& graph, long long& arrays, long long& bitmaps, long long& runs) {
+    arrays = bitmaps = runs = 0;
+    for (const Container& c: graph.containers) {
+        arrays += c.type == CONTAINER_ARRAY;
+        bitmaps += c.type == CONTAINER_BITMAP;
+        runs += c.type == CONTAINER_RUN;
+    }
+}
+
+/**
+ * Cardinality of the intersection of two containers with the same key, for each pair of types
+ */
+long long GraphRoaring::intersect(const RoaringGraph& graph, const Container& a, const Container& b) {
+    if (a.type > b.type) return intersect(graph, b, a); // array < bitmap < run
+    const uint16_t* values = graph.values.data();
+    const uint64_t* words = graph.words.data();
+    long long count = 0;
+
+    if (a.type == CONTAINER_ARRAY && b.type == CONTAINER_ARRAY) {
+        const uint16_t *x = values + a.offset, *xEnd = x + a.size, *y = values + b.offset, *yEnd = y + b.size;
+        while (x < xEnd && y < yEnd) {
+            if (*x < *y) x++;
+            else if (*y < *x) y++;
+            else {
+                count++;
+                x++;
+                y++;
+            }
+        }
+    } else if (a.type == CONTAINER_ARRAY && b.type == CONTAINER_BITMAP) {
+        for (uint32_t i = 0; i < a.size; i++) count += testBit(words + b.offset, values[a.offset + i]);
+    } else if (a.type == CONTAINER_ARRAY) {
+        // array and runs, both sorted
+        const uint16_t *x = values + a.offset, *xEnd = x + a.size;
+        for (uint32_t r = 0; r < b.size && x < xEnd; r++) {
+            int start = values[b.offset + 2 * r], end = start + values[b.offset + 2 * r + 1];
+            while (x < xEnd && *x < start) x++;
+            while (x < xEnd && *x <= end) {
+                count++;
+                x++;
+            }
+        }
+    } else if (a.type == CONTAINER_BITMAP && b.type == CONTAINER_BITMAP) {
+        for (int w = 0; w < ROARING_BITMAP_WORDS; w++) count += popcount(words[a.offset + w] & words[b.offset + w]);
+    } else if (a.type == CONTAINER_BITMAP) {
+        for (uint32_t r = 0; r < b.size; r++) {
+            int start = values[b.offset + 2 * r];
+            count += countRange(words + a.offset, start, start + values[b.offset + 2 * r + 1]);
+        }
+    } else {
+        // runs and runs: overlap of the intervals
+        uint32_t i = 0, j = 0;
+        while (i < a.size && j < b.size) {
+            int aStart = values[a.offset + 2 * i], aEnd = aStart + values[a.offset + 2 * i + 1];
+            int bStart = values[b.offset + 2 * j], bEnd = bStart + values[b.offset + 2 * j + 1];
+            count += max(0, min(aEnd, bEnd) - max(aStart, bStart) + 1);
+            if (aEnd < bEnd) i++;
+            else j++;
+        }
+    }
+    return count;
+}
+
+/**
+ * Size of the intersection of the rows of u and v, container by container, without building it
+ */
+long long GraphRoaring::getIntersectionCardinality(const RoaringGraph& graph, int u, int v) {
+    uint64_t i = graph.rows[u], iEnd = graph.rows[u + 1], j = graph.rows[v], jEnd = graph.rows[v + 1];
+    long long count = 0;
+    while (i < iEnd && j < jEnd) {
+        const Container& a = graph.containers[i];
+        const Container& b = graph.containers[j];
+        if (a.key < b.key) i++;
+        else if (b.key < a.key) j++;
+        else {
+            count += intersect(graph, a, b);
+            i++;
+            j++;
+        }
+    }
+    return count;
+}
+
+/**
+ * Set (or clear) the ids of a container in a bitmap over all the ids
+ */
+void GraphRoaring::setDense(const RoaringGraph& graph, const Container& c, ArenaVector<uint64_t>& dense, bool on) {
+    uint64_t* chunk = dense.data() + (size_t) c.key * ROARING_BITMAP_WORDS;
+    if (!on) {
+        if (c.type == CONTAINER_BITMAP || c.cardinality > ROARING_BITMAP_WORDS) {
+            fill(chunk, chunk + ROARING_BITMAP_WORDS, 0);
+        } else {
+            forEach(graph, c, [chunk](int id) { chunk[(id & 0xffff) >> 6] = 0; });
+        }
+    } else if (c.type == CONTAINER_BITMAP) {
+        copy(graph.words.begin() + (long) c.offset, graph.words.begin() + (long) c.offset + ROARING_BITMAP_WORDS, chunk);
+    } else {
+        forEach(graph, c, [chunk](int id) { chunk[(id & 0xffff) >> 6] |= 1ULL << (id & 63); });
+    }
+}
+
+/**
+ * Ids of a container that are set in a bitmap over all the ids
+ */
+long long GraphRoaring::intersectDense(const RoaringGraph& graph, const ArenaVector<uint64_t>& dense, const Container& c) {
+    const uint64_t* chunk = dense.data() + (size_t) c.key * ROARING_BITMAP_WORDS;
+    long long count = 0;
+    if (c.type == CONTAINER_ARRAY) {
+        const uint16_t* values = graph.values.data() + c.offset;
+        for (uint32_t i = 0; i < c.size; i++) count += testBit(chunk, values[i]);
+    } else if (c.type == CONTAINER_BITMAP) {
+        const uint64_t* words = graph.words.data() + c.offset;
+        for (int w = 0; w < ROARING_BITMAP_WORDS; w++) count += popcount(chunk[w] & words[w]);
+    } else {
+        for (uint32_t r = 0; r < c.size; r++) {
+            int start = graph.values[c.offset + 2 * r];
+            count += countRange(chunk, start, start + graph.values[c.offset + 2 * r + 1]);
+        }
+    }
+    return count;
+}
+
+/**
+ * Forward algorithm on the Roaring rows: the row of u is expanded once into a bitmap of the thread over all the
+ * ids, then each container of each out-neighbour v is tested against it (bit tests for arrays, AND + popcount
+ * for bitmaps, masked popcount for runs), so no intersection is ever built and no branch depends on the data
+ * @param graph
+ * @param nThreads
+ * @param control cancellation, deadline and progress in nodes, may be null
+ * @return No. of triangles in graph, of the blocks of nodes counted before a stop
+ */
+long long GraphRoaring::countTriangles_forward(const RoaringGraph& graph, int nThreads, Control* control) {
+    long long count = 0;
+    size_t nChunks = ((size_t) graph.nNodes >> 16) + 1;
+    int nBlocks = (graph.nNodes + CONTROL_BLOCK - 1) / CONTROL_BLOCK;
+    if (control) control->start(graph.nNodes);
+
+    #pragma omp parallel num_threads(nThreads) reduction(+:count) shared(graph, nChunks, control, nBlocks) default(none)
+    {
+        TRACE_SCOPE("count thread");
+        ArenaVector<uint64_t> dense(nChunks * ROARING_BITMAP_WORDS, 0);
+        #pragma omp for schedule(dynamic)
+        for (int block = 0; block < nBlocks; block++) {
+            if (control && control->isStopped()) continue;
+            int firstNode = block * CONTROL_BLOCK, lastNode = min(graph.nNodes, firstNode + CONTROL_BLOCK);
+            for (int u = firstNode; u < lastNode; u++) {
+                uint64_t first = graph.rows[u], last = graph.rows[u + 1];
+                if (first == last) continue;
+                for (uint64_t i = first; i < last; i++) setDense(graph, graph.containers[i], dense, true);
+
+                for (uint64_t i = first; i < last; i++) {
+                    forEach(graph, graph.containers[i], [&](int v) {
+                        for (uint64_t j = graph.rows[v]; j < graph.rows[v + 1]; j++) {
+                            count += intersectDense(graph, dense, graph.containers[j]);
+                        }
+                    });
+                }
+                for (uint64_t i = first; i < last; i++) setDense(graph, graph.containers[i], dense, false);
+            }
+            if (control) control->advance(lastNode - firstNode);
+        }
+    }
+    return count;
+}
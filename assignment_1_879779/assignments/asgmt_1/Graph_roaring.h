@@ -0,0 +1,56 @@
+#ifndef LEARNING_MASSIVE_DATA_GRAPH_ROARING_H
+#define LEARNING_MASSIVE_DATA_GRAPH_ROARING_H
+
+#include "Graph_csr.h"
+
+#include <vector>
+#include <cstdint>
+
+#define ROARING_ARRAY_MAX 4096 //values of an array container, denser chunks become bitmaps
+#define ROARING_BITMAP_WORDS 1024 //64-bit words of a bitmap container, one bit per id of the chunk
+
+enum ContainerType : uint8_t { CONTAINER_ARRAY, CONTAINER_BITMAP, CONTAINER_RUN };
+
+/**
+ * Ids of a row whose high 16 bits are key, as one of the Roaring containers:
+ * array: sorted low 16 bits, values[offset .. offset + size)
+ * bitmap: ROARING_BITMAP_WORDS words, words[offset ..)
+ * run: size (start, length - 1) pairs of low 16 bits, values[offset .. offset + 2 size)
+ */
+struct Container {
+    uint16_t key = 0;
+    ContainerType type = CONTAINER_ARRAY;
+    uint32_t cardinality = 0;
+    uint32_t size = 0;
+    uint64_t offset = 0;
+};
+
+/**
+ * Degree-ordered DAG whose rows are Roaring bitmaps: each row is split in chunks of 2^16 ids and each chunk is
+ * stored as the smallest of a sorted array, a bitmap or a list of runs
+ */
+struct RoaringGraph {
+    int nNodes = 0;
+    ArenaVector<uint64_t> rows;            // first container of each row, nNodes + 1
+    ArenaVector<Container> containers;
+    ArenaVector<uint16_t> values;          // array and run containers
+    ArenaVector<uint64_t> words;           // bitmap containers
+    long long nNeighbors = 0;
+};
+
+class GraphRoaring {
+    public:
+    static RoaringGraph fromDag(const CSR& dag);
+    static void getRowCounts(const RoaringGraph& graph, long long& arrays, long long& bitmaps, long long& runs);
+
+    static long long getIntersectionCardinality(const RoaringGraph& graph, int u, int v);
+    static long long countTriangles_forward(const RoaringGraph& graph, int nThreads, Control* control = nullptr);
+
+    private:
+    static void addContainer(RoaringGraph& graph, uint16_t key, const int* first, const int* last);
+    static long long intersect(const RoaringGraph& graph, const Container& a, const Container& b);
+    static long long intersectDense(const RoaringGraph& graph, const ArenaVector<uint64_t>& dense, const Container& c);
+    static void setDense(const RoaringGraph& graph, const Container& c, ArenaVector<uint64_t>& dense, bool on);
+};
+
+#endif
@@ -0,0 +1,239 @@
+#include "Graph_stream.h"
+
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+TriestFD::TriestFD(long long reservoirSize, bool local, uint64_t seed)
+        : reservoirSize(reservoirSize), local(local), gen(seed) {
+    if (reservoirSize < 3) {
+        throw invalid_argument("reservoir must hold at least 3 edges");
+    }
+}
+
+/**
+ * Key of an undirected edge, the same for (u, v) and (v, u)
+ */
+uint64_t TriestFD::getKey(int u, int v) {
+    if (u > v) swap(u, v);
+    return ((uint64_t) (uint32_t) u << 32) | (uint32_t) v;
+}
+
+/**
+ * Add (op = +1) or remove (op = -1) the triangles closed by the edge (u, v) in the sample.
+ * The common neighbours are found by scanning the smaller neighbourhood and looking the edges up.
+ */
+void TriestFD::updateCounters(int op, int u, int v) {
+    auto itU = neighbors.find(u);
+    auto itV = neighbors.find(v);
+    if (itU == neighbors.end() || itV == neighbors.end()) return;
+
+    const vector<int>& small = itU->second.size() < itV->second.size() ? itU->second : itV->second;
+    int other = itU->second.size() < itV->second.size() ? v : u;
+    long long found = 0;
+    for (int w: small) {
+        if (w != other && samplePos.count(getKey(w, other))) {
+            found++;
+            if (local) tauLocal[w] += op;
+        }
+    }
+    tau += op * found;
+    if (local && found > 0) {
+        tauLocal[u] += op * found;
+        tauLocal[v] += op * found;
+    }
+}
+
+void TriestFD::addToSample(uint64_t edge) {
+    int u = (int) (edge >> 32), v = (int) (uint32_t) edge;
+    samplePos[edge] = sample.size();
+    sample.push_back(edge);
+    neighbors[u].push_back(v);
+    neighbors[v].push_back(u);
+}
+
+void TriestFD::removeFromSample(uint64_t edge) {
+    int u = (int) (edge >> 32), v = (int) (uint32_t) edge;
+
+    // Swap with the last sampled edge so the removal is O(1)
+    size_t pos = samplePos[edge];
+    sample[pos] = sample.back();
+    samplePos[sample[pos]] = pos;
+    sample.pop_back();
+    samplePos.erase(edge);
+
+    auto unlink = [this](int a, int b) {
+        vector<int>& list = neighbors[a];
+        *find(list.begin(), list.end(), b) = list.back();
+        list.pop_back();
+        if (list.empty()) neighbors.erase(a);
+    };
+    unlink(u, v);
+    unlink(v, u);
+}
+
+/**
+ * Random pairing: while there are uncompensated deletions, a new edge takes the place of a deleted one
+ * (in the sample with probability d_i / (d_i + d_o)), otherwise it goes through reservoir sampling.
+ * @param edge
+ * @return true if the edge has been added to the sample
+ */
+bool TriestFD::sampleEdge(uint64_t edge) {
+    if (deletedIn + deletedOut == 0) {
+        if ((long long) sample.size() < reservoirSize) {
+            addToSample(edge);
+            return true;
+        }
+        if (uniform_real_distribution<double>(0, 1)(gen) < (double) reservoirSize / (double) nEdges) {
+            uint64_t evicted = sample[uniform_int_distribution<size_t>(0, sample.size() - 1)(gen)];
+            updateCounters(-1, (int) (evicted >> 32), (int) (uint32_t) evicted);
+            removeFromSample(evicted);
+            addToSample(edge);
+            return true;
+        }
+        return false;
+    }
+    if (uniform_real_distribution<double>(0, 1)(gen) < (double) deletedIn / (double) (deletedIn + deletedOut)) {
+        addToSample(edge);
+        deletedIn--;
+        return true;
+    }
+    deletedOut--;
+    return false;
+}
+
+/**
+ * Insert an edge of the stream. Self-loops and edges already in the sample are ignored.
+ * @param u
+ * @param v
+ */
+void TriestFD::insertEdge(int u, int v) {
+    uint64_t edge = getKey(u, v);
+    if (u == v || samplePos.count(edge)) return;
+
+    nEdges++;
+    if (sampleEdge(edge)) {
+        updateCounters(+1, u, v);
+    }
+}
+
+/**
+ * Delete an edge of the stream, which must have been inserted before
+ * @param u
+ * @param v
+ */
+void TriestFD::deleteEdge(int u, int v) {
+    if (u == v) return;
+    uint64_t edge = getKey(u, v);
+
+    nEdges--;
+    if (samplePos.count(edge)) {
+        updateCounters(-1, u, v);
+        removeFromSample(edge);
+        deletedIn++;
+    } else {
+        deletedOut++;
+    }
+}
+
+/**
+ * Factor turning the triangles of the sample into an unbiased estimate:
+ * 1/κ * s(s-1)(s-2) / (|S|(|S|-1)(|S|-2)), where κ is the probability that the sample holds at least 3 edges.
+ * @return
+ */
+double TriestFD::getScale() const {
+    long long sampled = (long long) sample.size();
+    if (sampled < 3) return 0;
+
+    long long d = deletedIn + deletedOut;
+    long long omega = min(reservoirSize, nEdges + d);
+    auto logBinomial = [](long long n, long long k) {
+        return lgamma((double) n + 1) - lgamma((double) k + 1) - lgamma((double) (n - k) + 1);
+    };
+
+    double kappa = 1;
+    for (long long j = 0; j <= 2; j++) {
+        if (j > nEdges || omega - j < 0 || omega - j > d) continue;
+        kappa -= exp(logBinomial(nEdges, j) + logBinomial(d, omega - j) - logBinomial(nEdges + d, omega));
+    }
+    if (kappa <= 0) return 0;
+
+    double s = (double) nEdges, m = (double) sampled;
+    return (s / m) * ((s - 1) / (m - 1)) * ((s - 2) / (m - 2)) / kappa;
+}
+
+/**
+ * @return estimate of the triangles in the graph of the stream so far
+ */
+double TriestFD::getGlobalEstimate() const {
+    return (double) tau * getScale();
+}
+
+/**
+ * @param node
+ * @return estimate of the triangles the node belongs to, 0 if the estimator was built without local counts
+ */
+double TriestFD::getLocalEstimate(int node) const {
+    auto it = tauLocal.find(node);
+    return it == tauLocal.end() ? 0 : (double) it->second * getScale();
+}
+
+/**
+ * @return estimate of the local triangles of every node with a non-zero estimate
+ */
+unordered_map<int, double> TriestFD::getLocalEstimates() const {
+    double scale = getScale();
+    unordered_map<int, double> estimates;
+    for (auto [node, count]: tauLocal) {
+        if (count != 0) estimates[node] = (double) count * scale;
+    }
+    return estimates;
+}
+
+/**
+ * Feed an edge stream to the estimator, one edge per line: "u v" or "+ u v" inserts the edge, "- u v" deletes it.
+ * Lines starting with '#' are skipped, so SNAP files can be streamed as they are.
+ * @param in file or stdin
+ * @param estimator
+ * @param reportEvery call report after this many edges, 0 to never call it
+ * @param report receives the number of edges consumed and the estimator to query
+ * @return No. of edges consumed
+ */
+long long TriestFD::consumeStream(FILE* in, TriestFD& estimator, long long reportEvery,
+                                  const function<void(long long, const TriestFD&)>& report) {
+    char* line = nullptr;
+    size_t capacity = 0;
+    long long consumed = 0;
+
+    while (getline(&line, &capacity, in) != -1) {
+        char* p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '#' || *p == '\n' || *p == '\0') continue;
+
+        bool deletion = false;
+        if (*p == '+' || *p == '-') {
+            deletion = *p == '-';
+            p++;
+        }
+        char* end;
+        long u = strtol(p, &end, 10);
+        char* endV;
+        long v = strtol(end, &endV, 10);
+        if (end == p || endV == end) continue; // not an edge
+
+        if (deletion) {
+            estimator.deleteEdge((int) u, (int) v);
+        } else {
+            estimator.insertEdge((int) u, (int) v);
+        }
+        consumed++;
+        if (reportEvery > 0 && report && consumed % reportEvery == 0) report(consumed, estimator);
+    }
+    free(line);
+    return consumed;
+}
@@ -0,0 +1,57 @@
+#ifndef LEARNING_MASSIVE_DATA_GRAPH_STREAM_H
+#define LEARNING_MASSIVE_DATA_GRAPH_STREAM_H
+
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <random>
+#include <functional>
+#include <unordered_map>
+
+/**
+ * TRIÈST-FD (De Stefani et al., KDD 2016): unbiased estimation of the global and per-node triangle counts
+ * of a fully dynamic edge stream, keeping at most reservoirSize edges in memory.
+ * While the stream has fewer edges than the reservoir the estimates are exact.
+ */
+class TriestFD {
+    public:
+    explicit TriestFD(long long reservoirSize, bool local = false, uint64_t seed = std::random_device{}());
+
+    void insertEdge(int u, int v);
+    void deleteEdge(int u, int v);
+
+    double getGlobalEstimate() const;
+    double getLocalEstimate(int node) const;
+    std::unordered_map<int, double> getLocalEstimates() const;
+
+    long long getNumEdges() const { return nEdges; }
+    long long getSampleSize() const { return (long long) sample.size(); }
+
+    static long long consumeStream(FILE* in, TriestFD& estimator, long long reportEvery = 0,
+                                   const std::function<void(long long, const TriestFD&)>& report = nullptr);
+
+    private:
+    bool sampleEdge(uint64_t edge);
+    void addToSample(uint64_t edge);
+    void removeFromSample(uint64_t edge);
+    void updateCounters(int op, int u, int v);
+    double getScale() const;
+
+    static uint64_t getKey(int u, int v);
+
+    long long reservoirSize;
+    bool local;
+    std::mt19937_64 gen;
+
+    long long nEdges = 0;        // s: edges currently in the graph
+    long long deletedIn = 0;     // d_i: uncompensated deletions of sampled edges
+    long long deletedOut = 0;    // d_o: uncompensated deletions of edges not in the sample
+    long long tau = 0;           // triangles in the sample
+    std::unordered_map<int, long long> tauLocal;
+
+    std::vector<uint64_t> sample;                            // sampled edges, for picking one at random
+    std::unordered_map<uint64_t, size_t> samplePos;          // position of each sampled edge in sample
+    std::unordered_map<int, std::vector<int>> neighbors;     // adjacency of the sample
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "Graph_truss.h"
+#include "Trace.h"
+
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * Number the undirected edges u < v in CSR order and give both directed entries of an edge its id
+ * @param graph
+ * @param edges filled with the endpoints of each id
+ * @return id of each entry of graph.neighbors
+ */
+vector<long long> GraphTruss::getEdgeIds(const CSR& graph, vector<pair<int, int>>& edges) {
+    vector<long long> ids(graph.neighbors.size());
+    edges.clear();
+    edges.reserve(graph.neighbors.size() / 2);
+    for (int u = 0; u < graph.nNodes; u++) {
+        for (long long i = graph.offsets[u]; i < graph.offsets[u + 1]; i++) {
+            int v = graph.neighbors[i];
+            if (u < v) {
+                ids[i] = (long long) edges.size();
+                edges.emplace_back(u, v);
+            } else {
+                // v < u was numbered in row v
+                auto first = graph.neighbors.begin() + graph.offsets[v], last = graph.neighbors.begin() + graph.offsets[v + 1];
+                ids[i] = ids[lower_bound(first, last, u) - graph.neighbors.begin()];
+            }
+        }
+    }
+    return ids;
+}
+
+/**
+ * Peeling algorithm: count the triangles of each edge (in parallel), then repeatedly remove the edge with the
+ * lowest support, decrementing the support of the two other edges of each of its triangles still in the graph.
+ * Edges are kept sorted by support with a bin sort, so the peeling is O(sum of the triangles of the edges).
+ * @param graph undirected graph, not oriented
+ * @param nThreads threads of the support count, the peeling is sequential
+ * @return
+ */
+Truss GraphTruss::decompose(const CSR& graph, int nThreads) {
+    TRACE_SCOPE("truss");
+    Truss truss;
+    vector<long long> ids = getEdgeIds(graph, truss.edges);
+    long long m = (long long) truss.edges.size();
+    const int* adj = graph.neighbors.data();
+    const vector<pair<int, int>>& edges = truss.edges;
+
+    vector<long long> support(m);
+    #pragma omp parallel for num_threads(nThreads) schedule(dynamic, 256) shared(graph, adj, edges, support, m) default(none)
+    for (long long e = 0; e < m; e++) {
+        auto [u, v] = edges[e];
+        support[e] = GraphCSR::getIntersection(adj + graph.offsets[u], adj + graph.offsets[u + 1],
+                                               adj + graph.offsets[v], adj + graph.offsets[v + 1]);
+    }
+
+    // Bin sort of the edges by support: order[start[s] ..] holds the edges of support s, position[e] is where e is
+    long long maxSupport = m > 0 ? *max_element(support.begin(), support.end()) : 0;
+    vector<long long> start(maxSupport + 2, 0), order(m), position(m);
+    for (long long e = 0; e < m; e++) start[support[e] + 1]++;
+    for (long long s = 0; s <= maxSupport; s++) start[s + 1] += start[s];
+    vector<long long> next(start.begin(), start.end() - 1);
+    for (long long e = 0; e < m; e++) {
+        position[e] = next[support[e]]++;
+        order[position[e]] = e;
+    }
+
+    // Move f to the front of its bin and shrink the bin, so f has support - 1 and stays sorted
+    auto decrement = [&](long long f) {
+        long long s = support[f], first = start[s], g = order[first];
+        swap(order[position[f]], order[first]);
+        swap(position[f], position[g]);
+        start[s]++;
+        support[f]--;
+    };
+
+    truss.trussness.assign(m, 2);
+    vector<char> removed(m, 0);
+    for (long long i = 0; i < m; i++) {
+        long long e = order[i];
+        auto [u, v] = edges[e];
+        truss.trussness[e] = (int) support[e] + 2;
+        truss.maxTruss = max(truss.maxTruss, truss.trussness[e]);
+        removed[e] = 1;
+
+        // Third node w of every triangle u, v, w left
+        long long a = graph.offsets[u], aEnd = graph.offsets[u + 1], b = graph.offsets[v], bEnd = graph.offsets[v + 1];
+        while (a < aEnd && b < bEnd) {
+            if (adj[a] < adj[b]) {
+                a++;
+            } else if (adj[b] < adj[a]) {
+                b++;
+            } else {
+                long long uw = ids[a], vw = ids[b];
+                if (!removed[uw] && !removed[vw]) {
+                    if (support[uw] > support[e]) decrement(uw);
+                    if (support[vw] > support[e]) decrement(vw);
+                }
+                a++;
+                b++;
+            }
+        }
+    }
+    if (m > 0 && truss.maxTruss < 2) truss.maxTruss = 2;
+    return truss;
+}
@@ -0,0 +1,27 @@
+#ifndef LEARNING_MASSIVE_DATA_GRAPH_TRUSS_H
+#define LEARNING_MASSIVE_DATA_GRAPH_TRUSS_H
+
+#include "Graph_csr.h"
+
+#include <vector>
+#include <utility>
+
+/**
+ * Truss decomposition: the trussness of an edge is the largest k such that the edge is in the k-truss, the
+ * largest subgraph where every edge belongs to at least k - 2 triangles of the subgraph.
+ */
+struct Truss {
+    std::vector<std::pair<int, int>> edges;  // undirected edges, u < v, in CSR order
+    std::vector<int> trussness;              // of each edge, 2 for the edges in no triangle
+    int maxTruss = 0;                        // 0 for a graph without edges
+};
+
+class GraphTruss {
+    public:
+    static Truss decompose(const CSR& graph, int nThreads);
+
+    private:
+    static std::vector<long long> getEdgeIds(const CSR& graph, std::vector<std::pair<int, int>>& edges);
+};
+
+#endif
@@ -0,0 +1,293 @@
+#include "Memory.h"
+#include "Arena.h"
+#include "Graph_partition.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include <cctype>
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace std;
+
+#define BUCKET_BYTES (BUCKET_BUFFER_EDGES * 2 * (long long) sizeof(int)) //buffer of each bucket of the colorful split
+#define SUBGRAPH_EDGE_BYTES 48 //edge list, relabelling and CSR of a colorful subgraph, for each of its edges
+
+void MemoryReport::addStructure(const string& name, long long bytes) {
+    structures.emplace_back(name, bytes);
+}
+
+/**
+ * Record the peak resident memory since the previous phase, then reset it for the next one
+ * @param name
+ */
+void MemoryReport::addPhase(const string& name) {
+    peaks.emplace_back(name, Memory::getPeakRss());
+    Memory::resetPeakRss();
+}
+
+/**
+ * Record how much of the graph arrays is in Arena regions and how much of the process is in huge pages
+ */
+void MemoryReport::addPages() {
+    regionBytes = Arena::getRegionBytes();
+    hugePageBytes = Memory::getHugePageBytes();
+}
+
+void MemoryReport::print(ostream& out) const {
+    out << "\nMemory:" << endl;
+    for (const auto& [name, bytes]: structures) {
+        out << "  " << name << ": " << Memory::format(bytes) << endl;
+    }
+    if (regionBytes > 0) {
+        out << "  arena regions (huge pages " << Arena::getName(Arena::getHugePages()) << "): " << Memory::format(regionBytes)
+            << ", in huge pages: " << Memory::format(hugePageBytes) << endl;
+    }
+    for (const auto& [name, bytes]: peaks) {
+        out << "  peak RSS during " << name << ": " << Memory::format(bytes) << endl;
+    }
+}
+
+/**
+ * Value in bytes of a "Name:   N kB" line of a /proc file
+ * @return -1 if the file or the line is missing
+ */
+static long long readProcKb(const string& path, const string& name) {
+    ifstream in(path);
+    string line;
+    while (getline(in, line)) {
+        if (line.rfind(name + ":", 0) == 0) {
+            return stoll(line.substr(name.size() + 1)) * 1024;
+        }
+    }
+    return -1;
+}
+
+long long Memory::getCurrentRss() {
+    return max(readProcKb("/proc/self/status", "VmRSS"), 0LL);
+}
+
+/**
+ * @return highest resident memory since the start of the process or the last resetPeakRss
+ */
+long long Memory::getPeakRss() {
+    long long peak = readProcKb("/proc/self/status", "VmHWM");
+    if (peak >= 0) return peak;
+
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;        // bytes
+#else
+    return usage.ru_maxrss * 1024; // kilobytes
+#endif
+}
+
+/**
+ * Reset the peak to the current resident memory (Linux 4.0+). Where it is not possible peaks are since the start.
+ */
+void Memory::resetPeakRss() {
+    ofstream clear("/proc/self/clear_refs");
+    if (clear.is_open()) clear << "5";
+}
+
+/**
+ * @return memory that can be allocated without swapping (MemAvailable), or the physical memory, 0 if unknown
+ */
+long long Memory::getAvailable() {
+    long long available = readProcKb("/proc/meminfo", "MemAvailable");
+    if (available >= 0) return available;
+
+    long pages = sysconf(_SC_PHYS_PAGES), pageSize = sysconf(_SC_PAGE_SIZE);
+    return pages > 0 && pageSize > 0 ? (long long) pages * pageSize : 0;
+}
+
+/**
+ * Anonymous memory of the process in transparent huge pages plus its explicit huge pages (Linux)
+ */
+long long Memory::getHugePageBytes() {
+    long long bytes = 0;
+    for (const char* name: {"AnonHugePages", "Private_Hugetlb", "Shared_Hugetlb"}) {
+        bytes += max(readProcKb("/proc/self/smaps_rollup", name), 0LL);
+    }
+    return bytes;
+}
+
+long long Memory::getBytes(const CSR& graph) {
+    return (long long) (graph.offsets.capacity() * sizeof(long long) + graph.neighbors.capacity() * sizeof(int));
+}
+
+long long Memory::getBytes(const CompressedCSR& graph) {
+    return (long long) (graph.offsets.capacity() * sizeof(uint64_t) + graph.data.capacity());
+}
+
+long long Memory::getBytes(const RoaringGraph& graph) {
+    return (long long) (graph.rows.capacity() * sizeof(uint64_t) + graph.containers.capacity() * sizeof(Container)
+                        + graph.values.capacity() * sizeof(uint16_t) + graph.words.capacity() * sizeof(uint64_t));
+}
+
+/**
+ * Out and in adjacency, DAG and directions of its edges
+ */
+long long Memory::getBytes(const DirectedCSR& graph) {
+    return getBytes(graph.out) + getBytes(graph.in) + getBytes(graph.dag) + (long long) graph.directions.capacity();
+}
+
+long long Memory::getBytes(const vector<vector<bool>>& matrix) {
+    long long bytes = (long long) (matrix.capacity() * sizeof(vector<bool>));
+    for (const auto& row: matrix) {
+        bytes += (long long) (row.capacity() + 63) / 64 * 8;
+    }
+    return bytes;
+}
+
+long long Memory::getBytes(const vector<vector<int>>& matrix) {
+    long long bytes = (long long) (matrix.capacity() * sizeof(vector<int>));
+    for (const auto& row: matrix) {
+        bytes += (long long) (row.capacity() * sizeof(int));
+    }
+    return bytes;
+}
+
+long long Memory::getBytes(const vector<pair<int, int>>& edges) {
+    return (long long) (edges.capacity() * sizeof(pair<int, int>));
+}
+
+long long Memory::estimateEdges(long long nEdges) {
+    return nEdges * (long long) sizeof(pair<int, int>);
+}
+
+/**
+ * Undirected CSR, each edge stored twice
+ */
+long long Memory::estimateCsr(long long nNodes, long long nEdges) {
+    return (nNodes + 1) * (long long) sizeof(long long) + 2 * nEdges * (long long) sizeof(int);
+}
+
+/**
+ * Compressed DAG, at most 2 bytes per gap (gaps of degree-ordered ids are mostly below 2^16) and a control
+ * byte every 4 gaps, an offset and a degree per node, plus the ranks of the compression
+ */
+long long Memory::estimateCompressed(long long nNodes, long long nEdges) {
+    return nNodes * (long long) (sizeof(uint64_t) + 2 + 2 * sizeof(int)) + nEdges * 9 / 4;
+}
+
+/**
+ * Roaring DAG, at most one container per node below 2^16 nodes and 2 bytes per edge (containers are only
+ * bitmaps or runs when that is smaller than an array)
+ */
+long long Memory::estimateRoaring(long long nNodes, long long nEdges) {
+    long long containers = nNodes * max(1LL, nNodes >> 16);
+    return (nNodes + 1) * (long long) sizeof(uint64_t) + min(containers, nEdges) * (long long) sizeof(Container)
+           + nEdges * (long long) sizeof(uint16_t);
+}
+
+/**
+ * Degree-ordered DAG, each edge stored once
+ */
+long long Memory::estimateDag(long long nNodes, long long nEdges) {
+    return (nNodes + 1) * (long long) sizeof(long long) + nEdges * (long long) sizeof(int);
+}
+
+/**
+ * Rows of vector<bool>, one bit for each pair of nodes
+ */
+long long Memory::estimateMatrix(long long nNodes) {
+    return nNodes * ((long long) sizeof(vector<bool>) + (nNodes + 63) / 64 * 8);
+}
+
+/**
+ * n^2 ints of precomputeIntersection
+ */
+long long Memory::estimatePrecompute(long long nNodes) {
+    return nNodes * ((long long) sizeof(vector<int>) + nNodes * (long long) sizeof(int));
+}
+
+/**
+ * Peak of GraphCSR::fromEdges: the parsed edges, the CSR and, when duplicates are dropped, the compacted neighbours
+ */
+long long Memory::estimateLoad(long long nNodes, long long nEdges) {
+    return estimateEdges(nEdges) + estimateCsr(nNodes, nEdges) + 2 * nEdges * (long long) sizeof(int);
+}
+
+/**
+ * Peak memory of loading the graph and running an algorithm, highest of the phases
+ * @param algorithm node, edge, fast, better, clique, colorful, external or census
+ * @param backend matrix or csr
+ * @param nNodes
+ * @param nEdges edges, or lines of the input file if the duplicates have not been removed yet
+ * @param nColors colors of colorful
+ * @param externalMemory memory budget given to external
+ * @return bytes
+ */
+long long Memory::estimateFootprint(const string& algorithm, const string& backend, long long nNodes, long long nEdges,
+                                    int nColors, long long externalMemory) {
+    if (algorithm == "colorful") {
+        // A subgraph of 3 colors has about 9/c^2 of the edges, see countTriangles_colorful
+        long long c = max(nColors, 1);
+        long long subgraph = c < 3 ? nEdges : min(nEdges, 9 * nEdges / (c * c) + 1);
+        return subgraph * SUBGRAPH_EDGE_BYTES + c * (c + 1) / 2 * BUCKET_BYTES;
+    }
+    if (algorithm == "external") {
+        return externalMemory + nNodes * (long long) (sizeof(int) + sizeof(long long)); // + degrees and offsets
+    }
+    if (algorithm == "census") {
+        // The arcs, the out and in adjacency (one slot per arc each), the symmetric CSR while orienting it, the DAG
+        // and a byte of directions per DAG edge
+        return estimateLoad(nNodes, nEdges) + 3 * estimateDag(nNodes, nEdges) + nEdges;
+    }
+
+    long long load = estimateLoad(nNodes, nEdges);
+    long long csr = estimateCsr(nNodes, nEdges);
+    if (backend == "csr") {
+        return max(load, csr + estimateDag(nNodes, nEdges));
+    }
+    if (backend == "compressed") {
+        return max(load, csr + estimateCompressed(nNodes, nEdges));
+    }
+    if (backend == "roaring") {
+        return max(load, csr + estimateDag(nNodes, nEdges) + estimateRoaring(nNodes, nEdges));
+    }
+    long long matrix = csr + estimateEdges(nEdges) + estimateMatrix(nNodes);
+    if (algorithm == "fast") matrix += estimatePrecompute(nNodes);
+    return max(load, matrix);
+}
+
+/**
+ * Parse a size like "1073741824", "512M" or "4GiB" (powers of 1024)
+ * @param text
+ * @return bytes
+ */
+long long Memory::parseBytes(const string& text) {
+    size_t end;
+    double value = stod(text, &end);
+    string unit = text.substr(end);
+    if (unit.size() > 1 && (unit.substr(1) == "B" || unit.substr(1) == "iB")) unit = unit.substr(0, 1);
+
+    const string units = "BKMGT";
+    size_t power = unit.empty() ? 0 : units.find((char) toupper(unit[0]));
+    if (value < 0 || power == string::npos || unit.size() > 1) {
+        throw invalid_argument("invalid size " + text);
+    }
+    for (size_t i = 0; i < power; i++) value *= 1024;
+    return (long long) value;
+}
+
+string Memory::format(long long bytes) {
+    const char* units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    double value = (double) bytes;
+    int unit = 0;
+    while (value >= 1024 && unit < 4) {
+        value /= 1024;
+        unit++;
+    }
+    stringstream out;
+    out << fixed << setprecision(unit ? 1 : 0) << value << " " << units[unit];
+    return out.str();
+}
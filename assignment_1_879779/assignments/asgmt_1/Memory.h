@@ -0,0 +1,65 @@
+#ifndef LEARNING_MASSIVE_DATA_MEMORY_H
+#define LEARNING_MASSIVE_DATA_MEMORY_H
+
+#include "Graph_csr.h"
+#include "Graph_compressed.h"
+#include "Graph_roaring.h"
+#include "Graph_directed.h"
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <ostream>
+
+/**
+ * Bytes held by each graph representation and peak resident memory of each phase of a run
+ */
+struct MemoryReport {
+    std::vector<std::pair<std::string, long long>> structures;
+    std::vector<std::pair<std::string, long long>> peaks;
+    long long regionBytes = 0;      // in the huge-page aligned regions of the Arena
+    long long hugePageBytes = 0;    // of the process backed by huge pages, transparent or explicit
+
+    void addStructure(const std::string& name, long long bytes);
+    void addPhase(const std::string& name);
+    void addPages();
+    void print(std::ostream& out) const;
+};
+
+/**
+ * Memory accounting: resident memory of the process (Linux /proc, getrusage elsewhere), size of the graph
+ * representations and estimates of the footprint of each algorithm before anything is allocated.
+ * Estimates count the heap bytes of the structures alive at the same time, not the allocator overhead.
+ */
+class Memory {
+    public:
+    static long long getCurrentRss();
+    static long long getPeakRss();
+    static void resetPeakRss();
+    static long long getAvailable();
+    static long long getHugePageBytes();
+
+    static long long getBytes(const CSR& graph);
+    static long long getBytes(const CompressedCSR& graph);
+    static long long getBytes(const RoaringGraph& graph);
+    static long long getBytes(const DirectedCSR& graph);
+    static long long getBytes(const std::vector<std::vector<bool>>& matrix);
+    static long long getBytes(const std::vector<std::vector<int>>& matrix);
+    static long long getBytes(const std::vector<std::pair<int, int>>& edges);
+
+    static long long estimateEdges(long long nEdges);
+    static long long estimateCsr(long long nNodes, long long nEdges);
+    static long long estimateDag(long long nNodes, long long nEdges);
+    static long long estimateCompressed(long long nNodes, long long nEdges);
+    static long long estimateRoaring(long long nNodes, long long nEdges);
+    static long long estimateMatrix(long long nNodes);
+    static long long estimatePrecompute(long long nNodes);
+    static long long estimateLoad(long long nNodes, long long nEdges);
+    static long long estimateFootprint(const std::string& algorithm, const std::string& backend, long long nNodes, long long nEdges,
+                                       int nColors, long long externalMemory);
+
+    static long long parseBytes(const std::string& text);
+    static std::string format(long long bytes);
+};
+
+#endif
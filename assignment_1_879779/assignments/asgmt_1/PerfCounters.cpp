@@ -0,0 +1,173 @@
+#include "PerfCounters.h"
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <omp.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+bool PerfSample::any() const {
+    for (bool v: valid) {
+        if (v) return true;
+    }
+    return false;
+}
+
+PerfSample& PerfSample::operator+=(const PerfSample& other) {
+    for (int e = 0; e < N_PERF_EVENTS; e++) {
+        values[e] += other.values[e];
+        valid[e] |= other.valid[e];
+    }
+    return *this;
+}
+
+PerfSample& PerfSample::operator/=(double divisor) {
+    for (double& value: values) {
+        value /= divisor;
+    }
+    return *this;
+}
+
+const char* PerfCounters::getName(int event) {
+    static const char* names[N_PERF_EVENTS] = {"cycles", "instructions", "llc_misses", "branch_misses", "dtlb_misses"};
+    return names[event];
+}
+
+#ifdef __linux__
+
+/**
+ * Open one counter on the calling thread, disabled, user space only
+ * @return fd, -1 if the event is not available
+ */
+static int openEvent(int event) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (event) {
+        case PERF_CYCLES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PERF_INSTRUCTIONS:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PERF_LLC_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case PERF_BRANCH_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        default:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0); // this thread, any cpu
+}
+
+/**
+ * Check once whether at least the cycle counter can be opened
+ */
+bool PerfCounters::isAvailable() {
+    static int available = -1;
+    if (available < 0) {
+        int fd = openEvent(PERF_CYCLES);
+        available = fd >= 0;
+        if (fd >= 0) ::close(fd);
+    }
+    return available;
+}
+
+/**
+ * Open, reset and enable the counters on every thread of a team of nThreads
+ * @param nThreads
+ */
+void PerfCounters::start(int nThreads) {
+    close();
+    fds.assign(nThreads, vector<int>(N_PERF_EVENTS, -1));
+
+    #pragma omp parallel num_threads(nThreads) default(none)
+    {
+        vector<int>& mine = fds[omp_get_thread_num()];
+        for (int e = 0; e < N_PERF_EVENTS; e++) {
+            mine[e] = openEvent(e);
+        }
+        for (int fd: mine) {
+            if (fd < 0) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+/**
+ * Disable and read all the counters, then close them
+ */
+void PerfCounters::stop() {
+    for (auto& thread: fds) {
+        for (int fd: thread) {
+            if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    perThread.assign(fds.size(), PerfSample());
+    for (size_t t = 0; t < fds.size(); t++) {
+        for (int e = 0; e < N_PERF_EVENTS; e++) {
+            uint64_t data[3]; // value, time enabled, time running
+            if (fds[t][e] < 0 || read(fds[t][e], data, sizeof(data)) != sizeof(data)) continue;
+            double scale = data[2] > 0 ? (double) data[1] / (double) data[2] : 0;
+            perThread[t].values[e] = (double) data[0] * scale;
+            perThread[t].valid[e] = data[2] > 0;
+        }
+    }
+    close();
+}
+
+void PerfCounters::close() {
+    for (auto& thread: fds) {
+        for (int& fd: thread) {
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+        }
+    }
+    fds.clear();
+}
+
+#else
+
+bool PerfCounters::isAvailable() { return false; }
+void PerfCounters::start(int nThreads) { perThread.assign(nThreads, PerfSample()); }
+void PerfCounters::stop() {}
+void PerfCounters::close() {}
+
+#endif
+
+PerfCounters::~PerfCounters() {
+    close();
+}
+
+/**
+ * @return sum of the counters of all the threads
+ */
+PerfSample PerfCounters::getTotal() const {
+    PerfSample total;
+    for (const auto& sample: perThread) {
+        total += sample;
+    }
+    return total;
+}
@@ -0,0 +1,47 @@
+#ifndef LEARNING_MASSIVE_DATA_PERF_COUNTERS_H
+#define LEARNING_MASSIVE_DATA_PERF_COUNTERS_H
+
+#include <vector>
+#include <string>
+
+enum PerfEvent { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_LLC_MISSES, PERF_BRANCH_MISSES, PERF_DTLB_MISSES, N_PERF_EVENTS };
+
+/**
+ * Value of each hardware event, scaled when the kernel multiplexed the counters.
+ * valid[e] is false when the event could not be opened (not supported, or not permitted by perf_event_paranoid).
+ */
+struct PerfSample {
+    double values[N_PERF_EVENTS] = {};
+    bool valid[N_PERF_EVENTS] = {};
+
+    bool any() const;
+    PerfSample& operator+=(const PerfSample& other);
+    PerfSample& operator/=(double divisor);
+};
+
+/**
+ * Hardware counters of the threads of an OpenMP team, read with perf_event_open (Linux only).
+ * start() opens the counters from inside each thread of a team of nThreads, so a kernel that then runs
+ * with the same number of threads is counted on each of them (the OpenMP runtime reuses its threads).
+ */
+class PerfCounters {
+    public:
+    ~PerfCounters();
+
+    void start(int nThreads);
+    void stop();
+
+    const std::vector<PerfSample>& getPerThread() const { return perThread; }
+    PerfSample getTotal() const;
+
+    static const char* getName(int event);
+    static bool isAvailable();
+
+    private:
+    void close();
+
+    std::vector<std::vector<int>> fds;            // fds[thread][event], -1 if not opened
+    std::vector<PerfSample> perThread;
+};
+
+#endif
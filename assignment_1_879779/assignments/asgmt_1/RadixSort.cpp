@@ -0,0 +1,183 @@
+#include "RadixSort.h"
+#include "Trace.h"
+
+#include <vector>
+#include <array>
+#include <memory>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <omp.h>
+
+using namespace std;
+
+static int getDigit(uint64_t key, int shift) {
+    return (int) (key >> shift) & (RADIX_BUCKETS - 1);
+}
+
+/**
+ * Bits that are not the same in all the keys
+ */
+uint64_t RadixSort::getVaryingBits(const vector<uint64_t>& keys, int nThreads) {
+    uint64_t any = 0, all = ~0ULL;
+    #pragma omp parallel for num_threads(nThreads) reduction(|:any) reduction(&:all) shared(keys) default(none)
+    for (size_t i = 0; i < keys.size(); i++) {
+        any |= keys[i];
+        all &= keys[i];
+    }
+    return any ^ all;
+}
+
+/**
+ * LSD radix sort, one pass for each digit that varies. Each thread histograms its block of keys, the histograms
+ * give every (bucket, thread) its own slice of the output, then each thread scatters its block through a small
+ * buffer per bucket so that the output is written a full cache line at a time.
+ * Needs a scratch array as large as the keys, see sortInPlace otherwise.
+ * @param keys
+ * @param nThreads
+ */
+void RadixSort::sort(vector<uint64_t>& keys, int nThreads) {
+    TRACE_SCOPE("radix sort");
+    long long n = (long long) keys.size();
+    if (n < RADIX_SMALL) {
+        std::sort(keys.begin(), keys.end());
+        return;
+    }
+    uint64_t varying = getVaryingBits(keys, nThreads);
+    unique_ptr<uint64_t[]> scratch(new uint64_t[n]); // not zeroed, every slot is written by the first pass
+    vector<array<long long, RADIX_BUCKETS>> counts(nThreads);
+    uint64_t* source = keys.data();
+    uint64_t* target = scratch.get();
+
+    for (int shift = 0; shift < 64; shift += RADIX_BITS) {
+        if (getDigit(varying, shift) == 0) continue;
+
+        #pragma omp parallel num_threads(nThreads) shared(n, shift, counts, source, target) default(none)
+        {
+            int thread = omp_get_thread_num(), team = omp_get_num_threads();
+            long long first = n * thread / team, last = n * (thread + 1) / team;
+            long long* count = counts[thread].data();
+            fill(count, count + RADIX_BUCKETS, 0);
+            for (long long i = first; i < last; i++) count[getDigit(source[i], shift)]++;
+            #pragma omp barrier
+
+            // Bucket by bucket, the slice of thread t follows the slices of the threads before it
+            #pragma omp single
+            {
+                long long offset = 0;
+                for (int b = 0; b < RADIX_BUCKETS; b++) {
+                    for (int t = 0; t < team; t++) {
+                        long long size = counts[t][b];
+                        counts[t][b] = offset;
+                        offset += size;
+                    }
+                }
+            }
+
+            alignas(64) uint64_t buffer[RADIX_BUCKETS][RADIX_BUFFER];
+            int filled[RADIX_BUCKETS] = {};
+            for (long long i = first; i < last; i++) {
+                int b = getDigit(source[i], shift);
+                buffer[b][filled[b]++] = source[i];
+                if (filled[b] == RADIX_BUFFER) {
+                    memcpy(target + count[b], buffer[b], sizeof(buffer[b]));
+                    count[b] += RADIX_BUFFER;
+                    filled[b] = 0;
+                }
+            }
+            for (int b = 0; b < RADIX_BUCKETS; b++) {
+                memcpy(target + count[b], buffer[b], filled[b] * sizeof(uint64_t));
+            }
+        }
+        swap(source, target);
+    }
+
+    if (source != keys.data()) {
+        #pragma omp parallel for num_threads(nThreads) shared(n, source, keys) default(none)
+        for (long long i = 0; i < n; i++) keys[i] = source[i];
+    }
+}
+
+/**
+ * Move every key to the bucket of its digit, in place (American flag sort): each bucket is filled from its start,
+ * the key found there is swapped to the next free slot of its own bucket until one that belongs here comes back
+ * @param keys
+ * @param count keys of each bucket
+ * @param shift of the digit
+ * @param starts receives the first key of each bucket, RADIX_BUCKETS + 1 values
+ */
+void RadixSort::permute(uint64_t* keys, const long long* count, int shift, long long* starts) {
+    long long next[RADIX_BUCKETS];
+    starts[0] = 0;
+    for (int b = 0; b < RADIX_BUCKETS; b++) {
+        next[b] = starts[b];
+        starts[b + 1] = starts[b] + count[b];
+    }
+    for (int b = 0; b < RADIX_BUCKETS; b++) {
+        while (next[b] < starts[b + 1]) {
+            uint64_t key = keys[next[b]];
+            int digit = getDigit(key, shift);
+            while (digit != b) {
+                swap(key, keys[next[digit]++]);
+                digit = getDigit(key, shift);
+            }
+            keys[next[b]++] = key;
+        }
+    }
+}
+
+/**
+ * MSD sort of [first, last) from the digit at shift down, a digit with all the keys in one bucket costs one scan
+ */
+void RadixSort::sortRange(uint64_t* first, uint64_t* last, int shift) {
+    long long count[RADIX_BUCKETS];
+    while (true) {
+        if (last - first < RADIX_SMALL) {
+            std::sort(first, last);
+            return;
+        }
+        fill(count, count + RADIX_BUCKETS, 0);
+        for (const uint64_t* key = first; key < last; key++) count[getDigit(*key, shift)]++;
+        if (count[getDigit(*first, shift)] < last - first) break;
+        if (shift == 0) return;
+        shift -= RADIX_BITS;
+    }
+
+    long long starts[RADIX_BUCKETS + 1];
+    permute(first, count, shift, starts);
+    if (shift == 0) return;
+    for (int b = 0; b < RADIX_BUCKETS; b++) {
+        sortRange(first + starts[b], first + starts[b + 1], shift - RADIX_BITS);
+    }
+}
+
+/**
+ * MSD radix sort without a scratch array, half the memory of sort. The first level starts at the highest digit
+ * that varies, its histogram is parallel but its permutation is sequential; the buckets are then sorted in
+ * parallel, so this scales less than sort.
+ * @param keys
+ * @param nThreads
+ */
+void RadixSort::sortInPlace(vector<uint64_t>& keys, int nThreads) {
+    TRACE_SCOPE("radix sort in place");
+    long long n = (long long) keys.size();
+    uint64_t varying = n < RADIX_SMALL ? 0 : getVaryingBits(keys, nThreads);
+    if (varying == 0) {
+        std::sort(keys.begin(), keys.end());
+        return;
+    }
+    int shift = (63 - countl_zero(varying)) / RADIX_BITS * RADIX_BITS;
+
+    long long count[RADIX_BUCKETS] = {};
+    #pragma omp parallel for num_threads(nThreads) reduction(+:count[:RADIX_BUCKETS]) shared(n, keys, shift) default(none)
+    for (long long i = 0; i < n; i++) count[getDigit(keys[i], shift)]++;
+    long long starts[RADIX_BUCKETS + 1];
+    permute(keys.data(), count, shift, starts);
+    if (shift == 0) return;
+
+    uint64_t* data = keys.data();
+    #pragma omp parallel for num_threads(nThreads) schedule(dynamic, 1) shared(data, starts, shift) default(none)
+    for (int b = 0; b < RADIX_BUCKETS; b++) {
+        sortRange(data + starts[b], data + starts[b + 1], shift - RADIX_BITS);
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef LEARNING_MASSIVE_DATA_RADIX_SORT_H
+#define LEARNING_MASSIVE_DATA_RADIX_SORT_H
+
+#include <vector>
+#include <cstdint>
+
+#define RADIX_BITS 8 //bits of a digit, one pass of the LSD sort or one level of the MSD sort
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_BUFFER 16 //keys of the write-combining buffer of a bucket, two cache lines
+#define RADIX_SMALL 256 //ranges shorter than this are left to std::sort
+
+/**
+ * Radix sorts of 64-bit keys, such as edges packed as (u << 32 | v) so that the order of the keys is the order of
+ * the (u, v) pairs. Digits that are the same in every key (the high bits of small node ids) are skipped.
+ */
+class RadixSort {
+    public:
+    static uint64_t pack(int u, int v) { return (uint64_t) (uint32_t) u << 32 | (uint32_t) v; }
+
+    static void sort(std::vector<uint64_t>& keys, int nThreads);
+    static void sortInPlace(std::vector<uint64_t>& keys, int nThreads);
+
+    private:
+    static uint64_t getVaryingBits(const std::vector<uint64_t>& keys, int nThreads);
+    static void permute(uint64_t* keys, const long long* count, int shift, long long* starts);
+    static void sortRange(uint64_t* first, uint64_t* last, int shift);
+};
+
+#endif
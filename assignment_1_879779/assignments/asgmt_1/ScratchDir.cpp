@@ -0,0 +1,30 @@
+#include "ScratchDir.h"
+
+#include <vector>
+#include <filesystem>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+
+using namespace std;
+
+/**
+ * @param parent directory where to create it, created if missing
+ * @param prefix of its name, followed by random characters
+ */
+ScratchDir::ScratchDir(const string& parent, const string& prefix) {
+    filesystem::create_directories(parent);
+    string pattern = parent + "/" + prefix + "XXXXXX";
+    vector<char> name(pattern.begin(), pattern.end());
+    name.push_back('\0');
+    if (mkdtemp(name.data()) == nullptr) {
+        throw runtime_error("unable to create a directory in " + parent + ": " + strerror(errno));
+    }
+    path = name.data();
+}
+
+ScratchDir::~ScratchDir() {
+    error_code error; // a destructor must not throw, a file left behind is not worth failing the count
+    filesystem::remove_all(path, error);
+}
@@ -0,0 +1,23 @@
+#ifndef LEARNING_MASSIVE_DATA_SCRATCH_DIR_H
+#define LEARNING_MASSIVE_DATA_SCRATCH_DIR_H
+
+#include <string>
+
+/**
+ * Directory for the temporary files of one count, created with a unique name (mkdtemp) so that counts running at
+ * the same time never share files, and removed with everything in it when the count returns or throws
+ */
+class ScratchDir {
+    public:
+    ScratchDir(const std::string& parent, const std::string& prefix);
+    ~ScratchDir();
+    ScratchDir(const ScratchDir&) = delete;
+    ScratchDir& operator=(const ScratchDir&) = delete;
+
+    const std::string& getPath() const { return path; }
+
+    private:
+    std::string path;
+};
+
+#endif
@@ -0,0 +1,353 @@
+#include "Server.h"
+
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+/**
+ * Read exactly size bytes
+ * @return false on end of file or error
+ */
+static bool readFully(int fd, void* data, size_t size) {
+    char* at = (char*) data;
+    while (size > 0) {
+        ssize_t n = read(fd, at, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        at += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool writeFully(int fd, const void* data, size_t size) {
+    const char* at = (const char*) data;
+    while (size > 0) {
+        ssize_t n = send(fd, at, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        at += n;
+        size -= n;
+    }
+    return true;
+}
+
+template<typename T>
+static void append(vector<char>& payload, T value) {
+    const char* bytes = (const char*) &value;
+    payload.insert(payload.end(), bytes, bytes + sizeof(T));
+}
+
+template<typename T>
+static void appendAll(vector<char>& payload, const vector<T>& values) {
+    const char* bytes = (const char*) values.data();
+    payload.insert(payload.end(), bytes, bytes + values.size() * sizeof(T));
+}
+
+static sockaddr_un getAddress(const string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw invalid_argument("socket path too long: " + path);
+    }
+    strcpy(address.sun_path, path.c_str());
+    return address;
+}
+
+/**
+ * @param socketPath
+ * @param nThreads threads of each query, a query may ask for fewer
+ * @param nWorkers queries run at the same time
+ * @param maxQueued queries waiting for a worker, the next ones are refused
+ * @param maxClients open connections, the next ones are refused
+ */
+GraphServer::GraphServer(string socketPath, int nThreads, int nWorkers, int maxQueued, int maxClients)
+        : socketPath(std::move(socketPath)), nThreads(nThreads), nWorkers(nWorkers), maxQueued(maxQueued),
+          maxClients(maxClients) {
+    if (nThreads < 1 || nWorkers < 1 || maxClients < 1 || maxQueued < 0) {
+        throw invalid_argument("threads, workers and clients must be positive, queue not negative");
+    }
+}
+
+GraphServer::~GraphServer() {
+    stop();
+}
+
+/**
+ * Load a graph (snapshot or edge list) and build the structures of the kernels, so that queries only pay the
+ * kernel time. Must be called before run.
+ */
+void GraphServer::addGraph(const string& name, const string& path) {
+    if (name.empty() || name.size() > MAX_NAME_LENGTH) {
+        throw invalid_argument("invalid graph name " + name);
+    }
+    auto start = chrono::steady_clock::now();
+    triangles::Graph graph = triangles::Graph::load(path);
+    long long count = triangles::countTriangles(graph, {nThreads});
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "loaded " << name << " from " << path << ": " << graph.numNodes() << " nodes, " << graph.numEdges()
+         << " edges, " << count << " triangles in " << seconds << " s" << endl;
+    graphs.insert_or_assign(name, graph);
+}
+
+/**
+ * Accept connections until stop is called, then wait for the open ones to close and the queued queries to finish
+ */
+void GraphServer::run() {
+    sockaddr_un address = getAddress(socketPath);
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        throw runtime_error("unable to create a socket: " + string(strerror(errno)));
+    }
+    unlink(socketPath.c_str());
+    if (bind(listenFd, (sockaddr*) &address, sizeof(address)) < 0 || listen(listenFd, 64) < 0) {
+        string error = strerror(errno);
+        close(listenFd);
+        listenFd = -1;
+        throw runtime_error("unable to listen on " + socketPath + ": " + error);
+    }
+    for (int i = 0; i < nWorkers; i++) {
+        workers.emplace_back(&GraphServer::work, this);
+    }
+    {
+        lock_guard<mutex> guard(lock);
+        listening = true;
+        changed.notify_all();
+    }
+    cout << "listening on " << socketPath << ", " << nWorkers << " workers of " << nThreads << " threads" << endl;
+
+    while (!stopping) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (stopping) break;
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            cerr << "accept failed: " << strerror(errno) << endl;
+            break;
+        }
+        lock_guard<mutex> guard(lock);
+        if (stopping) {
+            close(fd);
+            break;
+        }
+        if (nClientThreads >= maxClients) {
+            // Answered without reading the query, the client reads it as the answer to its first one
+            string message = "server busy, " + to_string(maxClients) + " connections open";
+            ResponseHeader response;
+            response.status = STATUS_BUSY;
+            response.length = message.size();
+            vector<char> answer((const char*) &response, (const char*) &response + sizeof(response));
+            answer.insert(answer.end(), message.begin(), message.end());
+            send(fd, answer.data(), answer.size(), MSG_NOSIGNAL | MSG_DONTWAIT); // never blocks the accept loop
+            close(fd);
+            continue;
+        }
+        clients.insert(fd);
+        nClientThreads++;
+        thread([this, fd]() {
+            serveClient(fd);
+            lock_guard<mutex> guard(lock);
+            clients.erase(fd);
+            close(fd);
+            nClientThreads--;
+            changed.notify_all();
+        }).detach();
+    }
+
+    stopping = true;
+    {
+        unique_lock<mutex> guard(lock);
+        listening = false;
+        for (int fd: clients) shutdown(fd, SHUT_RDWR);
+        changed.notify_all();
+        changed.wait(guard, [this]() { return nClientThreads == 0; });
+    }
+    for (thread& worker: workers) worker.join();
+    workers.clear();
+    close(listenFd);
+    listenFd = -1;
+    unlink(socketPath.c_str());
+}
+
+/**
+ * Wait until run listens on the socket: the socket file exists from bind on, but connections are refused before
+ * listen
+ * @param timeout seconds
+ * @return false if run did not listen in time or was stopped
+ */
+bool GraphServer::waitListening(double timeout) {
+    unique_lock<mutex> guard(lock);
+    return changed.wait_for(guard, chrono::duration<double>(timeout), [this]() { return listening || stopping; })
+           && listening;
+}
+
+/**
+ * Make run return, from any thread but not from a signal handler
+ */
+void GraphServer::stop() {
+    stopping = true;
+    lock_guard<mutex> guard(lock);
+    if (listenFd >= 0) shutdown(listenFd, SHUT_RDWR);
+    for (int fd: clients) shutdown(fd, SHUT_RDWR);
+    changed.notify_all();
+}
+
+/**
+ * Answer the queries of a connection until the client closes it or sends an invalid header
+ */
+void GraphServer::serveClient(int fd) {
+    Job job;
+    while (readFully(fd, &job.header, sizeof(job.header))) {
+        if (job.header.magic != QUERY_MAGIC || job.header.nameLength > MAX_NAME_LENGTH) break;
+        job.name.resize(job.header.nameLength);
+        if (!readFully(fd, job.name.data(), job.name.size())) break;
+
+        job.payload.clear();
+        job.response = ResponseHeader();
+        if (!submit(job)) {
+            job.response.status = STATUS_BUSY;
+            string message = "server busy, " + to_string(nWorkers) + " queries running and " + to_string(maxQueued) + " queued";
+            job.payload.assign(message.begin(), message.end());
+        }
+        job.response.length = job.payload.size();
+        if (!writeFully(fd, &job.response, sizeof(job.response)) || !writeFully(fd, job.payload.data(), job.payload.size())) break;
+    }
+}
+
+/**
+ * Queue a query and wait for a worker to answer it
+ * @return false if the queue is full
+ */
+bool GraphServer::submit(Job& job) {
+    unique_lock<mutex> guard(lock);
+    // queue holds the running queries too
+    if (stopping || (long long) queue.size() >= nWorkers + maxQueued) return false;
+    job.taken = job.done = false;
+    queue.push_back(&job);
+    changed.notify_all();
+    changed.wait(guard, [&job]() { return job.done; });
+    return true;
+}
+
+/**
+ * Worker: run the queued queries in order, until stopped and the queue is empty
+ */
+void GraphServer::work() {
+    unique_lock<mutex> guard(lock);
+    while (true) {
+        auto next = find_if(queue.begin(), queue.end(), [](Job* job) { return !job->taken; });
+        if (next == queue.end()) {
+            if (stopping) return;
+            changed.wait(guard);
+            continue;
+        }
+        Job* job = *next;
+        job->taken = true;
+        guard.unlock();
+        answer(*job);
+        guard.lock();
+        queue.erase(find(queue.begin(), queue.end(), job));
+        job->done = true;
+        changed.notify_all();
+    }
+}
+
+void GraphServer::answer(Job& job) const {
+    auto found = graphs.find(job.name);
+    if (found == graphs.end()) {
+        job.response.status = STATUS_NOT_FOUND;
+        string message = "no graph named " + job.name;
+        job.payload.assign(message.begin(), message.end());
+        return;
+    }
+    const triangles::Graph& graph = found->second;
+    triangles::Options options;
+    options.threads = job.header.threads == 0 ? nThreads : min((int) job.header.threads, nThreads);
+
+    try {
+        switch (job.header.op) {
+            case QUERY_INFO:
+                append<int64_t>(job.payload, graph.numNodes());
+                append<int64_t>(job.payload, graph.numEdges());
+                break;
+            case QUERY_COUNT:
+                append<int64_t>(job.payload, triangles::countTriangles(graph, options));
+                break;
+            case QUERY_LOCAL:
+                appendAll(job.payload, triangles::countLocalTriangles(graph, options));
+                break;
+            case QUERY_CLUSTERING: {
+                vector<double> local = triangles::localClustering(graph, options);
+                double sum = 0;
+                for (double c: local) sum += c;
+                append<double>(job.payload, triangles::transitivity(graph, options));
+                append<double>(job.payload, local.empty() ? 0 : sum / (double) local.size());
+                appendAll(job.payload, local);
+                break;
+            }
+            case QUERY_TRUSS: {
+                triangles::TrussDecomposition truss = triangles::trussDecomposition(graph, options);
+                append<int64_t>(job.payload, truss.maxTruss);
+                append<int64_t>(job.payload, truss.countEdges(job.header.k > 0 ? job.header.k : truss.maxTruss));
+                break;
+            }
+            default:
+                throw invalid_argument("unknown query " + to_string(job.header.op));
+        }
+    } catch (const exception& e) {
+        job.response.status = STATUS_ERROR;
+        job.payload.assign(e.what(), e.what() + strlen(e.what()));
+    }
+}
+
+GraphClient::GraphClient(const string& socketPath) {
+    sockaddr_un address = getAddress(socketPath);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr*) &address, sizeof(address)) < 0) {
+        string error = strerror(errno);
+        if (fd >= 0) close(fd);
+        throw runtime_error("unable to connect to " + socketPath + ": " + error);
+    }
+}
+
+GraphClient::~GraphClient() {
+    close(fd);
+}
+
+/**
+ * Send a query and wait for its answer
+ * @param op
+ * @param graph name given to the server
+ * @param nThreads 0 for the threads of the server
+ * @param k of QUERY_TRUSS
+ * @param payload answer, or error message if the status is not STATUS_OK
+ * @return
+ */
+QueryStatus GraphClient::query(QueryOp op, const string& graph, int nThreads, int k, vector<char>& payload) {
+    if (graph.size() > MAX_NAME_LENGTH) {
+        throw invalid_argument("graph name too long");
+    }
+    QueryHeader header;
+    header.op = op;
+    header.nameLength = (uint16_t) graph.size();
+    header.threads = (uint32_t) max(0, nThreads);
+    header.k = k;
+    ResponseHeader response;
+    // A server with too many connections answers busy and closes before reading the query, so the answer is
+    // read even if the query could not be sent
+    bool sent = writeFully(fd, &header, sizeof(header)) && writeFully(fd, graph.data(), graph.size());
+    if (!readFully(fd, &response, sizeof(response)) || (!sent && response.status != STATUS_BUSY)) {
+        throw runtime_error("connection to the server lost");
+    }
+    payload.resize(response.length);
+    if (!readFully(fd, payload.data(), payload.size())) {
+        throw runtime_error("connection to the server lost");
+    }
+    return (QueryStatus) response.status;
+}
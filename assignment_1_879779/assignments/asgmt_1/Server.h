@@ -0,0 +1,117 @@
+#ifndef LEARNING_MASSIVE_DATA_SERVER_H
+#define LEARNING_MASSIVE_DATA_SERVER_H
+
+#include "triangles/Triangles.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Binary protocol of the graph server, over a Unix domain socket in host byte order.
+ * A client sends any number of queries on a connection: a QueryHeader followed by nameLength bytes of graph name.
+ * Each query gets a ResponseHeader followed by length bytes of payload:
+ *   QUERY_INFO        int64 nodes, int64 edges
+ *   QUERY_COUNT       int64 triangles
+ *   QUERY_LOCAL       int64 triangles of each node
+ *   QUERY_CLUSTERING  double transitivity, double average local clustering, double local clustering of each node
+ *   QUERY_TRUSS       int64 largest k with a non-empty k-truss, int64 edges of the k-truss (k of the query, the
+ *                     largest one if k <= 0)
+ * With a status other than STATUS_OK the payload is an error message.
+ */
+#define QUERY_MAGIC 0x51495254 //"TRIQ"
+#define MAX_NAME_LENGTH 1024 //of a graph, longer names close the connection
+#define MAX_CLIENTS 64 //default open connections of a server, the next ones get STATUS_BUSY and are closed
+
+enum QueryOp : uint8_t { QUERY_INFO, QUERY_COUNT, QUERY_LOCAL, QUERY_CLUSTERING, QUERY_TRUSS };
+enum QueryStatus : uint32_t { STATUS_OK, STATUS_ERROR, STATUS_BUSY, STATUS_NOT_FOUND };
+
+struct QueryHeader {
+    uint32_t magic = QUERY_MAGIC;
+    uint8_t op = QUERY_COUNT;
+    uint8_t reserved = 0;
+    uint16_t nameLength = 0;
+    uint32_t threads = 0;       // 0 for all the threads of a worker
+    int32_t k = 0;              // QUERY_TRUSS
+};
+
+struct ResponseHeader {
+    uint32_t status = STATUS_OK;
+    uint32_t reserved = 0;
+    uint64_t length = 0;
+};
+
+/**
+ * Daemon that keeps graphs resident and answers queries over a Unix socket.
+ * Each connection is read by its own thread, the queries run on a fixed pool of worker threads whose OpenMP
+ * teams stay alive between queries. Admission control: at most maxClients connections are open, the next ones
+ * get STATUS_BUSY and are closed without a thread; at most nWorkers queries run at once and at most maxQueued
+ * wait, the next ones get STATUS_BUSY right away instead of piling up.
+ */
+class GraphServer {
+    public:
+    GraphServer(std::string socketPath, int nThreads, int nWorkers, int maxQueued, int maxClients = MAX_CLIENTS);
+    ~GraphServer();
+    GraphServer(const GraphServer&) = delete;
+    GraphServer& operator=(const GraphServer&) = delete;
+
+    void addGraph(const std::string& name, const std::string& path);
+    void run();
+    bool waitListening(double timeout);
+    void stop();
+
+    private:
+    struct Job {
+        QueryHeader header;
+        std::string name;
+        ResponseHeader response;
+        std::vector<char> payload;
+        bool taken = false;     // by a worker
+        bool done = false;
+    };
+
+    void serveClient(int fd);
+    void work();
+    bool submit(Job& job);
+    void answer(Job& job) const;
+
+    std::string socketPath;
+    int nThreads, nWorkers, maxQueued, maxClients;
+    std::map<std::string, triangles::Graph> graphs;
+
+    std::mutex lock;
+    std::condition_variable changed;
+    std::deque<Job*> queue;
+    std::set<int> clients;          // open connections, shut down by stop
+    int nClientThreads = 0;
+    std::vector<std::thread> workers;
+
+    std::atomic<bool> stopping{false};
+    bool listening = false;         // run accepts connections
+    int listenFd = -1;
+};
+
+/**
+ * Connection to a GraphServer
+ */
+class GraphClient {
+    public:
+    explicit GraphClient(const std::string& socketPath);
+    ~GraphClient();
+    GraphClient(const GraphClient&) = delete;
+    GraphClient& operator=(const GraphClient&) = delete;
+
+    QueryStatus query(QueryOp op, const std::string& graph, int nThreads, int k, std::vector<char>& payload);
+
+    private:
+    int fd;
+};
+
+#endif
@@ -0,0 +1,170 @@
+#include "Trace.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+struct Span {
+    const char* name;
+    long long start, duration; // ns
+    int depth;
+};
+
+struct ThreadSpans {
+    int tid;
+    int depth = 0;
+    vector<Span> spans;
+};
+
+// Buffers live until the end of the process, threads of the OpenMP pool outlive any single phase
+mutex buffersMutex;
+vector<unique_ptr<ThreadSpans>> buffers;
+thread_local ThreadSpans* local = nullptr;
+const auto epoch = chrono::steady_clock::now();
+
+ThreadSpans& getLocal() {
+    if (!local) {
+        lock_guard<mutex> lock(buffersMutex);
+        buffers.push_back(make_unique<ThreadSpans>());
+        buffers.back()->tid = (int) buffers.size() - 1;
+        local = buffers.back().get();
+    }
+    return *local;
+}
+
+}
+
+/**
+ * @return ns since the start of the process
+ */
+long long Trace::now() {
+    return chrono::duration_cast<chrono::nanoseconds> (chrono::steady_clock::now() - epoch).count();
+}
+
+/**
+ * Open a scope on the calling thread
+ * @return depth of the scope, 0 if it is not nested in another one
+ */
+int Trace::enter() {
+    return getLocal().depth++;
+}
+
+void Trace::leave(const char* name, long long start, int depth) {
+    long long end = now();
+    ThreadSpans& spans = getLocal();
+    spans.depth = depth;
+    spans.spans.push_back({name, start, end - start, depth});
+}
+
+/**
+ * Drop all the recorded spans. Not safe while other threads are recording.
+ */
+void Trace::clear() {
+    lock_guard<mutex> lock(buffersMutex);
+    for (auto& buffer: buffers) {
+        buffer->spans.clear();
+    }
+}
+
+/**
+ * Print the spans of the calling thread as a tree of phases, the same path summed over its repetitions,
+ * then for the spans of the other threads the least and most time spent by a single thread.
+ * Not safe while other threads are recording.
+ * @param out
+ */
+void Trace::printSummary(ostream& out) {
+    ThreadSpans& mine = getLocal();
+    vector<Span> spans = mine.spans;
+    sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) { return a.start < b.start || (a.start == b.start && a.depth < b.depth); });
+
+    // A span is nested in the last span of the depth above it that started before it
+    struct Phase {string path; const char* name; int depth; long long total; int count;};
+    vector<Phase> phases;
+    vector<string> stack;
+    for (const Span& span: spans) {
+        stack.resize(span.depth);
+        string path = (stack.empty() ? "" : stack.back() + "/") + span.name;
+        stack.push_back(path);
+        auto phase = find_if(phases.begin(), phases.end(), [&path](const Phase& p) { return p.path == path; });
+        if (phase == phases.end()) {
+            phases.push_back({path, span.name, span.depth, 0, 0});
+            phase = phases.end() - 1;
+        }
+        phase->total += span.duration;
+        phase->count++;
+    }
+
+    out << "\nPhase breakdown:" << endl;
+    out << fixed << setprecision(3);
+    for (const Phase& phase: phases) {
+        out << string(2 * (phase.depth + 1), ' ') << phase.name << ": " << phase.total / 1e6 << " ms";
+        if (phase.count > 1) out << " (" << phase.count << " spans)";
+        out << endl;
+    }
+
+    // Spans of the other threads, by name: the same literal of several files may have several addresses
+    lock_guard<mutex> lock(buffersMutex);
+    vector<string> names;
+    for (const auto& buffer: buffers) {
+        if (buffer.get() == &mine) continue;
+        for (const Span& span: buffer->spans) {
+            if (find(names.begin(), names.end(), span.name) == names.end()) names.push_back(span.name);
+        }
+    }
+    for (const string& name: names) {
+        long long least = -1, most = 0;
+        int nThreads = 0;
+        for (const auto& buffer: buffers) {
+            long long total = 0;
+            bool found = false;
+            for (const Span& span: buffer->spans) {
+                if (span.name != name) continue;
+                total += span.duration;
+                found = true;
+            }
+            if (!found) continue;
+            least = least < 0 ? total : min(least, total);
+            most = max(most, total);
+            nThreads++;
+        }
+        out << "  " << name << " on " << nThreads << " threads: " << least / 1e6 << " to " << most / 1e6 << " ms per thread" << endl;
+    }
+}
+
+/**
+ * Write all the spans as complete events ("ph": "X") of the Chrome trace-event format, times in microseconds
+ * @param path
+ */
+void Trace::saveChromeTrace(const string& path) {
+    ofstream out(path, ios::trunc);
+    if (!out.is_open()) {
+        throw runtime_error("unable to open " + path);
+    }
+    out << fixed << setprecision(3);
+
+    int pid = (int) getpid();
+    bool first = true;
+    out << "{\"traceEvents\": [";
+    lock_guard<mutex> lock(buffersMutex);
+    for (const auto& buffer: buffers) {
+        out << (first ? "" : ",") << "\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid << ", \"tid\": " << buffer->tid
+            << ", \"args\": {\"name\": \"" << (buffer->tid == 0 ? "main" : "thread " + to_string(buffer->tid)) << "\"}}";
+        first = false;
+        for (const Span& span: buffer->spans) {
+            out << ",\n{\"name\": \"" << span.name << "\", \"ph\": \"X\", \"ts\": " << span.start / 1e3 << ", \"dur\": " << span.duration / 1e3
+                << ", \"pid\": " << pid << ", \"tid\": " << buffer->tid << "}";
+        }
+    }
+    out << "\n], \"displayTimeUnit\": \"ms\"}" << endl;
+}
@@ -0,0 +1,55 @@
+#ifndef LEARNING_MASSIVE_DATA_TRACE_H
+#define LEARNING_MASSIVE_DATA_TRACE_H
+
+#include <atomic>
+#include <string>
+#include <ostream>
+
+/**
+ * Phase timings of a run (parse, dedupe, CSR build, reorder, precompute, count), recorded by TraceScope.
+ * Every thread keeps its own list of spans, nested scopes record their depth, so the spans can be printed as
+ * a breakdown or exported as a Chrome trace-event file (chrome://tracing, Perfetto).
+ * When tracing is off a scope costs one relaxed load, no clock is read and nothing is stored.
+ */
+class Trace {
+    public:
+    static void setEnabled(bool on) { enabled.store(on, std::memory_order_relaxed); }
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    static long long now();
+    static int enter();
+    static void leave(const char* name, long long start, int depth);
+
+    static void printSummary(std::ostream& out);
+    static void saveChromeTrace(const std::string& path);
+    static void clear();
+
+    private:
+    inline static std::atomic<bool> enabled{false};
+};
+
+/**
+ * Span from its construction to the end of the enclosing block, name must be a string literal
+ */
+class TraceScope {
+    public:
+    explicit TraceScope(const char* name) : name(name), start(Trace::isEnabled() ? Trace::now() : -1) {
+        if (start >= 0) depth = Trace::enter();
+    }
+    ~TraceScope() {
+        if (start >= 0) Trace::leave(name, start, depth);
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    private:
+    const char* name;
+    long long start;            // ns since the start of the trace, -1 if tracing was off
+    int depth = 0;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+
+#endif
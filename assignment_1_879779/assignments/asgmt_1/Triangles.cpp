@@ -0,0 +1,230 @@
+#include "triangles/Triangles.h"
+#include "Graph_ds.h"
+#include "Graph_csr.h"
+#include "Graph_clique.h"
+#include "Graph_truss.h"
+#include "Graph_compressed.h"
+#include "Graph_roaring.h"
+#include "Graph_reader.h"
+
+#include <mutex>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace triangles {
+
+struct Graph::Impl {
+    CSR graph;
+
+    mutable once_flag dagOnce;
+    mutable CSR dag;
+    mutable once_flag compressedOnce;
+    mutable CompressedCSR compressed;
+    mutable once_flag roaringOnce;
+    mutable RoaringGraph roaring;
+    mutable once_flag matrixOnce;
+    mutable vector<vector<bool>> matrix;
+
+    const CSR& getDag(int nThreads) const {
+        call_once(dagOnce, [this, nThreads]() { dag = GraphCSR::orientByDegree(graph, nThreads); });
+        return dag;
+    }
+
+    const CompressedCSR& getCompressed(int nThreads) const {
+        call_once(compressedOnce, [this, nThreads]() { compressed = GraphCompressed::compress(graph, nThreads); });
+        return compressed;
+    }
+
+    const RoaringGraph& getRoaring(int nThreads) const {
+        call_once(roaringOnce, [this, nThreads]() { roaring = GraphRoaring::fromDag(getDag(nThreads)); });
+        return roaring;
+    }
+
+    const vector<vector<bool>>& getMatrix() const {
+        call_once(matrixOnce, [this]() { matrix = GraphMat::fromEdges(graph.nNodes, GraphCSR::getEdges(graph)); });
+        return matrix;
+    }
+};
+
+static int getThreads(const Options& options) {
+    if (options.threads < 1) {
+        throw invalid_argument("threads must be positive");
+    }
+    return options.threads;
+}
+
+static IntersectionKernel getKernel(const Options& options) {
+    return options.kernel == Kernel::Adaptive ? INTERSECT_ADAPTIVE : INTERSECT_MERGE;
+}
+
+Graph::Graph() : state(make_shared<const Impl>()) {}
+
+Graph::Graph(shared_ptr<const Impl> state) : state(std::move(state)) {}
+
+/**
+ * @param nNodes at least the largest node id + 1, grown if an edge has a larger id
+ * @param edges undirected edges, in any order
+ * @param threads of the construction
+ */
+Graph Graph::fromEdges(int nNodes, const vector<pair<int, int>>& edges, int threads) {
+    auto impl = make_shared<Impl>();
+    impl->graph = GraphCSR::fromEdges(nNodes, edges, max(1, threads));
+    return Graph(std::move(impl));
+}
+
+/**
+ * Build from caller-owned arrays without copying them, edge i is sources[i * stride] - targets[i * stride]
+ * (interleaved pairs: targets = sources + 1, stride = 2). The arrays are not used after the call.
+ * @param nNodes at least the largest node id + 1, grown if an edge has a larger id
+ */
+Graph Graph::fromEdges(int nNodes, const int32_t* sources, const int32_t* targets, int64_t nEdges, int64_t stride,
+                       int threads) {
+    auto impl = make_shared<Impl>();
+    impl->graph = GraphCSR::fromEdges(nNodes, sources, targets, nEdges, stride, max(1, threads));
+    return Graph(std::move(impl));
+}
+
+Graph Graph::fromEdges(int nNodes, const int64_t* sources, const int64_t* targets, int64_t nEdges, int64_t stride,
+                       int threads) {
+    static_assert(sizeof(int64_t) == sizeof(long long));
+    auto impl = make_shared<Impl>();
+    impl->graph = GraphCSR::fromEdges(nNodes, (const long long*) sources, (const long long*) targets, nEdges, stride,
+                                      max(1, threads));
+    return Graph(std::move(impl));
+}
+
+/**
+ * @param path snapshot written by save, SNAP edge list, Matrix Market, METIS or binary edge list, see GraphReader
+ */
+Graph Graph::load(const string& path) {
+    auto impl = make_shared<Impl>();
+    impl->graph = GraphReader::read(path);
+    return Graph(std::move(impl));
+}
+
+void Graph::save(const string& path) const {
+    GraphCSR::saveSnapshot(state->graph, path);
+}
+
+int Graph::numNodes() const {
+    return state->graph.nNodes;
+}
+
+int64_t Graph::numEdges() const {
+    return (int64_t) state->graph.neighbors.size() / 2;
+}
+
+int64_t Graph::degree(int node) const {
+    if (node < 0 || node >= state->graph.nNodes) {
+        throw invalid_argument("node " + to_string(node) + " out of range");
+    }
+    return state->graph.degree(node);
+}
+
+CancellationToken::CancellationToken() : flag(make_shared<atomic<bool>>(false)) {}
+
+void CancellationToken::cancel() const {
+    flag->store(true);
+}
+
+bool CancellationToken::isCancelled() const {
+    return flag->load();
+}
+
+static string describe(const PartialCount& partial) {
+    stringstream message;
+    message << "count stopped after " << fixed << setprecision(1) << 100 * partial.fraction << "% of the work, "
+            << partial.count << " triangles so far";
+    return message.str();
+}
+
+Cancelled::Cancelled(const PartialCount& partial) : runtime_error(describe(partial)), partial(partial) {}
+
+PartialCount countTrianglesPartial(const Graph& graph, const Options& options) {
+    int nThreads = getThreads(options);
+    Control control;
+    control.setCancel(options.cancel.getFlag());
+    control.setDeadline(options.deadline);
+    if (options.progress) {
+        control.setProgress([&options](const ControlReport& report) {
+            options.progress({report.done, report.total, report.fraction, report.elapsed, report.rate, report.eta});
+        }, options.progressInterval);
+    }
+
+    long long count;
+    if (options.backend == Backend::Matrix) {
+        const vector<vector<bool>>& matrix = graph.state->getMatrix();
+        count = nThreads == 1 ? GraphMat::countTriangles_edge_seq(matrix, &control)
+                              : GraphMat::countTriangles_edge_multi(matrix, nThreads, &control);
+    } else if (options.backend == Backend::Roaring) {
+        count = GraphRoaring::countTriangles_forward(graph.state->getRoaring(nThreads), nThreads, &control);
+    } else if (options.backend == Backend::Compressed) {
+        count = GraphCompressed::countTriangles_forward(graph.state->getCompressed(nThreads), nThreads, &control);
+    } else {
+        const CSR& dag = graph.state->getDag(nThreads);
+        count = nThreads == 1 ? GraphCSR::countTriangles_forward_seq(dag, getKernel(options), &control)
+                              : GraphCSR::countTriangles_forward_multi(dag, nThreads, getKernel(options), &control);
+    }
+    control.rethrowError();
+    return {count, control.getFraction(), control.isComplete()};
+}
+
+int64_t countTriangles(const Graph& graph, const Options& options) {
+    PartialCount partial = countTrianglesPartial(graph, options);
+    if (!partial.complete) {
+        throw Cancelled(partial);
+    }
+    return partial.count;
+}
+
+vector<int64_t> countLocalTriangles(const Graph& graph, const Options& options) {
+    int nThreads = getThreads(options);
+    vector<long long> local = GraphCSR::countLocalTriangles_forward(graph.state->getDag(nThreads), nThreads);
+    return {local.begin(), local.end()};
+}
+
+void enumerateTriangles(const Graph& graph, const function<void(int, int, int)>& visit, const Options& options) {
+    int nThreads = getThreads(options);
+    GraphCSR::enumerateTriangles_forward(graph.state->getDag(nThreads), nThreads, visit);
+}
+
+int64_t countCliques(const Graph& graph, int k, const Options& options) {
+    int nThreads = getThreads(options);
+    return GraphClique::countCliques(graph.state->getDag(nThreads), k, nThreads);
+}
+
+vector<double> localClustering(const Graph& graph, const Options& options) {
+    vector<int64_t> local = countLocalTriangles(graph, options);
+    vector<double> clustering(local.size(), 0);
+    for (int u = 0; u < (int) local.size(); u++) {
+        double d = (double) graph.degree(u);
+        if (d > 1) clustering[u] = 2.0 * (double) local[u] / (d * (d - 1));
+    }
+    return clustering;
+}
+
+double transitivity(const Graph& graph, const Options& options) {
+    double wedges = 0;
+    for (int u = 0; u < graph.numNodes(); u++) {
+        double d = (double) graph.degree(u);
+        wedges += d * (d - 1) / 2;
+    }
+    Options csr = options;
+    csr.backend = Backend::Csr;
+    return wedges > 0 ? 3.0 * (double) countTriangles(graph, csr) / wedges : 0;
+}
+
+int64_t TrussDecomposition::countEdges(int k) const {
+    return count_if(trussness.begin(), trussness.end(), [k](int t) { return t >= k; });
+}
+
+TrussDecomposition trussDecomposition(const Graph& graph, const Options& options) {
+    Truss truss = GraphTruss::decompose(graph.state->graph, getThreads(options));
+    return {std::move(truss.edges), std::move(truss.trussness), truss.maxTruss};
+}
+
+}
@@ -0,0 +1,162 @@
+#include "triangles/triangles_c.h"
+#include "triangles/Triangles.h"
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <exception>
+
+using namespace std;
+
+struct triangles_graph {
+    triangles::Graph graph;
+};
+
+struct triangles_token {
+    triangles::CancellationToken token;
+};
+
+static thread_local string lastError;
+
+/**
+ * Run body, turning an exception into -1 and the error of the thread
+ */
+template<typename F>
+static int guard(F body) {
+    try {
+        body();
+        return 0;
+    } catch (const exception& e) {
+        lastError = e.what();
+    } catch (...) {
+        lastError = "unknown error";
+    }
+    return -1;
+}
+
+static triangles::Options toOptions(const triangles_options* options) {
+    triangles_options c = options ? *options : triangles_options_default();
+    triangles::Options result;
+    result.threads = c.threads;
+    result.backend = c.backend == TRIANGLES_BACKEND_MATRIX ? triangles::Backend::Matrix
+                   : c.backend == TRIANGLES_BACKEND_COMPRESSED ? triangles::Backend::Compressed
+                   : c.backend == TRIANGLES_BACKEND_ROARING ? triangles::Backend::Roaring : triangles::Backend::Csr;
+    result.kernel = c.kernel == TRIANGLES_KERNEL_ADAPTIVE ? triangles::Kernel::Adaptive : triangles::Kernel::Merge;
+    if (c.cancel) result.cancel = c.cancel->token;
+    if (c.timeout > 0) {
+        result.deadline = chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(c.timeout));
+    }
+    if (c.progress) {
+        auto progress = c.progress;
+        void* user = c.progress_user;
+        triangles::CancellationToken token = result.cancel;
+        result.progress = [progress, user, token](const triangles::Progress& p) {
+            triangles_progress report {p.done, p.total, p.fraction, p.elapsed, p.rate, p.eta};
+            if (progress(&report, user) != 0) token.cancel();
+        };
+        if (c.progress_interval > 0) result.progressInterval = c.progress_interval;
+    }
+    return result;
+}
+
+static int setError(const char* message) {
+    lastError = message;
+    return -1;
+}
+
+extern "C" {
+
+triangles_options triangles_options_default(void) {
+    return {1, TRIANGLES_BACKEND_CSR, TRIANGLES_KERNEL_MERGE, nullptr, 0, nullptr, nullptr, 1};
+}
+
+triangles_token* triangles_token_new(void) {
+    return new (nothrow) triangles_token();
+}
+
+void triangles_token_cancel(triangles_token* token) {
+    if (token) token->token.cancel();
+}
+
+void triangles_token_free(triangles_token* token) {
+    delete token;
+}
+
+const char* triangles_last_error(void) {
+    return lastError.c_str();
+}
+
+int triangles_graph_from_edges_i32(int32_t nNodes, const int32_t* sources, const int32_t* targets, int64_t nEdges,
+                                   int64_t stride, triangles_graph** out) {
+    if (!out || (nEdges > 0 && (!sources || !targets))) return setError("null argument");
+    return guard([&]() { *out = new triangles_graph{triangles::Graph::fromEdges(nNodes, sources, targets, nEdges, stride)}; });
+}
+
+int triangles_graph_from_edges_i64(int32_t nNodes, const int64_t* sources, const int64_t* targets, int64_t nEdges,
+                                   int64_t stride, triangles_graph** out) {
+    if (!out || (nEdges > 0 && (!sources || !targets))) return setError("null argument");
+    return guard([&]() { *out = new triangles_graph{triangles::Graph::fromEdges(nNodes, sources, targets, nEdges, stride)}; });
+}
+
+int triangles_graph_load(const char* path, triangles_graph** out) {
+    if (!path || !out) return setError("null argument");
+    return guard([&]() { *out = new triangles_graph{triangles::Graph::load(path)}; });
+}
+
+int triangles_graph_save(const triangles_graph* graph, const char* path) {
+    if (!graph || !path) return setError("null argument");
+    return guard([&]() { graph->graph.save(path); });
+}
+
+void triangles_graph_free(triangles_graph* graph) {
+    delete graph;
+}
+
+int32_t triangles_graph_num_nodes(const triangles_graph* graph) {
+    return graph ? graph->graph.numNodes() : 0;
+}
+
+int64_t triangles_graph_num_edges(const triangles_graph* graph) {
+    return graph ? graph->graph.numEdges() : 0;
+}
+
+int triangles_count(const triangles_graph* graph, const triangles_options* options, int64_t* count) {
+    if (!graph || !count) return setError("null argument");
+    return guard([&]() { *count = triangles::countTriangles(graph->graph, toOptions(options)); });
+}
+
+int triangles_count_partial(const triangles_graph* graph, const triangles_options* options, int64_t* count, double* fraction) {
+    if (!graph || !count) return setError("null argument");
+    return guard([&]() {
+        triangles::PartialCount partial = triangles::countTrianglesPartial(graph->graph, toOptions(options));
+        *count = partial.count;
+        if (fraction) *fraction = partial.complete ? 1 : partial.fraction;
+    });
+}
+
+int triangles_count_local(const triangles_graph* graph, const triangles_options* options, int64_t* counts,
+                          size_t capacity) {
+    if (!graph || !counts) return setError("null argument");
+    if (capacity < (size_t) graph->graph.numNodes()) return setError("counts is smaller than the number of nodes");
+    return guard([&]() {
+        vector<int64_t> local = triangles::countLocalTriangles(graph->graph, toOptions(options));
+        copy(local.begin(), local.end(), counts);
+    });
+}
+
+int triangles_enumerate(const triangles_graph* graph, const triangles_options* options,
+                        int (*visit)(int32_t u, int32_t v, int32_t w, void* user), void* user) {
+    if (!graph || !visit) return setError("null argument");
+    return guard([&]() {
+        triangles::enumerateTriangles(graph->graph, [visit, user](int u, int v, int w) { visit(u, v, w, user); },
+                                      toOptions(options));
+    });
+}
+
+int triangles_count_cliques(const triangles_graph* graph, int k, const triangles_options* options, int64_t* count) {
+    if (!graph || !count) return setError("null argument");
+    return guard([&]() { *count = triangles::countCliques(graph->graph, k, toOptions(options)); });
+}
+
+}
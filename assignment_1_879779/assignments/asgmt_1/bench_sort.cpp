@@ -0,0 +1,163 @@
+#include "RadixSort.h"
+#include "Benchmark.h"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#ifdef HAVE_PARALLEL_STL
+#include <execution>
+#include <tbb/global_control.h>
+#endif
+
+using namespace std;
+
+#define RESULTS_DIR "../assignments/asgmt_1/execution_times/" //default directory of the CSV results
+
+/**
+ * Command-line options of the sort benchmark
+ */
+struct SortOptions {
+    long long keys = 10000000;
+    int nodes = 1 << 20;        // node ids of the random edges
+    unsigned seed = 1;
+    vector<int> threads = {1};
+    BenchmarkConfig benchmark;
+    string resultsDir = RESULTS_DIR;
+    string output;              // name of the results, not saved if empty
+};
+
+void printUsage() {
+    cout << "Usage: bench_sort [options]\n"
+            "Sorts random edges packed as u << 32 | v with std::sort, parallel std::sort (when built with TBB),\n"
+            "the LSD radix sort and the in-place MSD radix sort, each run includes copying the unsorted keys.\n"
+            "  --keys N              edges to sort (default 10000000)\n"
+            "  --nodes N             node ids of the edges are below N (default 1048576)\n"
+            "  --seed S              of the random edges (default 1)\n"
+            "  --threads LIST        thread counts, e.g. 1,2,4 (default 1)\n"
+            "  --repetitions N       minimum timed runs for each thread count (default 5)\n"
+            "  --time-budget S       stop repeating after S seconds for each thread count (default 10)\n"
+            "  --results-dir DIR     directory of the results (default " RESULTS_DIR ")\n"
+            "  --output NAME         save the results in results_NAME_<method>.json and .csv" << endl;
+}
+
+SortOptions parseOptions(int argc, char** argv) {
+    SortOptions options;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        auto value = [&]() -> string {
+            if (i + 1 >= argc) throw invalid_argument("missing value for " + arg);
+            return argv[++i];
+        };
+
+        if (arg == "--keys") options.keys = stoll(value());
+        else if (arg == "--nodes") options.nodes = stoi(value());
+        else if (arg == "--seed") options.seed = (unsigned) stoul(value());
+        else if (arg == "--threads") {
+            options.threads.clear();
+            stringstream in(value());
+            string item;
+            while (getline(in, item, ',')) options.threads.push_back(stoi(item));
+        }
+        else if (arg == "--repetitions") options.benchmark.minRepetitions = stoi(value());
+        else if (arg == "--time-budget") options.benchmark.timeBudget = stod(value());
+        else if (arg == "--results-dir") options.resultsDir = value();
+        else if (arg == "--output") options.output = value();
+        else if (arg == "--help") {
+            printUsage();
+            exit(0);
+        }
+        else throw invalid_argument("unknown option " + arg);
+    }
+    if (options.keys < 1 || options.nodes < 2) throw invalid_argument("--keys and --nodes must be positive");
+    for (int t: options.threads) {
+        if (t < 1) throw invalid_argument("thread counts must be positive");
+    }
+    if (options.threads.empty()) throw invalid_argument("empty thread list");
+    return options;
+}
+
+int main(int argc, char** argv) {
+    SortOptions options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        printUsage();
+        return 2;
+    }
+
+    // Edges u < v, as the canonical keys of the external and dynamic modes
+    mt19937_64 gen(options.seed);
+    uniform_int_distribution<int> node(0, options.nodes - 1);
+    vector<uint64_t> input(options.keys);
+    for (uint64_t& key: input) {
+        int u = node(gen), v = node(gen);
+        while (u == v) v = node(gen);
+        key = RadixSort::pack(min(u, v), max(u, v));
+    }
+    vector<uint64_t> sorted = input;
+    sort(sorted.begin(), sorted.end());
+    long long expected = (long long) sorted[sorted.size() / 2];
+
+    vector<pair<string, function<void(vector<uint64_t>&, int)>>> methods = {
+            {"copy", [](vector<uint64_t>&, int) {}},
+            {"std::sort", [](vector<uint64_t>& keys, int) { sort(keys.begin(), keys.end()); }},
+#ifdef HAVE_PARALLEL_STL
+            {"std::sort(par)", [](vector<uint64_t>& keys, int nThreads) {
+                tbb::global_control control(tbb::global_control::max_allowed_parallelism, nThreads);
+                sort(execution::par, keys.begin(), keys.end());
+            }},
+#endif
+            {"radix", [](vector<uint64_t>& keys, int nThreads) { RadixSort::sort(keys, nThreads); }},
+            {"radix in place", [](vector<uint64_t>& keys, int nThreads) { RadixSort::sortInPlace(keys, nThreads); }}};
+
+    cout << options.keys << " keys, node ids below " << options.nodes << endl;
+    cout << left << setw(16) << "method" << right << setw(8) << "threads" << setw(12) << "median ms"
+         << setw(12) << "p95 ms" << setw(12) << "Mkeys/s" << setw(10) << "speedup" << endl;
+    double reference = 0; // median of std::sort
+    vector<uint64_t> keys;
+    int status = 0;
+    for (const auto& [name, method]: methods) {
+        vector<BenchmarkResult> results;
+        for (int t: options.threads) {
+            if (name == "std::sort" && t != options.threads.front()) continue; // sequential
+            BenchmarkResult result = Benchmark::run(t, options.benchmark, name == "copy" ? -1 : expected, [&]() {
+                keys = input;
+                method(keys, t);
+                return (long long) keys[keys.size() / 2];
+            });
+            if (name != "copy" && keys != sorted) result.correct = false;
+            if (name == "std::sort") reference = result.median;
+            results.push_back(result);
+
+            cout << left << setw(16) << name << right << setw(8) << t << fixed << setprecision(1)
+                 << setw(12) << result.median / 1e6 << setw(12) << result.p95 / 1e6
+                 << setw(12) << (double) options.keys / result.median * 1e3 << setprecision(2)
+                 << setw(10) << (reference > 0 && name != "copy" ? reference / result.median : 0.0)
+                 << (result.correct ? "" : "  WRONG") << endl;
+            cout.unsetf(ios::fixed);
+            if (!result.correct) status = 1;
+        }
+        Benchmark::computeSpeedups(results);
+
+        if (!options.output.empty()) {
+            BenchmarkMetadata metadata = Benchmark::getHostMetadata();
+            metadata.emplace_back("benchmark", "sort");
+            metadata.emplace_back("method", name);
+            metadata.emplace_back("keys", to_string(options.keys));
+            metadata.emplace_back("nodes", to_string(options.nodes));
+            string file = name;
+            replace_if(file.begin(), file.end(), [](char c) { return !isalnum((unsigned char) c); }, '_');
+            string path = options.resultsDir + "/results_" + options.output + "_" + file;
+            Benchmark::saveJson(path + ".json", metadata, results);
+            Benchmark::saveCsv(path + ".csv", metadata, results);
+        }
+    }
+    return status;
+}
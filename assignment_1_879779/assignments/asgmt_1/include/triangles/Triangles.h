@@ -0,0 +1,189 @@
+#ifndef TRIANGLES_TRIANGLES_H
+#define TRIANGLES_TRIANGLES_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Public API of the triangles library: build or load an undirected graph once, then count, enumerate or count
+ * per node as many times as needed. A Graph is immutable and cheap to copy, all the functions can be called
+ * concurrently on the same Graph. Errors are reported with std::runtime_error / std::invalid_argument.
+ */
+namespace triangles {
+
+/**
+ * Representation the kernels run on
+ */
+enum class Backend {
+    Csr,        // sorted adjacency lists, forward algorithm on the degree-ordered DAG
+    Matrix,     // adjacency matrix, O(n^2) memory, only for small dense graphs
+    Compressed, // delta-encoded DAG, about a third of the memory of Csr, decoded while intersecting
+    Roaring     // DAG of Roaring bitmaps (array, bitmap and run containers), for medium-density graphs
+};
+
+/**
+ * How two sorted lists of neighbours are intersected by the Csr backend
+ */
+enum class Kernel {
+    Merge,      // linear merge
+    Adaptive    // galloping search when one list is much longer than the other
+};
+
+/**
+ * Stops the counts it is passed to, from any thread: the copies of a token share its flag
+ */
+class CancellationToken {
+    public:
+    CancellationToken();
+    void cancel() const;
+    bool isCancelled() const;
+    const std::atomic<bool>* getFlag() const { return flag.get(); }
+
+    private:
+    std::shared_ptr<std::atomic<bool>> flag;
+};
+
+/**
+ * Progress of a count, in units of work of its backend: edges of the DAG for Csr, nodes for Compressed and
+ * Roaring, pairs of nodes for Matrix
+ */
+struct Progress {
+    std::int64_t done = 0;
+    std::int64_t total = 0;
+    double fraction = 0;
+    double elapsed = 0;  // seconds
+    double rate = 0;     // units per second
+    double eta = 0;      // seconds left at this rate
+};
+
+struct Options {
+    int threads = 1;
+    Backend backend = Backend::Csr;
+    Kernel kernel = Kernel::Merge;
+
+    // Checked by countTriangles and countTrianglesPartial between blocks of nodes
+    CancellationToken cancel {};
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    std::function<void(const Progress&)> progress {}; // called by one counting thread at a time, never
+                                                       // concurrently; an exception it throws stops the count
+                                                       // and is rethrown
+    double progressInterval = 1;                       // seconds between two calls of progress
+};
+
+/**
+ * Count of countTrianglesPartial. The backends count block by block and a stopped count adds up the blocks it
+ * finished: the triangles of their nodes for Csr, Compressed and Roaring, a third of the triangles of their
+ * edges for Matrix.
+ */
+struct PartialCount {
+    std::int64_t count = 0;
+    double fraction = 1;    // of the work done
+    bool complete = true;   // false if the token or the deadline stopped the count
+};
+
+/**
+ * Thrown by countTriangles when the token or the deadline stopped it, with what was counted
+ */
+class Cancelled : public std::runtime_error {
+    public:
+    explicit Cancelled(const PartialCount& partial);
+    PartialCount partial;
+};
+
+struct TrussDecomposition;
+
+/**
+ * Undirected simple graph on the nodes 0 .. numNodes() - 1: self loops and duplicate edges are dropped.
+ * The DAG of the forward algorithm, its compressed and Roaring versions and the adjacency matrix are built the first time a function needs them
+ * and shared by the copies of the handle.
+ */
+class Graph {
+    public:
+    Graph();
+
+    static Graph fromEdges(int nNodes, const std::vector<std::pair<int, int>>& edges, int threads = 1);
+    static Graph fromEdges(int nNodes, const std::int32_t* sources, const std::int32_t* targets, std::int64_t nEdges,
+                           std::int64_t stride = 1, int threads = 1);
+    static Graph fromEdges(int nNodes, const std::int64_t* sources, const std::int64_t* targets, std::int64_t nEdges,
+                           std::int64_t stride = 1, int threads = 1);
+    static Graph load(const std::string& path);
+    void save(const std::string& path) const;
+
+    int numNodes() const;
+    std::int64_t numEdges() const;
+    std::int64_t degree(int node) const;
+
+    struct Impl;
+
+    private:
+    explicit Graph(std::shared_ptr<const Impl> state);
+
+    friend PartialCount countTrianglesPartial(const Graph& graph, const Options& options);
+    friend std::vector<std::int64_t> countLocalTriangles(const Graph& graph, const Options& options);
+    friend void enumerateTriangles(const Graph& graph, const std::function<void(int, int, int)>& visit, const Options& options);
+    friend std::int64_t countCliques(const Graph& graph, int k, const Options& options);
+    friend TrussDecomposition trussDecomposition(const Graph& graph, const Options& options);
+
+    std::shared_ptr<const Impl> state;
+};
+
+std::int64_t countTriangles(const Graph& graph, const Options& options = {});
+
+/**
+ * countTriangles that returns what it counted when options.cancel or options.deadline stop it, instead of throwing
+ */
+PartialCount countTrianglesPartial(const Graph& graph, const Options& options = {});
+
+/**
+ * Triangles each node belongs to, the Csr backend is always used
+ */
+std::vector<std::int64_t> countLocalTriangles(const Graph& graph, const Options& options = {});
+
+/**
+ * Call visit(u, v, w) once for each triangle, in no particular order. With more than one thread visit is called
+ * concurrently and must be thread safe. The Csr backend is always used.
+ */
+void enumerateTriangles(const Graph& graph, const std::function<void(int, int, int)>& visit, const Options& options = {});
+
+/**
+ * Cliques of k >= 1 nodes (k = 3 gives the triangles), the Csr backend is always used
+ */
+std::int64_t countCliques(const Graph& graph, int k, const Options& options = {});
+
+/**
+ * Local clustering coefficient of each node, 2 t(u) / (d(u) (d(u) - 1)), 0 for the nodes of degree < 2
+ */
+std::vector<double> localClustering(const Graph& graph, const Options& options = {});
+
+/**
+ * Global clustering coefficient, 3 x triangles / paths of length 2
+ */
+double transitivity(const Graph& graph, const Options& options = {});
+
+/**
+ * Trussness of every edge: the largest k such that the edge is in the k-truss, the largest subgraph where every
+ * edge is in at least k - 2 triangles of the subgraph
+ */
+struct TrussDecomposition {
+    std::vector<std::pair<int, int>> edges;  // u < v
+    std::vector<int> trussness;              // of each edge, 2 for the edges in no triangle
+    int maxTruss = 0;
+
+    std::int64_t countEdges(int k) const;    // edges of the k-truss
+};
+
+/**
+ * Support of the edges with options.threads, the peeling is sequential. The Csr backend is always used.
+ */
+TrussDecomposition trussDecomposition(const Graph& graph, const Options& options = {});
+
+}
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef TRIANGLES_TRIANGLES_C_H
+#define TRIANGLES_TRIANGLES_C_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * C ABI of the triangles library, for programs and language bindings that cannot use the C++ API.
+ * A graph is an opaque handle, immutable once built: the functions can be called concurrently on it.
+ * Functions returning int return 0 on success and -1 on error, triangles_last_error() then describes the error
+ * of the calling thread.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct triangles_graph triangles_graph;
+
+enum triangles_backend {
+    TRIANGLES_BACKEND_CSR = 0,
+    TRIANGLES_BACKEND_MATRIX = 1,
+    TRIANGLES_BACKEND_COMPRESSED = 2,
+    TRIANGLES_BACKEND_ROARING = 3
+};
+
+enum triangles_kernel {
+    TRIANGLES_KERNEL_MERGE = 0,
+    TRIANGLES_KERNEL_ADAPTIVE = 1
+};
+
+typedef struct triangles_token triangles_token;
+
+/** Progress of a count, see triangles::Progress */
+typedef struct triangles_progress {
+    int64_t done;
+    int64_t total;
+    double fraction;
+    double elapsed;   /* seconds */
+    double rate;      /* units of work per second */
+    double eta;       /* seconds */
+} triangles_progress;
+
+typedef struct triangles_options {
+    int threads;
+    int backend;    /* triangles_backend */
+    int kernel;     /* triangles_kernel */
+
+    /* Checked by triangles_count and triangles_count_partial */
+    triangles_token* cancel;    /* NULL for none */
+    double timeout;             /* seconds from the start of the call, 0 for none */
+    /* called by one counting thread at a time, never concurrently, every progress_interval seconds; a non-zero
+       return value cancels the count (and options->cancel) */
+    int (*progress)(const triangles_progress* progress, void* user);
+    void* progress_user;
+    double progress_interval;
+} triangles_options;
+
+/** 1 thread, CSR backend, merge intersection, no token, timeout or progress */
+triangles_options triangles_options_default(void);
+
+/** Cancellation token, triangles_token_cancel stops the counts it was passed to, from any thread */
+triangles_token* triangles_token_new(void);
+void triangles_token_cancel(triangles_token* token);
+void triangles_token_free(triangles_token* token);
+
+const char* triangles_last_error(void);
+
+/**
+ * Build a graph from caller-owned arrays, read in place and not used after the call: edge i is
+ * sources[i * stride] - targets[i * stride]. Interleaved pairs are sources = edges, targets = edges + 1, stride = 2.
+ * @param nNodes at least the largest node id + 1, grown if an edge has a larger id
+ * @param out receives the handle, released with triangles_graph_free
+ */
+int triangles_graph_from_edges_i32(int32_t nNodes, const int32_t* sources, const int32_t* targets, int64_t nEdges,
+                                   int64_t stride, triangles_graph** out);
+int triangles_graph_from_edges_i64(int32_t nNodes, const int64_t* sources, const int64_t* targets, int64_t nEdges,
+                                   int64_t stride, triangles_graph** out);
+
+/** SNAP edge list, Matrix Market, METIS, binary int32 edge list or snapshot, detected from the file */
+int triangles_graph_load(const char* path, triangles_graph** out);
+int triangles_graph_save(const triangles_graph* graph, const char* path);
+void triangles_graph_free(triangles_graph* graph);
+
+int32_t triangles_graph_num_nodes(const triangles_graph* graph);
+int64_t triangles_graph_num_edges(const triangles_graph* graph);
+
+/** options may be NULL for the defaults. A count stopped by the token, the timeout or progress is an error. */
+int triangles_count(const triangles_graph* graph, const triangles_options* options, int64_t* count);
+
+/**
+ * triangles_count that succeeds when it is stopped, with what it counted, see triangles::PartialCount
+ * @param fraction receives the fraction of the work done, 1 for a complete count; may be NULL
+ */
+int triangles_count_partial(const triangles_graph* graph, const triangles_options* options, int64_t* count, double* fraction);
+
+/**
+ * @param counts caller-owned array that receives the triangles of each node
+ * @param capacity elements of counts, an error if smaller than triangles_graph_num_nodes
+ */
+int triangles_count_local(const triangles_graph* graph, const triangles_options* options, int64_t* counts,
+                          size_t capacity);
+
+/**
+ * visit is called once for each triangle, concurrently from all the threads when options->threads > 1.
+ * A non-zero return value of visit is ignored, the enumeration cannot be stopped.
+ */
+int triangles_enumerate(const triangles_graph* graph, const triangles_options* options,
+                        int (*visit)(int32_t u, int32_t v, int32_t w, void* user), void* user);
+
+int triangles_count_cliques(const triangles_graph* graph, int k, const triangles_options* options, int64_t* count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
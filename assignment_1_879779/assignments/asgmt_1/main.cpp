@@ -1,170 +1,978 @@
 #include "Graph_ds.h"
+#include "Graph_csr.h"
+#include "Graph_compressed.h"
+#include "Graph_roaring.h"
+#include "Graph_clique.h"
+#include "Graph_partition.h"
+#include "Graph_external.h"
+#include "Graph_directed.h"
+#include "Graph_reader.h"
+#include "Decompress.h"
+#include "Benchmark.h"
+#include "Trace.h"
+#include "Memory.h"
+#include "Arena.h"
+#include "CostModel.h"
+#include "Control.h"
+#include "Checkpoint.h"
 
 #include <iostream>
 #include <iomanip>
 #include <sstream>
 #include <fstream>
 #include <vector>
-#include <chrono>
+#include <string>
 #include <numeric>
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <filesystem>
+#include <chrono>
+#include <atomic>
+#include <csignal>
 #include <omp.h>
 
 using namespace std;
 
-#define N_THREADS 20 //max thread to use
-#define N_ITERATION 2 //test iterations
+#define DATA_DIR "../assignments/asgmt_1/data/" //default directory of the SNAP datasets
+#define RESULTS_DIR "../assignments/asgmt_1/execution_times/" //default directory of the CSV results
+#define COST_MODEL_FILE "cost_model.txt" //cost model of --algorithm auto, in the results directory
+
+/**
+ * Command-line options of a run
+ */
+struct Options {
+    string dataset;             // name of a known SNAP dataset, see getData
+    string input;               // graph file, see GraphReader
+    string format = "auto";     // of input, detected if auto
+    string snapshot;            // binary snapshot written by GraphCSR::saveSnapshot
+    string generate;            // generator spec gnp:<nodes>:<density>[:<seed>]
+    string saveSnapshot;        // where to write the snapshot of the loaded graph
+    string dataDir = DATA_DIR;
+    string resultsDir = RESULTS_DIR;
+    string output;              // name of the JSON/CSV results, not saved if empty
+    string trace;               // Chrome trace-event file, not saved if empty
+    bool phases = false;        // print the phase breakdown
+
+    string algorithm = "edge";
+    string backend = "matrix";
+    string kernel = "merge";    // intersection of the csr backend
+    vector<int> threads = {1};
+    bool threadsSet = false;    // --threads given, otherwise auto also picks the thread count
+    string costModel;           // cost model file, default COST_MODEL_FILE in resultsDir
+    bool calibrate = false;     // fit the cost model to the saved results instead of counting
+    BenchmarkConfig benchmark;
+    long long expected = -1;    // -1 if the count is not checked
+    double timeout = 0;         // seconds a run may take, 0 for no limit
+    bool progress = false;      // print the progress of the runs
+
+    int k = 3;                  // clique size
+    int colors = 4;             // colorful partitions
+    long long memory = 1LL << 30; // external memory budget in bytes
+    long long memoryBudget = -1;  // bytes the whole run may use, -1 for 90% of the available memory, 0 not checked
+    string tmpDir = "/tmp";
+    string checkpoint;          // progress file of colorful and external, not saved if empty
+    double checkpointInterval = CHECKPOINT_INTERVAL; // seconds between two writes of the checkpoint
+    bool resume = false;        // skip the work saved in the checkpoint
+    string censusNodes;         // CSV of the census of each node, not saved if empty
+};
+
+/**
+ * Graph representations needed by the selected algorithm, built once before the timed runs
+ */
+struct Graphs {
+    string path;                     // file of edges, for the algorithms that read it themselves
+    int nNodes = 0;
+    long long nEdges = 0;
+    long long maxDegree = 0;
+    vector<vector<bool>> matrix;
+    vector<vector<int>> allInts;
+    vector<pair<int, int>> edges;
+    CSR dag;
+    DirectedCSR directed;
+    TriangleCensus census;           // of the last run of census, with the counts of the nodes if saved
+    CompressedCSR compressed;
+    RoaringGraph roaring;
+    double compressionRatio = 0;     // bytes of the CSR DAG / bytes of the compressed one
+    double decodeRate = 0;           // neighbours decoded per second by one thread
+    MemoryReport memory;
+    GraphStats stats;
+};
 
 /**
  *
- * @param option dataset selection
+ * @param name dataset selection
  * @return data related to the selected dataset
  */
-auto getData(int option){
-    struct graphData {int numNodes; int numEdges; int realTriangles; string inputFile;};
-
-    switch (option) {
-        case 1:
-            // email-Eu-core network 105461 triangles
-            // numNodes = 1005, numEdges = 25571 ,"../assignments/asgmt_1/data/email-Eu-core.txt";
-            return graphData {1005, 25571, 105461,
-                              "../assignments/asgmt_1/data/email-Eu-core.txt"};
-        case 2:
-            // Social circles: Facebook 1612010 triangles
-            // numNodes = 4039, numEdges = 88234, "../assignments/asgmt_1/data/facebook_combined.txt";
-            return graphData {4039, 88234, 1612010,
-                              "../assignments/asgmt_1/data/facebook_combined.txt"};
-        case 3:
-            // Enron email network 727044 triangles
-            // numNodes = 36692, numEdges = 183831, "../assignments/asgmt_1/data/Email-Enron.txt";
-            return graphData {36692, 183831, 727044,
-                              "../assignments/asgmt_1/data/Email-Enron.txt"};
-        case 4:
-            // Brightkite 494728 triangles
-            // numNodes = 58228, numEdges = 214078, "../assignments/asgmt_1/data/Brightkite_edges.txt";
-            return graphData {58228, 214078, 494728,
-                              "../assignments/asgmt_1/data/Brightkite_edges.txt"};
-        default:
-            throw std::invalid_argument("Invalid selection");
-    }
-}
-
-/**
- * Run the algorithm with either the algorithm that count triangles through edges and divide by 3,
- * or the algorithm that checks the triple of nodes.
- * @param nThreads number of threads that need to be used to run the algorithm
- * @param graph
- * @param execution_times number of times to execute the algorithm
- */
-void test(int nThreads, const vector<vector<bool>>& graph, vector<vector<double>>& execution_times) {
-    for (int j = 0; j < N_ITERATION; j++) {
-        cout << "\n" << "--number of threads: " << nThreads << ", " << "iteration: " << j+1 << "--" << endl;
-        auto start = chrono::high_resolution_clock::now();
-
-        int numTriangles;
-        if(nThreads == 1) {
-            numTriangles = GraphMat::countTriangles_edge_seq(graph);
-//            numTriangles = GraphMat::countTriangles_node_seq(graph);
-        } else {
-            numTriangles = GraphMat::countTriangles_edge_multi(graph, nThreads);
-//            numTriangles = GraphMat::countTriangles_node_multi(graph, nThreads);
-        }
-
-        auto end = chrono::high_resolution_clock::now();
-        auto elapsed = chrono::duration_cast<chrono::milliseconds> (end - start);
-
-        // Print the total count of triangles
-        cout << "Total number of triangles in the graph: " << numTriangles << endl;
-        cout << "Elapsed: " << elapsed.count() << " ms." << endl;
-
-        execution_times[nThreads - 1][j] = elapsed.count(); //row = nThreads, column = i-th execution
-    }
-}
-
-/**
- * Run the algorithm that count triangles through edges and divide by 3 but with precomputed intersection
- * @param nThreads number of threads that need to be used to run the algorithm
- * @param graph
- * @param execution_times number of times to execute the algorithm
- * @param allInts matrix with all the intersection precomputed
- */
-void test_fast(int nThreads, const vector<vector<bool>>& graph, vector<vector<double>>& execution_times, vector<vector<int>>& allInts) {
-    for (int j = 0; j < N_ITERATION; j++) {
-        cout << "\n" << "--number of threads: " << nThreads << ", " << "iteration: " << j+1 << "--" << endl;
-        auto start = chrono::high_resolution_clock::now();
-        int numTriangles;
-        if(nThreads == 1) {
-            numTriangles = GraphMat::ctTr_edgeFast_seq(graph, allInts);
-        } else {
-            numTriangles = GraphMat::ctTr_edgeFast_multi(graph, nThreads, allInts);
-        }
-        auto end = chrono::high_resolution_clock::now();
-        auto elapsed = chrono::duration_cast<chrono::milliseconds> (end - start);
-
-        // Print the total count of triangles
-        cout << "Total number of triangles in the graph: " << numTriangles << endl;
-        cout << "Elapsed: " << elapsed.count() << " ms." << endl;
-        execution_times[nThreads - 1][j] = elapsed.count(); //row = nThreads, column = i-th execution
-    }
-}
-
-/**
- * Save the execution times for each number of threads used to run the algorithm on a graph in a .CSV file
- * @param execTimes 2D vector that contains all the execution times
- * @param name
- */
-void saveExecutionTimes(const vector<vector<double>>& execTimes, const string& name) {
-    stringstream filename;
-    filename << "../assignments/asgmt_1/execution_times/results_" << name << ".csv";
-
-    // Open and write the execution times to the CSV file
-    ofstream outFile(filename.str(), ios::trunc);
-    if (outFile.is_open()) {
-        for (const auto& row : execTimes) {
-            for (const auto& time : row) {
-                outFile << time << ",";
-            }
-            outFile << endl;
+auto getData(const string& name){
+    struct graphData {int numNodes; int numEdges; long long realTriangles; string inputFile;};
+
+    if (name == "email") {
+        // email-Eu-core network 105461 triangles
+        return graphData {1005, 25571, 105461, "email-Eu-core.txt"};
+    } else if (name == "facebook") {
+        // Social circles: Facebook 1612010 triangles
+        return graphData {4039, 88234, 1612010, "facebook_combined.txt"};
+    } else if (name == "enron") {
+        // Enron email network 727044 triangles
+        return graphData {36692, 183831, 727044, "Email-Enron.txt"};
+    } else if (name == "brightkite") {
+        // Brightkite 494728 triangles
+        return graphData {58228, 214078, 494728, "Brightkite_edges.txt"};
+    }
+    throw invalid_argument("unknown dataset " + name);
+}
+
+/**
+ * File of the selected dataset in --data-dir, its .gz or .zst copy if there is no plain one
+ */
+string getDataPath(const Options& options) {
+    string path = options.dataDir + "/" + getData(options.dataset).inputFile;
+    for (const char* suffix: {"", ".gz", ".zst"}) {
+        if (filesystem::exists(path + suffix)) return path + suffix;
+    }
+    return path;
+}
+
+void printUsage() {
+    cout << "Usage: main (--dataset NAME | --input FILE | --snapshot FILE | --generate gnp:N:P[:SEED]) [options]\n"
+            "  --dataset NAME        email, facebook, enron or brightkite, read from --data-dir, checks the known count\n"
+            "  --input FILE          graph file: SNAP edge list (\"u v\" lines), Matrix Market, METIS, binary int32 pairs\n"
+            "                        or snapshot, detected from its content and extension; SNAP lists may be .gz or .zst\n"
+            "  --format NAME         format of --input: auto (default), snap, matrix-market, metis, binary or snapshot\n"
+            "  --snapshot FILE       binary snapshot written by --save-snapshot\n"
+            "  --generate SPEC       random graph with N nodes and density P\n"
+            "  --save-snapshot FILE  write the loaded graph as a binary snapshot\n"
+            "  --algorithm NAME      node, edge, fast, better, clique, colorful, external, census or auto (default edge)\n"
+            "                        census counts the directed triangles by type, from the arcs of --input, --dataset or --generate\n"
+            "  --backend NAME        matrix, csr, compressed (delta-encoded csr) or roaring (bitmap containers),\n"
+            "                        the last two only run edge (default matrix)\n"
+            "  --kernel NAME         intersection of the csr backend, merge or adaptive (default merge)\n"
+            "  --cost-model FILE     cost model of auto (default " COST_MODEL_FILE " in --results-dir, if it exists)\n"
+            "  --calibrate           fit the cost model to the results_*.json of --results-dir and save it\n"
+            "  --threads LIST        thread counts, e.g. 1,2,4 or 1-20 (default 1)\n"
+            "  --repetitions N       minimum timed runs for each thread count (default 5)\n"
+            "  --max-repetitions N   maximum timed runs for each thread count (default 100)\n"
+            "  --target-error E      stop repeating when the relative error of the mean is below E (default 0.02)\n"
+            "  --time-budget S       stop repeating after S seconds for each thread count (default 10)\n"
+            "  --warmup N            untimed runs before the timed ones (default 1)\n"
+            "  --perf                record cycles, instructions, LLC/branch/dTLB misses of each run (Linux)\n"
+            "  --huge-pages MODE     pages of the large graph arrays: off, thp (transparent, default) or explicit\n"
+            "                        (MAP_HUGETLB from the reserved pool, thp when it is empty)\n"
+            "  --phases              print the time spent in each phase (parse, build, reorder, count...)\n"
+            "  --trace FILE          also save the phases of every thread as a Chrome trace-event file\n"
+            "  --expected COUNT      exit with status 1 if a run disagrees\n"
+            "  --timeout S           stop a run after S seconds and print its partial count (exit status 3), as Ctrl-C does\n"
+            "  --progress            print the fraction done, the rate and the time left of a run every second\n"
+            "  --k K                 clique size for --algorithm clique (default 3)\n"
+            "  --colors C            colors for --algorithm colorful (default 4)\n"
+            "  --memory BYTES        memory budget for --algorithm external, e.g. 256M (default 1G)\n"
+            "  --memory-budget BYTES memory the run may use, another algorithm is chosen if the selected one does not\n"
+            "                        fit and the run is refused if none does (default: 90% of the available memory, 0: no check)\n"
+            "  --tmp-dir DIR         scratch directory of colorful and external (default /tmp)\n"
+            "  --checkpoint FILE     save the progress of colorful and external in FILE, and at once on Ctrl-C or SIGTERM\n"
+            "  --checkpoint-interval S\n"
+            "                        seconds between two saves of the checkpoint (default 60)\n"
+            "  --resume              skip the work saved in the --checkpoint file, if it exists\n"
+            "  --data-dir DIR        directory of the datasets (default " DATA_DIR ")\n"
+            "  --results-dir DIR     directory of the results (default " RESULTS_DIR ")\n"
+            "  --census-nodes FILE   save the census of every node as CSV\n"
+            "  --output NAME         save the results in results_NAME.json and results_NAME.csv" << endl;
+}
+
+/**
+ * Parse a list of thread counts like "1,2,4" or "1-20" or "1,8-12"
+ * @param list
+ * @return
+ */
+vector<int> parseThreads(const string& list) {
+    vector<int> threads;
+    stringstream in(list);
+    string item;
+    while (getline(in, item, ',')) {
+        size_t dash = item.find('-');
+        int first = stoi(item.substr(0, dash));
+        int last = dash == string::npos ? first : stoi(item.substr(dash + 1));
+        for (int t = first; t <= last; t++) {
+            threads.push_back(t);
         }
-        outFile.close();
+    }
+    for (int t: threads) {
+        if (t < 1) throw invalid_argument("thread counts must be positive");
+    }
+    if (threads.empty()) throw invalid_argument("empty thread list");
+    return threads;
+}
+
+Options parseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        auto value = [&]() -> string {
+            if (i + 1 >= argc) throw invalid_argument("missing value for " + arg);
+            return argv[++i];
+        };
+
+        if (arg == "--dataset") options.dataset = value();
+        else if (arg == "--input") options.input = value();
+        else if (arg == "--snapshot") options.snapshot = value();
+        else if (arg == "--format") options.format = value();
+        else if (arg == "--generate") options.generate = value();
+        else if (arg == "--save-snapshot") options.saveSnapshot = value();
+        else if (arg == "--algorithm") options.algorithm = value();
+        else if (arg == "--backend") options.backend = value();
+        else if (arg == "--kernel") options.kernel = value();
+        else if (arg == "--cost-model") options.costModel = value();
+        else if (arg == "--calibrate") options.calibrate = true;
+        else if (arg == "--threads") {
+            options.threads = parseThreads(value());
+            options.threadsSet = true;
+        }
+        else if (arg == "--repetitions") options.benchmark.minRepetitions = stoi(value());
+        else if (arg == "--max-repetitions") options.benchmark.maxRepetitions = stoi(value());
+        else if (arg == "--target-error") options.benchmark.targetRelError = stod(value());
+        else if (arg == "--time-budget") options.benchmark.timeBudget = stod(value());
+        else if (arg == "--warmup") options.benchmark.warmup = stoi(value());
+        else if (arg == "--perf") options.benchmark.perfCounters = true;
+        else if (arg == "--huge-pages") Arena::setHugePages(Arena::parseHugePages(value()));
+        else if (arg == "--phases") options.phases = true;
+        else if (arg == "--trace") options.trace = value();
+        else if (arg == "--expected") options.expected = stoll(value());
+        else if (arg == "--timeout") options.timeout = stod(value());
+        else if (arg == "--progress") options.progress = true;
+        else if (arg == "--k") options.k = stoi(value());
+        else if (arg == "--colors") options.colors = stoi(value());
+        else if (arg == "--memory") options.memory = Memory::parseBytes(value());
+        else if (arg == "--memory-budget") options.memoryBudget = Memory::parseBytes(value());
+        else if (arg == "--tmp-dir") options.tmpDir = value();
+        else if (arg == "--checkpoint") options.checkpoint = value();
+        else if (arg == "--checkpoint-interval") options.checkpointInterval = stod(value());
+        else if (arg == "--resume") options.resume = true;
+        else if (arg == "--data-dir") options.dataDir = value();
+        else if (arg == "--results-dir") options.resultsDir = value();
+        else if (arg == "--census-nodes") options.censusNodes = value();
+        else if (arg == "--output") options.output = value();
+        else if (arg == "--help") {
+            printUsage();
+            exit(0);
+        }
+        else throw invalid_argument("unknown option " + arg);
+    }
+
+    if (options.calibrate) {
+        return options;
+    }
+    int nSources = !options.dataset.empty() + !options.input.empty() + !options.snapshot.empty() + !options.generate.empty();
+    if (nSources != 1) {
+        throw invalid_argument("exactly one of --dataset, --input, --snapshot and --generate is needed");
+    }
+    if (options.backend != "matrix" && options.backend != "csr" && options.backend != "compressed" && options.backend != "roaring") {
+        throw invalid_argument("unknown backend " + options.backend);
+    }
+    const string& a = options.algorithm;
+    if ((a == "node" || a == "fast" || a == "better") && options.backend != "matrix") {
+        throw invalid_argument(a + " needs --backend matrix");
+    }
+    if (a == "clique" && options.backend != "csr") {
+        throw invalid_argument("clique needs --backend csr");
+    }
+    if ((options.backend == "compressed" || options.backend == "roaring") && a != "edge") {
+        throw invalid_argument("--backend " + options.backend + " only runs edge");
+    }
+    if ((a == "colorful" || a == "external") && options.input.empty() && options.dataset.empty()) {
+        throw invalid_argument(a + " reads the edges from a file, use --input or --dataset");
+    }
+    if (!options.input.empty() && options.format == "auto") {
+        options.format = GraphReader::detectFormat(options.input);
+    }
+    vector<string> formats = GraphReader::getFormats();
+    if (!options.input.empty() && find(formats.begin(), formats.end(), options.format) == formats.end()) {
+        throw invalid_argument("unknown format " + options.format);
+    }
+    if ((a == "colorful" || a == "external") && !options.input.empty() && options.format != "snap") {
+        throw invalid_argument(a + " streams SNAP edge lists, " + options.input + " is " + options.format);
+    }
+    if (a == "colorful" || a == "external") {
+        string path = options.input.empty() ? getDataPath(options) : options.input;
+        if (Decompress::detect(path) != COMPRESSION_NONE) {
+            throw invalid_argument(a + " streams plain text, " + path + " is " + Decompress::getName(Decompress::detect(path)) + " compressed");
+        }
+    }
+    if (a == "census" && (!options.snapshot.empty() || !options.saveSnapshot.empty())) {
+        throw invalid_argument("census needs the direction of the arcs, snapshots are undirected");
+    }
+    if (a == "census" && !options.input.empty() && options.format != "snap") {
+        throw invalid_argument("census reads the arcs of SNAP edge lists, " + options.input + " is " + options.format);
+    }
+    if (!options.censusNodes.empty() && a != "census") {
+        throw invalid_argument("--census-nodes needs --algorithm census");
+    }
+    if (a != "node" && a != "edge" && a != "fast" && a != "better" && a != "clique" && a != "colorful" && a != "external"
+        && a != "census" && a != "auto") {
+        throw invalid_argument("unknown algorithm " + a);
+    }
+    if (options.timeout < 0) {
+        throw invalid_argument("the timeout must be non-negative");
+    }
+    if ((options.timeout > 0 || options.progress) && (a == "clique" || a == "colorful" || a == "external" || a == "census")) {
+        throw invalid_argument(a + " cannot be stopped, --timeout and --progress need node, edge, fast or better");
+    }
+    if (!options.checkpoint.empty() && a != "colorful" && a != "external" && a != "auto") {
+        throw invalid_argument("--checkpoint needs --algorithm colorful or external");
+    }
+    if (options.resume && options.checkpoint.empty()) {
+        throw invalid_argument("--resume needs --checkpoint");
+    }
+    if (options.checkpointInterval < 0) {
+        throw invalid_argument("the checkpoint interval must be non-negative");
+    }
+    if (!options.checkpoint.empty()) {
+        // A resumed count is not a timing, count once
+        if (options.threads.size() != 1) {
+            throw invalid_argument("--checkpoint needs a single thread count");
+        }
+        options.benchmark.warmup = 0;
+        options.benchmark.minRepetitions = options.benchmark.maxRepetitions = 1;
+    }
+    if (options.kernel != "merge" && options.kernel != "adaptive") {
+        throw invalid_argument("unknown kernel " + options.kernel);
+    }
+    if (options.benchmark.minRepetitions < 1 || options.benchmark.warmup < 0) {
+        throw invalid_argument("repetitions must be positive and warm-up runs non-negative");
+    }
+    options.benchmark.maxRepetitions = max(options.benchmark.maxRepetitions, options.benchmark.minRepetitions);
+    return options;
+}
+
+/**
+ * Parse a generator spec gnp:<nodes>:<density>[:<seed>]
+ * @param spec
+ * @param nNodes
+ * @param density
+ * @param seed random if the spec has none
+ */
+void parseGenerator(const string& spec, int& nNodes, double& density, unsigned& seed) {
+    vector<string> parts;
+    stringstream in(spec);
+    string part;
+    while (getline(in, part, ':')) parts.push_back(part);
+    if (parts.size() < 3 || parts.size() > 4 || parts[0] != "gnp") {
+        throw invalid_argument("generator spec must be gnp:<nodes>:<density>[:<seed>]");
+    }
+    nNodes = stoi(parts[1]);
+    density = stod(parts[2]);
+    seed = parts.size() == 4 ? (unsigned) stoul(parts[3]) : random_device{}();
+}
+
+/**
+ * Generate the edges of a generator spec
+ * @param spec
+ * @param nNodes set to the number of nodes of the spec
+ * @return
+ */
+vector<pair<int, int>> generateEdges(const string& spec, int& nNodes) {
+    double density;
+    unsigned seed;
+    parseGenerator(spec, nNodes, density, seed);
+    return GraphMat::getEdges_dense(nNodes, density, seed);
+}
+
+/**
+ * Estimate the no. of edges of a file from its size and the length of the edge lines in its first megabyte,
+ * decompressed if the file is compressed
+ * @param path
+ * @return
+ */
+long long estimateLines(const string& path) {
+    long long sampled = 0;
+    string head = Decompress::readHead(path, 1 << 20, &sampled);
+    auto size = (long long) filesystem::file_size(path);
+
+    long long nLines = 0;
+    stringstream in(head);
+    string line;
+    while (getline(in, line)) {
+        if (!line.empty() && line[0] != '#') nLines++;
+    }
+    return sampled > 0 ? (long long) ((double) size * (double) nLines / (double) sampled) : 0;
+}
+
+/**
+ * Size of the graph before loading it: the nodes of a dataset, a generator or a snapshot are known,
+ * the edges of a file are estimated from its size and the nodes of a file are not known (0)
+ */
+void estimateSize(const Options& options, long long& nNodes, long long& nEdges) {
+    nNodes = 0;
+    nEdges = 0;
+    if (!options.dataset.empty()) {
+        nNodes = getData(options.dataset).numNodes;
+        nEdges = estimateLines(getDataPath(options));
+    } else if (!options.input.empty()) {
+        if (!GraphReader::getSize(options.input, options.format, nNodes, nEdges)) nEdges = estimateLines(options.input);
+    } else if (!options.generate.empty()) {
+        int n;
+        double density;
+        unsigned seed;
+        parseGenerator(options.generate, n, density, seed);
+        nNodes = n;
+        nEdges = (long long) (density * (double) n * (n - 1) / 2);
     } else {
-        cerr << "Error: unable to open output file." << endl;
+        int n;
+        long long nNeighbors;
+        GraphCSR::getSnapshotSize(options.snapshot, n, nNeighbors);
+        nNodes = n;
+        nEdges = nNeighbors / 2;
+    }
+}
+
+/**
+ * Check the estimated footprint of the selected algorithm against the memory budget. If it does not fit,
+ * switch to the first that does: the CSR backend, colorful with more colors, external with a smaller buffer.
+ * @param options algorithm, backend, colors and memory are updated
+ * @param nNodes 0 if not known yet
+ * @param nEdges
+ */
+void fitMemoryBudget(Options& options, long long nNodes, long long nEdges) {
+    long long budget = options.memoryBudget;
+    if (budget <= 0) return;
+    if (options.algorithm == "auto") {
+        // auto only picks among what fits after loading, so here only the load has to fit
+        if (Memory::estimateFootprint("edge", "csr", nNodes, nEdges, 0, 0) <= budget) return;
+        options.algorithm = "edge";
+        options.backend = "csr";
+    }
+
+    struct Choice {string algorithm; string backend; int colors; long long memory;};
+    vector<Choice> choices = {{options.algorithm, options.backend, options.colors, options.memory}};
+    bool triangles = (options.algorithm != "clique" || options.k == 3) && options.algorithm != "census";
+    bool fromFile = (!options.input.empty() && options.format == "snap") || !options.dataset.empty();
+    if (fromFile) fromFile = Decompress::detect(options.input.empty() ? getDataPath(options) : options.input) == COMPRESSION_NONE;
+    long long externalMemory = min(options.memory, (budget - nNodes * 12) / 4 * 3); // a quarter left for the rest
+
+    if (options.algorithm != "external" && triangles) {
+        choices.push_back({"edge", "csr", options.colors, options.memory});
+        choices.push_back({"edge", "compressed", options.colors, options.memory});
+        for (int c = max(options.colors, 4); fromFile && c <= 64; c *= 2) {
+            choices.push_back({"colorful", "csr", c, options.memory});
+        }
+    }
+    if (triangles && fromFile && externalMemory >= (1 << 20)) {
+        choices.push_back({"external", "csr", options.colors, externalMemory});
+    }
+
+    long long first = Memory::estimateFootprint(options.algorithm, options.backend, nNodes, nEdges, options.colors, options.memory);
+    for (const Choice& choice: choices) {
+        long long footprint = Memory::estimateFootprint(choice.algorithm, choice.backend, nNodes, nEdges, choice.colors, choice.memory);
+        if (footprint > budget) continue;
+
+        if (footprint != first || choice.algorithm != options.algorithm) {
+            auto describe = [](const Choice& c) {
+                return c.algorithm == "colorful" ? "colorful (" + to_string(c.colors) + " colors)"
+                     : c.algorithm == "external" ? "external (" + Memory::format(c.memory) + " buffer)"
+                     : c.algorithm + " (" + c.backend + ")";
+            };
+            cout << "Memory budget " << Memory::format(budget) << ": " << describe(choices.front()) << " needs about "
+                 << Memory::format(first) << ", using " << describe(choice) << " that needs about " << Memory::format(footprint) << endl;
+        }
+        options.algorithm = choice.algorithm;
+        options.backend = choice.backend;
+        options.colors = choice.colors;
+        options.memory = choice.memory;
         return;
     }
+    throw runtime_error(options.algorithm + " needs about " + Memory::format(first) + " and nothing fits in the memory budget of "
+                        + Memory::format(budget) + ", see --memory-budget");
+}
+
+/**
+ * Fraction of the pairs of nodes that are edges
+ */
+double getDensity(const Graphs& graphs) {
+    long double maxEdges = graphs.nNodes * ((long double) graphs.nNodes - 1) / 2;
+    return maxEdges > 0 ? (double) (graphs.nEdges / maxEdges) : 0;
 }
 
-int main() {
-    // Setup for generated graphs and files' name
-    vector<int> numNod = {5000, 10000, 70000, 1000};
-    vector<double> numDens = {0.5, 0.05, 0.00005, 0.95};
-//        vector<string> fileNames = {"1005_email","4039_fb","36692_enron","58228_bright","5000_50","10000_05","70000_00005", "1000_95"};
-//        vector<string> fileNames = {"node_1005_email","node_4039_fb","node_36692_enron","node_58228_bright","node_5000_50","node_10000_05","node_70000_00005", "node_1000_95"};
-    vector<string> fileNames = {"fast_1005_email","fast_4039_fb","fast_36692_enron","fast_58228_bright","fast_5000_50","fast_10000_05","fast_70000_00005", "fast_1000_95"};
+/**
+ * Replace --algorithm auto with the choice of the cost model, loaded from --cost-model or from the results
+ * directory if it was calibrated there, and log the statistics and the predicted cost
+ * @param options algorithm, backend, kernel and, without --threads, threads are set
+ * @param stats
+ */
+void selectAlgorithm(Options& options, const GraphStats& stats) {
+    CostModel model;
+    string path = options.costModel.empty() ? options.resultsDir + "/" COST_MODEL_FILE : options.costModel;
+    if (!options.costModel.empty() || filesystem::exists(path)) {
+        model.load(path);
+    } else {
+        path = "defaults";
+    }
+
+    int maxThreads = options.threadsSet ? *max_element(options.threads.begin(), options.threads.end()) : omp_get_max_threads();
+    Selection selection = model.select(stats, options.memoryBudget, maxThreads, !options.threadsSet);
+    options.algorithm = selection.algorithm;
+    options.backend = selection.backend;
+    options.kernel = selection.kernel == INTERSECT_ADAPTIVE ? "adaptive" : "merge";
+    if (!options.threadsSet) options.threads = {selection.nThreads};
 
-    // Run the algorithm on all graphs and save the execution times
-    for (int dataNum = 2; dataNum < 9; dataNum++) {
-        vector<vector<bool>> graph;
-        if(dataNum < 5) {
-            // get dataset information
-            auto [numNodes, numEdges, realTriangles, inputFile] = getData(dataNum);
-            // create an adjacency matrix to represent the graph
-            graph = GraphMat::getGraph(numNodes, inputFile);
-        } else {
-            // generate dense graph adjacency matrix by passing number of nodes and density
-            graph = GraphMat::getGraph_dense(numNod[dataNum-5],numDens[dataNum-5]);
+    cout << "Auto (cost model: " << path << "): nodes " << stats.nNodes << ", edges " << stats.nEdges << ", density "
+         << setprecision(5) << stats.density << ", max degree " << stats.maxDegree << ", degree skew " << setprecision(1)
+         << fixed << stats.degreeSkew << ", wedges " << stats.wedges << endl;
+    cout << "Auto: " << options.algorithm << " (" << options.backend << (options.backend == "csr" ? ", " + options.kernel : "")
+         << ") with " << selection.nThreads << " threads, predicted " << setprecision(3) << selection.predictedSeconds * 1e3 << " ms" << endl;
+    cout.unsetf(ios::fixed);
+}
+
+/**
+ * Fit the cost model to the results_*.json of the results directory and save it
+ * @param options
+ */
+void calibrateCostModel(const Options& options) {
+    vector<string> paths;
+    for (const auto& entry: filesystem::directory_iterator(options.resultsDir)) {
+        string name = entry.path().filename().string();
+        if (name.rfind("results_", 0) == 0 && entry.path().extension() == ".json") paths.push_back(entry.path().string());
+    }
+    string path = options.costModel.empty() ? options.resultsDir + "/" COST_MODEL_FILE : options.costModel;
+    CostModel model;
+    if (filesystem::exists(path)) model.load(path);
+    int nUsed = model.calibrate(paths);
+    model.save(path);
+    cout << "Cost model fitted to " << nUsed << " of " << paths.size() << " results, saved in " << path << endl;
+}
+
+/**
+ * Print the compression ratio against the CSR DAG, the bits per edge and the decode throughput of one thread
+ * @param graphs compressionRatio and decodeRate are set
+ */
+void reportCompression(Graphs& graphs) {
+    const CompressedCSR& dag = graphs.compressed;
+    double csrBytes = (double) Memory::estimateDag(dag.nNodes, dag.nNeighbors);
+    double bytes = (double) Memory::getBytes(dag);
+    graphs.compressionRatio = bytes > 0 ? csrBytes / bytes : 0;
+
+    // Best of a few passes over all the rows
+    double best = 0;
+    for (int pass = 0; pass < 3; pass++) {
+        auto start = chrono::steady_clock::now();
+        volatile long long sum = GraphCompressed::decodeAll(dag, 1);
+        (void) sum;
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (seconds > 0) best = max(best, (double) dag.nNeighbors / seconds);
+    }
+    graphs.decodeRate = best;
+    cout << "compressed dag: " << Memory::format((long long) bytes) << " (csr dag " << Memory::format((long long) csrBytes)
+         << "), ratio " << fixed << setprecision(2) << graphs.compressionRatio << ", "
+         << (dag.nNeighbors > 0 ? 8 * (double) dag.data.size() / (double) dag.nNeighbors : 0) << " bits per edge, decode "
+         << setprecision(0) << best / 1e6 << " M neighbours/s ("  << setprecision(2)
+         << best * (double) dag.data.size() / max<double>(1, (double) dag.nNeighbors) / 1e9 << " GB/s compressed)" << endl;
+    cout.unsetf(ios::fixed);
+}
+
+static atomic<bool> interrupted {false}; // set by the first Ctrl-C or SIGTERM
+
+/**
+ * A run stopped by Ctrl-C, SIGTERM or --timeout, with the count of the work it finished
+ */
+struct Stopped : runtime_error {
+    long long count;
+    double fraction;
+
+    Stopped(long long count, double fraction)
+        : runtime_error("stopped"), count(count), fraction(fraction) {}
+};
+
+/**
+ * The first Ctrl-C or SIGTERM stops the running count, which prints its partial result and saves its checkpoint;
+ * the second one kills the process
+ */
+void onInterrupt(int signum) {
+    interrupted = true;
+    signal(signum, SIG_DFL);
+}
+
+/**
+ * Stop the count on Ctrl-C or after --timeout seconds and, with --progress, print its progress to stderr
+ * @param control
+ * @param options
+ */
+void setupControl(Control& control, const Options& options) {
+    control.setCancel(&interrupted);
+    if (options.timeout > 0) {
+        control.setDeadline(Control::Clock::now() + chrono::duration_cast<Control::Clock::duration>(chrono::duration<double>(options.timeout)));
+    }
+    if (options.progress) {
+        control.setProgress([](const ControlReport& report) {
+            ostringstream line;
+            line << fixed << setprecision(1) << 100 * report.fraction << "% done, " << setprecision(0) << report.rate
+                 << " units/s, " << setprecision(1) << report.eta << " s left" << "\n";
+            cerr << line.str();
+        }, 1);
+    }
+}
+
+/**
+ * Load or generate the graph and build the representations needed by the selected algorithm
+ * @param options
+ * @return
+ */
+Graphs loadGraphs(Options& options) {
+    Graphs graphs;
+    int nNodes = 0;
+    if (!options.dataset.empty()) {
+        auto [numNodes, numEdges, realTriangles, inputFile] = getData(options.dataset);
+        graphs.path = getDataPath(options);
+        nNodes = numNodes;
+        if (options.expected < 0 && (options.algorithm != "clique" || options.k == 3)) {
+            options.expected = realTriangles;
+        }
+    } else if (!options.input.empty()) {
+        graphs.path = options.input;
+    }
+    if (options.memoryBudget > 0) {
+        long long estimatedNodes, estimatedEdges;
+        estimateSize(options, estimatedNodes, estimatedEdges);
+        fitMemoryBudget(options, estimatedNodes, estimatedEdges);
+    }
+    if (options.algorithm == "colorful" || options.algorithm == "external") {
+        return graphs; // they stream the file themselves
+    }
+
+    TRACE_SCOPE("load");
+    Memory::resetPeakRss();
+    int nThreads = *max_element(options.threads.begin(), options.threads.end());
+    if (options.algorithm == "census") {
+        vector<pair<int, int>> arcs = options.generate.empty() ? GraphMat::getEdges(graphs.path, nThreads)
+                                                               : generateEdges(options.generate, nNodes);
+        graphs.memory.addStructure("arcs", Memory::getBytes(arcs));
+        graphs.directed = GraphDirected::fromArcs(nNodes, arcs, nThreads);
+        graphs.memory.addStructure("out and in csr", Memory::getBytes(graphs.directed.out) + Memory::getBytes(graphs.directed.in));
+        graphs.memory.addStructure("directed dag", Memory::getBytes(graphs.directed.dag) + (long long) graphs.directed.directions.size());
+        graphs.memory.addPhase("load");
+        graphs.nNodes = max(nNodes, graphs.directed.dag.nNodes);
+        graphs.nEdges = (long long) graphs.directed.dag.neighbors.size();
+        long long mutual = count(graphs.directed.directions.begin(), graphs.directed.directions.end(), DIRECTION_FORWARD | DIRECTION_BACKWARD);
+        cout << "number of nodes: " << graphs.nNodes << ", number of arcs: " << graphs.directed.out.neighbors.size()
+             << ", connected pairs: " << graphs.nEdges << ", reciprocated: " << mutual << endl;
+        return graphs;
+    }
+    CSR graph;
+    if (!options.snapshot.empty()) {
+        graph = GraphCSR::loadSnapshot(options.snapshot);
+    } else if (!options.generate.empty()) {
+        vector<pair<int, int>> edges = generateEdges(options.generate, nNodes);
+        graphs.memory.addStructure("generated edges", Memory::getBytes(edges));
+        graph = GraphCSR::fromEdges(nNodes, edges, nThreads);
+    } else {
+        graph = GraphReader::read(graphs.path, options.dataset.empty() ? options.format : "snap", nNodes, nThreads);
+    }
+    graphs.memory.addStructure("csr", Memory::getBytes(graph));
+    graphs.memory.addPhase("load");
+    if (!options.saveSnapshot.empty()) {
+        GraphCSR::saveSnapshot(graph, options.saveSnapshot);
+    }
+    nNodes = max(nNodes, graph.nNodes);
+    graphs.nNodes = nNodes;
+    graphs.nEdges = (long long) graph.neighbors.size() / 2;
+    graphs.stats = CostModel::getStats(graph);
+    graphs.maxDegree = graphs.stats.maxDegree;
+    if (options.algorithm == "auto") {
+        selectAlgorithm(options, graphs.stats);
+    }
+
+    // Now that the size is exact, check again before building the matrix or the intersections
+    fitMemoryBudget(options, nNodes, graphs.nEdges);
+    if (options.algorithm == "colorful" || options.algorithm == "external") {
+        return graphs;
+    }
+
+    if (options.backend == "matrix") {
+        graphs.edges = GraphCSR::getEdges(graph);
+        graphs.matrix = GraphMat::fromEdges(nNodes, graphs.edges);
+        graphs.memory.addStructure("edge list", Memory::getBytes(graphs.edges));
+        graphs.memory.addStructure("matrix", Memory::getBytes(graphs.matrix));
+        graphs.memory.addPhase("matrix build");
+        if (options.algorithm == "fast") {
+            Control control;
+            setupControl(control, options);
+            graphs.allInts = GraphMat::precomputeIntersection(graphs.matrix, &control);
+            if (!control.isComplete()) {
+                throw Stopped(0, 0);
+            }
+            graphs.memory.addStructure("precomputed intersections", Memory::getBytes(graphs.allInts));
+            graphs.memory.addPhase("precompute");
+        }
+    } else if (options.backend == "compressed") {
+        graphs.compressed = GraphCompressed::compress(graph, nThreads);
+        graphs.memory.addStructure("compressed dag", Memory::getBytes(graphs.compressed));
+        graphs.memory.addPhase("compress");
+        reportCompression(graphs);
+    } else if (options.backend == "roaring") {
+        graphs.roaring = GraphRoaring::fromDag(GraphCSR::orientByDegree(graph, nThreads));
+        graphs.memory.addStructure("roaring dag", Memory::getBytes(graphs.roaring));
+        graphs.memory.addPhase("roaring build");
+        long long arrays, bitmaps, runs;
+        GraphRoaring::getRowCounts(graphs.roaring, arrays, bitmaps, runs);
+        cout << "roaring dag: " << arrays << " array, " << bitmaps << " bitmap and " << runs << " run containers, "
+             << Memory::format(Memory::getBytes(graphs.roaring)) << endl;
+    } else {
+        graphs.dag = GraphCSR::orientByDegree(graph, nThreads);
+        graphs.memory.addStructure("dag", Memory::getBytes(graphs.dag));
+        graphs.memory.addPhase("reorder");
+    }
+
+    cout << "number of nodes: " << nNodes << ", number of edges: " << graphs.nEdges << ", density: " << fixed << setprecision(5) << getDensity(graphs) << endl;
+
+    return graphs;
+}
+
+/**
+ * Run the selected algorithm once
+ * @param options
+ * @param graphs
+ * @param nThreads
+ * @param control stops node, edge, fast and better, nullptr if they run to the end
+ * @param checkpoint saves and resumes colorful and external, may be nullptr
+ * @return No. of triangles (or k-cliques) in graph
+ */
+long long runAlgorithm(const Options& options, const Graphs& graphs, int nThreads, Control* control, Checkpoint* checkpoint) {
+    TRACE_SCOPE("count");
+    const string& a = options.algorithm;
+    if (a == "node") {
+        return nThreads == 1 ? GraphMat::countTriangles_node_seq(graphs.matrix, control) : GraphMat::countTriangles_node_multi(graphs.matrix, nThreads, control);
+    } else if (a == "edge" && options.backend == "matrix") {
+        return nThreads == 1 ? GraphMat::countTriangles_edge_seq(graphs.matrix, control) : GraphMat::countTriangles_edge_multi(graphs.matrix, nThreads, control);
+    } else if (a == "edge" && options.backend == "roaring") {
+        return GraphRoaring::countTriangles_forward(graphs.roaring, nThreads, control);
+    } else if (a == "edge" && options.backend == "compressed") {
+        return GraphCompressed::countTriangles_forward(graphs.compressed, nThreads, control);
+    } else if (a == "edge") {
+        IntersectionKernel kernel = options.kernel == "adaptive" ? INTERSECT_ADAPTIVE : INTERSECT_MERGE;
+        return nThreads == 1 ? GraphCSR::countTriangles_forward_seq(graphs.dag, kernel, control) : GraphCSR::countTriangles_forward_multi(graphs.dag, nThreads, kernel, control);
+    } else if (a == "fast") {
+        return nThreads == 1 ? GraphMat::ctTr_edgeFast_seq(graphs.matrix, graphs.allInts, control) : GraphMat::ctTr_edgeFast_multi(graphs.matrix, nThreads, graphs.allInts, control);
+    } else if (a == "better") {
+        return GraphMat::better_algo(graphs.matrix, graphs.edges, control); // sequential only
+    } else if (a == "clique") {
+        return GraphClique::countCliques(graphs.dag, options.k, nThreads);
+    } else if (a == "census") {
+        return GraphDirected::countCensus(graphs.directed, nThreads).getTotal();
+    } else if (a == "colorful") {
+        return GraphPartition::countTriangles_colorful(graphs.path, options.colors, nThreads, options.tmpDir, checkpoint);
+    } else {
+        ExternalStats stats;
+        return GraphExternal::countTriangles_external(graphs.path, options.memory, nThreads, options.tmpDir, stats, checkpoint);
+    }
+}
+
+/**
+ * Describe the run: host and build, graph source and statistics, algorithm and its parameters
+ * @param options
+ * @param graphs
+ * @return
+ */
+BenchmarkMetadata getMetadata(const Options& options, const Graphs& graphs) {
+    BenchmarkMetadata metadata = Benchmark::getHostMetadata();
+    string source = !options.dataset.empty() ? "dataset:" + options.dataset
+                  : !options.input.empty() ? "file:" + options.input
+                  : !options.snapshot.empty() ? "snapshot:" + options.snapshot
+                  : options.generate;
+    metadata.emplace_back("graph", source);
+    if (graphs.nNodes > 0) {
+        metadata.emplace_back("nodes", to_string(graphs.nNodes));
+        metadata.emplace_back("edges", to_string(graphs.nEdges));
+        metadata.emplace_back("density", to_string(getDensity(graphs)));
+        metadata.emplace_back("max_degree", to_string(graphs.maxDegree));
+    }
+    metadata.emplace_back("algorithm", options.algorithm);
+    metadata.emplace_back("backend", options.backend);
+    metadata.emplace_back("huge_pages", Arena::getName(Arena::getHugePages()));
+    metadata.emplace_back("huge_page_bytes", to_string(graphs.memory.hugePageBytes));
+    if (options.backend == "csr") metadata.emplace_back("kernel", options.kernel);
+    if (graphs.stats.nNodes > 0) {
+        IntersectionKernel kernel = options.kernel == "adaptive" ? INTERSECT_ADAPTIVE : INTERSECT_MERGE;
+        metadata.emplace_back("degree_skew", to_string(graphs.stats.degreeSkew));
+        metadata.emplace_back("wedges", to_string(graphs.stats.wedges));
+        metadata.emplace_back("work", to_string(CostModel::getWork(options.algorithm, options.backend, kernel, graphs.stats)));
+    }
+    if (options.backend == "compressed") {
+        metadata.emplace_back("compression_ratio", to_string(graphs.compressionRatio));
+        metadata.emplace_back("bits_per_edge", to_string(graphs.compressed.nNeighbors > 0
+                ? 8 * (double) graphs.compressed.data.size() / (double) graphs.compressed.nNeighbors : 0));
+        metadata.emplace_back("decode_neighbors_per_second", to_string(graphs.decodeRate));
+    }
+    if (options.algorithm == "clique") metadata.emplace_back("k", to_string(options.k));
+    if (options.algorithm == "colorful") metadata.emplace_back("colors", to_string(options.colors));
+    if (options.algorithm == "external") metadata.emplace_back("external_memory", to_string(options.memory));
+    if (options.algorithm == "census") {
+        for (int type = 0; type < N_TRIANGLE_TYPES; type++) {
+            metadata.emplace_back("census_" + GraphDirected::getName((TriangleType) type), to_string(graphs.census.counts[type]));
+        }
+    }
+    metadata.emplace_back("expected", to_string(options.expected));
+    metadata.emplace_back("warmup", to_string(options.benchmark.warmup));
+    metadata.emplace_back("target_rel_error", to_string(options.benchmark.targetRelError));
+    metadata.emplace_back("memory_budget_bytes", to_string(options.memoryBudget));
+    auto key = [](string name) {
+        replace(name.begin(), name.end(), ' ', '_');
+        return name;
+    };
+    for (const auto& [name, bytes]: graphs.memory.structures) {
+        metadata.emplace_back("bytes_" + key(name), to_string(bytes));
+    }
+    for (const auto& [name, bytes]: graphs.memory.peaks) {
+        metadata.emplace_back("peak_rss_" + key(name), to_string(bytes));
+    }
+    metadata.emplace_back("perf_counters", !options.benchmark.perfCounters ? "off" : PerfCounters::isAvailable() ? "on" : "unavailable");
+    return metadata;
+}
+
+/**
+ * Print the statistics of one thread count, in milliseconds, and its hardware counters if recorded
+ */
+void printResult(const Options& options, const Graphs& graphs, const BenchmarkResult& result) {
+    cout << "\n" << "--number of threads: " << result.nThreads << ", runs: " << result.samples.size() << "--" << endl;
+    cout << "Total number of " << (options.algorithm == "clique" ? to_string(options.k) + "-cliques" : "triangles") << " in the graph: " << result.count << endl;
+    cout << fixed << setprecision(3) << "min: " << result.min / 1e6 << " ms, median: " << result.median / 1e6
+         << " ms, p95: " << result.p95 / 1e6 << " ms, stddev: " << result.stddev / 1e6
+         << " ms, rel. error: " << setprecision(4) << result.relError << endl;
+    if (result.counters.any()) {
+        const PerfSample& c = result.counters;
+        for (int e = 0; e < N_PERF_EVENTS; e++) {
+            if (!c.valid[e]) continue;
+            cout << PerfCounters::getName(e) << ": " << setprecision(0) << c.values[e];
+            if (e != PERF_CYCLES && e != PERF_INSTRUCTIONS && graphs.nEdges > 0) {
+                cout << " (" << setprecision(3) << c.values[e] / (double) graphs.nEdges << " per edge)";
+            }
+            cout << ", ";
+        }
+        if (c.valid[PERF_CYCLES] && c.valid[PERF_INSTRUCTIONS] && c.values[PERF_CYCLES] > 0) {
+            cout << "IPC: " << setprecision(3) << c.values[PERF_INSTRUCTIONS] / c.values[PERF_CYCLES];
+        }
+        cout << endl;
+    }
+    if (!result.correct) {
+        cerr << "Error: expected " << options.expected << " but counted " << result.count << endl;
+    }
+}
+
+/**
+ * Print the triangles of each type and save the census of every node with --census-nodes
+ */
+void printCensus(const Options& options, const TriangleCensus& census) {
+    cout << "\ndirected triangles by type:" << endl;
+    for (int type = 0; type < N_TRIANGLE_TYPES; type++) {
+        cout << "  " << left << setw(5) << GraphDirected::getName((TriangleType) type) << right << setw(14) << census.counts[type]
+             << "  " << GraphDirected::getDescription((TriangleType) type) << endl;
+    }
+    if (options.censusNodes.empty()) return;
+
+    ofstream out(options.censusNodes, ios::trunc);
+    if (!out.is_open()) {
+        throw runtime_error("unable to open " + options.censusNodes);
+    }
+    out << "node";
+    for (int type = 0; type < N_TRIANGLE_TYPES; type++) out << "," << GraphDirected::getName((TriangleType) type);
+    out << "\n";
+    for (size_t u = 0; u < census.local.size(); u++) {
+        out << u;
+        for (long long count: census.local[u]) out << "," << count;
+        out << "\n";
+    }
+    cout << "census of each node saved in " << options.censusNodes << endl;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        printUsage();
+        return 2;
+    }
+
+    if (options.calibrate) {
+        try {
+            calibrateCostModel(options);
+        } catch (const exception& e) {
+            cerr << "Error: " << e.what() << endl;
+            return 2;
         }
+        return 0;
+    }
+
+    bool correct = true;
+    Trace::setEnabled(options.phases || !options.trace.empty());
+    if (options.memoryBudget < 0) {
+        options.memoryBudget = Memory::getAvailable() / 10 * 9; // some room for the estimates being off
+    }
+    signal(SIGINT, onInterrupt);
+    signal(SIGTERM, onInterrupt);
+    try {
+        Graphs graphs = loadGraphs(options);
         cout << "Max number of threads: " << omp_get_max_threads() << endl;
+        if (options.benchmark.perfCounters && !PerfCounters::isAvailable()) {
+            cerr << "Warning: hardware counters are not available (see /proc/sys/kernel/perf_event_paranoid), timing only" << endl;
+        }
+
+        vector<BenchmarkResult> results;
+        Memory::resetPeakRss();
+        for (int nThreads: options.threads) {
+            results.push_back(Benchmark::run(nThreads, options.benchmark, options.expected, [&]() {
+                Control control;
+                setupControl(control, options);
+                Checkpoint checkpoint(options.checkpoint, options.resume, options.checkpointInterval);
+                checkpoint.setStop(&interrupted);
+                long long count = runAlgorithm(options, graphs, nThreads, &control, options.checkpoint.empty() ? nullptr : &checkpoint);
+                if (!control.isComplete()) {
+                    throw Stopped(count, control.getFraction());
+                }
+                if (checkpoint.isStopped()) {
+                    throw Stopped(count, checkpoint.getFraction());
+                }
+                return count;
+            }));
+            printResult(options, graphs, results.back());
+            correct &= results.back().correct;
+        }
+
+        if (options.algorithm == "census") {
+            graphs.census = GraphDirected::countCensus(graphs.directed, options.threads.back(), !options.censusNodes.empty());
+            printCensus(options, graphs.census);
+        }
 
-        // Create a matrix that contains all the intersection count
-//        auto allInts = GraphMat::precomputeIntersection(graph);
+        graphs.memory.addPhase("count");
+        graphs.memory.addPages();
+        graphs.memory.print(cout);
 
-        // Create 2D vector to store execution times
-        vector<vector<double>> execution_times(N_THREADS, vector<double>(N_ITERATION));
-        // Count triangles
-        for (int i = 1; i <= N_THREADS; i++) {
-            test(i, graph, execution_times);
-//            test_fast(i, graph, execution_times, allInts);
+        Benchmark::computeSpeedups(results);
+        if (results.size() > 1 && results.front().speedup > 0) {
+            cout << "\nthreads, speedup, efficiency" << endl;
+            for (const auto& result: results) {
+                cout << result.nThreads << ", " << setprecision(2) << result.speedup << ", " << result.efficiency << endl;
+            }
+        }
+        if (!options.output.empty()) {
+            BenchmarkMetadata metadata = getMetadata(options, graphs);
+            Benchmark::saveJson(options.resultsDir + "/results_" + options.output + ".json", metadata, results);
+            Benchmark::saveCsv(options.resultsDir + "/results_" + options.output + ".csv", metadata, results);
+        }
+        if (Trace::isEnabled()) {
+            Trace::printSummary(cout);
         }
-        saveExecutionTimes(execution_times, fileNames[dataNum-1]);
+        if (!options.trace.empty()) {
+            Trace::saveChromeTrace(options.trace);
+        }
+    } catch (const Stopped& stopped) {
+        cerr << (interrupted ? "Interrupted" : "Timed out") << " after " << fixed << setprecision(1)
+             << 100 * stopped.fraction << "% of the work, partial count: " << stopped.count << endl;
+        if (!options.checkpoint.empty()) {
+            cerr << "Progress saved in " << options.checkpoint << ", continue with --resume" << endl;
+        }
+        return 3;
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 2;
     }
-    return 0;
-}
\ No newline at end of file
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,420 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "triangles/triangles_c.h"
+
+#include <atomic>
+#include <cstring>
+
+/**
+ * Python module "triangles" over the C ABI of the library.
+ * Edges are read in place from any buffer (NumPy array, array.array, memoryview) of int32 or int64, either of
+ * shape (m, 2) with any strides or flat [u0, v0, u1, v1, ...]. Results are returned as int64 / int32 memoryviews,
+ * which numpy.asarray wraps without copying. The GIL is released while the kernels run.
+ */
+
+typedef struct {
+    PyObject_HEAD
+    triangles_graph* graph;
+} GraphObject;
+
+static PyObject* raiseError() {
+    PyErr_SetString(PyExc_RuntimeError, triangles_last_error());
+    return nullptr;
+}
+
+/**
+ * Parse the keyword arguments threads, backend ("csr", "matrix", "compressed", "roaring") and kernel ("merge", "adaptive")
+ */
+static bool parseOptions(int threads, const char* backend, const char* kernel, triangles_options* options) {
+    *options = triangles_options_default();
+    options->threads = threads;
+    if (strcmp(backend, "csr") == 0) options->backend = TRIANGLES_BACKEND_CSR;
+    else if (strcmp(backend, "matrix") == 0) options->backend = TRIANGLES_BACKEND_MATRIX;
+    else if (strcmp(backend, "compressed") == 0) options->backend = TRIANGLES_BACKEND_COMPRESSED;
+    else if (strcmp(backend, "roaring") == 0) options->backend = TRIANGLES_BACKEND_ROARING;
+    else {
+        PyErr_Format(PyExc_ValueError, "unknown backend %s", backend);
+        return false;
+    }
+    if (strcmp(kernel, "merge") == 0) options->kernel = TRIANGLES_KERNEL_MERGE;
+    else if (strcmp(kernel, "adaptive") == 0) options->kernel = TRIANGLES_KERNEL_ADAPTIVE;
+    else {
+        PyErr_Format(PyExc_ValueError, "unknown kernel %s", kernel);
+        return false;
+    }
+    if (threads < 1) {
+        PyErr_SetString(PyExc_ValueError, "threads must be positive");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Integer width of a buffer format, 0 if it is not a signed 32/64 bit integer
+ */
+static int getIntegerSize(const Py_buffer& view) {
+    const char* format = view.format ? view.format : "B";
+    if (*format == '@' || *format == '=' || *format == '<') format++;
+    if (strlen(format) != 1 || !strchr("ilq", *format)) return 0;
+    return view.itemsize == 4 || view.itemsize == 8 ? (int) view.itemsize : 0;
+}
+
+/**
+ * Matrix of n rows of width int32 or int64 as a memoryview over a new bytearray, shape (n,) if width is 0
+ */
+static PyObject* newMatrix(Py_ssize_t n, int width, const char* format, Py_ssize_t itemsize, char** data) {
+    PyObject* bytes = PyByteArray_FromStringAndSize(nullptr, n * (width ? width : 1) * itemsize);
+    if (!bytes) return nullptr;
+    *data = PyByteArray_AsString(bytes);
+    PyObject* flat = PyMemoryView_FromObject(bytes);
+    Py_DECREF(bytes);
+    if (!flat) return nullptr;
+    PyObject* shape = width ? Py_BuildValue("(nn)", n, (Py_ssize_t) width) : Py_BuildValue("(n)", n);
+    PyObject* view = shape ? PyObject_CallMethod(flat, "cast", "sO", format, shape) : nullptr;
+    Py_XDECREF(shape);
+    Py_DECREF(flat);
+    return view;
+}
+
+static int Graph_init(GraphObject* self, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"edges", "num_nodes", nullptr};
+    PyObject* edges;
+    int nNodes = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|i", (char**) keywords, &edges, &nNodes)) return -1;
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(edges, &view, PyBUF_STRIDES | PyBUF_FORMAT) < 0) return -1;
+    int size = getIntegerSize(view);
+    Py_ssize_t nEdges = 0, stride = 0, second = 0;
+    const char* error = nullptr;
+    if (size == 0) {
+        error = "edges must be int32 or int64";
+    } else if (view.ndim == 1 && view.shape[0] % 2 == 0 && view.strides[0] % size == 0) {
+        nEdges = view.shape[0] / 2;
+        stride = 2 * view.strides[0] / size;
+        second = view.strides[0] / size;
+    } else if (view.ndim == 2 && view.shape[1] == 2 && view.strides[0] % size == 0 && view.strides[1] % size == 0) {
+        nEdges = view.shape[0];
+        stride = view.strides[0] / size;
+        second = view.strides[1] / size;
+    } else {
+        error = "edges must have shape (m, 2) or (2m,)";
+    }
+    if (error) {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, error);
+        return -1;
+    }
+
+    triangles_graph* graph = nullptr;
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    if (size == 4) {
+        const int32_t* sources = (const int32_t*) view.buf;
+        status = triangles_graph_from_edges_i32(nNodes, sources, sources + second, nEdges, stride, &graph);
+    } else {
+        const int64_t* sources = (const int64_t*) view.buf;
+        status = triangles_graph_from_edges_i64(nNodes, sources, sources + second, nEdges, stride, &graph);
+    }
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+    if (status != 0) {
+        raiseError();
+        return -1;
+    }
+    triangles_graph_free(self->graph);
+    self->graph = graph;
+    return 0;
+}
+
+static void Graph_dealloc(GraphObject* self) {
+    triangles_graph_free(self->graph);
+    Py_TYPE(self)->tp_free((PyObject*) self);
+}
+
+static bool checkGraph(GraphObject* self) {
+    if (!self->graph) PyErr_SetString(PyExc_ValueError, "graph not initialised");
+    return self->graph != nullptr;
+}
+
+static PyObject* Graph_load(PyObject* type, PyObject* args) {
+    const char* path;
+    if (!PyArg_ParseTuple(args, "s", &path)) return nullptr;
+    triangles_graph* graph = nullptr;
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = triangles_graph_load(path, &graph);
+    Py_END_ALLOW_THREADS
+    if (status != 0) return raiseError();
+    GraphObject* self = (GraphObject*) ((PyTypeObject*) type)->tp_alloc((PyTypeObject*) type, 0);
+    if (!self) {
+        triangles_graph_free(graph);
+        return nullptr;
+    }
+    self->graph = graph;
+    return (PyObject*) self;
+}
+
+static PyObject* Graph_save(GraphObject* self, PyObject* args) {
+    const char* path;
+    if (!checkGraph(self) || !PyArg_ParseTuple(args, "s", &path)) return nullptr;
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = triangles_graph_save(self->graph, path);
+    Py_END_ALLOW_THREADS
+    if (status != 0) return raiseError();
+    Py_RETURN_NONE;
+}
+
+/**
+ * Python progress callback of a count and the exception it raised, if any
+ */
+struct ProgressCall {
+    PyObject* callback;
+    PyObject* type = nullptr;
+    PyObject* value = nullptr;
+    PyObject* traceback = nullptr;
+};
+
+/**
+ * Progress of the C ABI: call the callback with (fraction, rate, eta) holding the GIL. An exception stops the
+ * count and is kept to be raised by the thread that started it.
+ */
+static int callProgress(const triangles_progress* progress, void* user) {
+    auto* call = (ProgressCall*) user;
+    PyGILState_STATE state = PyGILState_Ensure();
+    int stop = call->type != nullptr;
+    if (!stop) {
+        PyObject* result = PyObject_CallFunction(call->callback, "ddd", progress->fraction, progress->rate, progress->eta);
+        if (result == nullptr) {
+            PyErr_Fetch(&call->type, &call->value, &call->traceback);
+            stop = 1;
+        }
+        Py_XDECREF(result);
+    }
+    PyGILState_Release(state);
+    return stop;
+}
+
+/**
+ * count and count_partial: a timeout in seconds (0 for none) and a progress callable, called every
+ * progress_interval seconds, stop the count
+ */
+static PyObject* countTriangles(GraphObject* self, PyObject* args, PyObject* kwargs, bool partial) {
+    static const char* keywords[] = {"threads", "backend", "kernel", "timeout", "progress", "progress_interval", nullptr};
+    int threads = 1;
+    const char* backend = "csr";
+    const char* kernel = "merge";
+    double timeout = 0;
+    PyObject* progress = Py_None;
+    double interval = 1;
+    if (!checkGraph(self) || !PyArg_ParseTupleAndKeywords(args, kwargs, "|issdOd", (char**) keywords, &threads, &backend,
+                                                          &kernel, &timeout, &progress, &interval)) return nullptr;
+    triangles_options options;
+    if (!parseOptions(threads, backend, kernel, &options)) return nullptr;
+    if (progress != Py_None && !PyCallable_Check(progress)) {
+        PyErr_SetString(PyExc_TypeError, "progress must be callable");
+        return nullptr;
+    }
+    ProgressCall call {progress};
+    options.timeout = timeout;
+    if (progress != Py_None) {
+        options.progress = callProgress;
+        options.progress_user = &call;
+        options.progress_interval = interval;
+    }
+
+    int64_t count = 0;
+    double fraction = 1;
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = partial ? triangles_count_partial(self->graph, &options, &count, &fraction) : triangles_count(self->graph, &options, &count);
+    Py_END_ALLOW_THREADS
+    if (call.type != nullptr) {
+        PyErr_Restore(call.type, call.value, call.traceback);
+        return nullptr;
+    }
+    if (status != 0) return raiseError();
+    return partial ? Py_BuildValue("(Ld)", (long long) count, fraction) : PyLong_FromLongLong(count);
+}
+
+static PyObject* Graph_count(GraphObject* self, PyObject* args, PyObject* kwargs) {
+    return countTriangles(self, args, kwargs, false);
+}
+
+static PyObject* Graph_count_partial(GraphObject* self, PyObject* args, PyObject* kwargs) {
+    return countTriangles(self, args, kwargs, true);
+}
+
+/**
+ * Triangles of each node into out (a writable contiguous int64 buffer of num_nodes elements) or a new memoryview
+ */
+static PyObject* Graph_local_counts(GraphObject* self, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"threads", "out", nullptr};
+    int threads = 1;
+    PyObject* out = Py_None;
+    if (!checkGraph(self) || !PyArg_ParseTupleAndKeywords(args, kwargs, "|iO", (char**) keywords, &threads, &out)) return nullptr;
+    triangles_options options;
+    if (!parseOptions(threads, "csr", "merge", &options)) return nullptr;
+    Py_ssize_t n = triangles_graph_num_nodes(self->graph);
+
+    PyObject* result;
+    Py_buffer view;
+    char* data;
+    size_t capacity = n;
+    if (out == Py_None) {
+        result = newMatrix(n, 0, "q", 8, &data);
+        if (!result) return nullptr;
+    } else {
+        if (PyObject_GetBuffer(out, &view, PyBUF_C_CONTIGUOUS | PyBUF_WRITABLE | PyBUF_FORMAT) < 0) return nullptr;
+        if (getIntegerSize(view) != 8 || view.len < n * 8) {
+            PyBuffer_Release(&view);
+            PyErr_SetString(PyExc_ValueError, "out must be an int64 buffer of num_nodes elements");
+            return nullptr;
+        }
+        data = (char*) view.buf;
+        capacity = view.len / 8;
+        result = Py_NewRef(out);
+    }
+
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = triangles_count_local(self->graph, &options, (int64_t*) data, capacity);
+    Py_END_ALLOW_THREADS
+    if (out != Py_None) PyBuffer_Release(&view);
+    if (status != 0) {
+        Py_DECREF(result);
+        return raiseError();
+    }
+    return result;
+}
+
+struct Collector {
+    int32_t* triangles;
+    int64_t capacity;
+    std::atomic<int64_t> next{0};
+};
+
+static int collect(int32_t u, int32_t v, int32_t w, void* user) {
+    Collector* collector = (Collector*) user;
+    int64_t at = collector->next.fetch_add(1, std::memory_order_relaxed);
+    if (at < collector->capacity) {
+        collector->triangles[3 * at] = u;
+        collector->triangles[3 * at + 1] = v;
+        collector->triangles[3 * at + 2] = w;
+    }
+    return 0;
+}
+
+/**
+ * Every triangle as a (t, 3) int32 memoryview, counted first to size it
+ */
+static PyObject* Graph_triangles(GraphObject* self, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"threads", nullptr};
+    int threads = 1;
+    if (!checkGraph(self) || !PyArg_ParseTupleAndKeywords(args, kwargs, "|i", (char**) keywords, &threads)) return nullptr;
+    triangles_options options;
+    if (!parseOptions(threads, "csr", "merge", &options)) return nullptr;
+
+    int64_t count = 0;
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = triangles_count(self->graph, &options, &count);
+    Py_END_ALLOW_THREADS
+    if (status != 0) return raiseError();
+
+    char* data;
+    PyObject* result = newMatrix((Py_ssize_t) count, 3, "i", 4, &data);
+    if (!result) return nullptr;
+    Collector collector;
+    collector.triangles = (int32_t*) data;
+    collector.capacity = count;
+    Py_BEGIN_ALLOW_THREADS
+    status = triangles_enumerate(self->graph, &options, collect, &collector);
+    Py_END_ALLOW_THREADS
+    if (status != 0) {
+        Py_DECREF(result);
+        return raiseError();
+    }
+    return result;
+}
+
+static PyObject* Graph_cliques(GraphObject* self, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"k", "threads", nullptr};
+    int k, threads = 1;
+    if (!checkGraph(self) || !PyArg_ParseTupleAndKeywords(args, kwargs, "i|i", (char**) keywords, &k, &threads)) return nullptr;
+    triangles_options options;
+    if (!parseOptions(threads, "csr", "merge", &options)) return nullptr;
+
+    int64_t count = 0;
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = triangles_count_cliques(self->graph, k, &options, &count);
+    Py_END_ALLOW_THREADS
+    if (status != 0) return raiseError();
+    return PyLong_FromLongLong(count);
+}
+
+static PyObject* Graph_get_num_nodes(GraphObject* self, void*) {
+    return checkGraph(self) ? PyLong_FromLong(triangles_graph_num_nodes(self->graph)) : nullptr;
+}
+
+static PyObject* Graph_get_num_edges(GraphObject* self, void*) {
+    return checkGraph(self) ? PyLong_FromLongLong(triangles_graph_num_edges(self->graph)) : nullptr;
+}
+
+static PyMethodDef Graph_methods[] = {
+    {"load", (PyCFunction) Graph_load, METH_VARARGS | METH_CLASS, "load(path): graph of a SNAP, Matrix Market, METIS or binary edge list, or a snapshot"},
+    {"save", (PyCFunction) Graph_save, METH_VARARGS, "save(path): write a snapshot"},
+    {"count", (PyCFunction) (void (*)(void)) Graph_count, METH_VARARGS | METH_KEYWORDS,
+     "count(threads=1, backend='csr'|'matrix'|'compressed'|'roaring', kernel='merge'|'adaptive', timeout=0, progress=None, "
+     "progress_interval=1): No. of triangles; RuntimeError if the timeout (seconds) stops it, progress(fraction, rate, eta) "
+     "is called every progress_interval seconds and stops the count if it raises"},
+    {"count_partial", (PyCFunction) (void (*)(void)) Graph_count_partial, METH_VARARGS | METH_KEYWORDS,
+     "count_partial(threads=1, backend='csr', kernel='merge', timeout=0, progress=None, progress_interval=1): "
+     "(triangles, fraction of the work), "
+     "fraction < 1 if the timeout stopped the count"},
+    {"local_counts", (PyCFunction) (void (*)(void)) Graph_local_counts, METH_VARARGS | METH_KEYWORDS,
+     "local_counts(threads=1, out=None): triangles of each node, int64"},
+    {"triangles", (PyCFunction) (void (*)(void)) Graph_triangles, METH_VARARGS | METH_KEYWORDS,
+     "triangles(threads=1): every triangle as rows of 3 nodes, int32"},
+    {"cliques", (PyCFunction) (void (*)(void)) Graph_cliques, METH_VARARGS | METH_KEYWORDS,
+     "cliques(k, threads=1): No. of k-cliques"},
+    {nullptr}
+};
+
+static PyGetSetDef Graph_getset[] = {
+    {"num_nodes", (getter) Graph_get_num_nodes, nullptr, "No. of nodes", nullptr},
+    {"num_edges", (getter) Graph_get_num_edges, nullptr, "No. of undirected edges", nullptr},
+    {nullptr}
+};
+
+static PyTypeObject GraphType = {
+    PyVarObject_HEAD_INIT(nullptr, 0)
+};
+
+static PyModuleDef trianglesModule = {
+    PyModuleDef_HEAD_INIT, "triangles", "Triangle counting with the OpenMP kernels of the triangles library", -1,
+};
+
+PyMODINIT_FUNC PyInit_triangles(void) {
+    GraphType.tp_name = "triangles.Graph";
+    GraphType.tp_doc = "Graph(edges, num_nodes=0): undirected graph of an int32/int64 buffer of edges";
+    GraphType.tp_basicsize = sizeof(GraphObject);
+    GraphType.tp_flags = Py_TPFLAGS_DEFAULT;
+    GraphType.tp_new = PyType_GenericNew;
+    GraphType.tp_init = (initproc) Graph_init;
+    GraphType.tp_dealloc = (destructor) Graph_dealloc;
+    GraphType.tp_methods = Graph_methods;
+    GraphType.tp_getset = Graph_getset;
+    if (PyType_Ready(&GraphType) < 0) return nullptr;
+
+    PyObject* module = PyModule_Create(&trianglesModule);
+    if (!module) return nullptr;
+    if (PyModule_AddObjectRef(module, "Graph", (PyObject*) &GraphType) < 0) {
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
@@ -0,0 +1,169 @@
+#include "Server.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+#include <csignal>
+#include <pthread.h>
+
+using namespace std;
+
+#define SOCKET_PATH "/tmp/triangles.sock" //default socket of the server
+
+/**
+ * Command-line options of the server and of the query client
+ */
+struct ServerOptions {
+    bool query = false;                         // send a query instead of serving
+    string socket = SOCKET_PATH;
+    vector<pair<string, string>> graphs;        // name, file
+    int threads = (int) thread::hardware_concurrency();
+    int workers = 1;
+    int queue = 16;
+    int clients = MAX_CLIENTS;
+
+    string graph;                               // graph of the query
+    string op = "count";
+    int k = 0;
+};
+
+void printUsage() {
+    cout << "Usage: triangles_server serve --graph NAME=FILE [--graph NAME=FILE ...] [options]\n"
+            "       triangles_server query --graph NAME [--op OP] [options]\n"
+            "  --socket PATH      Unix socket (default " SOCKET_PATH ")\n"
+            "  --graph NAME=FILE  serve: graph to keep resident, a snapshot (--save-snapshot of main) or an edge list\n"
+            "  --threads N        serve: threads of each query (default all); query: threads asked for (default all)\n"
+            "  --workers N        serve: queries run at the same time (default 1)\n"
+            "  --queue N          serve: queries waiting for a worker before new ones are refused (default 16)\n"
+            "  --max-clients N    serve: open connections before new ones are refused (default " + to_string(MAX_CLIENTS) + ")\n"
+            "  --op OP            query: info, count, local, clustering or truss (default count)\n"
+            "  --k K              query: size of the truss whose edges are counted (default the largest)" << endl;
+}
+
+ServerOptions parseOptions(int argc, char** argv) {
+    if (argc < 2 || (string(argv[1]) != "serve" && string(argv[1]) != "query")) {
+        throw invalid_argument("serve or query expected");
+    }
+    ServerOptions options;
+    options.query = string(argv[1]) == "query";
+    bool threadsSet = false;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        auto value = [&]() -> string {
+            if (i + 1 >= argc) throw invalid_argument("missing value for " + arg);
+            return argv[++i];
+        };
+
+        if (arg == "--socket") options.socket = value();
+        else if (arg == "--graph") {
+            string graph = value();
+            size_t equals = graph.find('=');
+            if (options.query) options.graph = graph;
+            else if (equals == string::npos) throw invalid_argument("--graph needs NAME=FILE");
+            else options.graphs.emplace_back(graph.substr(0, equals), graph.substr(equals + 1));
+        }
+        else if (arg == "--threads") {
+            options.threads = stoi(value());
+            threadsSet = true;
+        }
+        else if (arg == "--workers") options.workers = stoi(value());
+        else if (arg == "--queue") options.queue = stoi(value());
+        else if (arg == "--max-clients") options.clients = stoi(value());
+        else if (arg == "--op") options.op = value();
+        else if (arg == "--k") options.k = stoi(value());
+        else if (arg == "--help") {
+            printUsage();
+            exit(0);
+        }
+        else throw invalid_argument("unknown option " + arg);
+    }
+    if (options.query && !threadsSet) options.threads = 0;
+    if (options.query && options.graph.empty()) throw invalid_argument("query needs --graph NAME");
+    if (!options.query && options.graphs.empty()) throw invalid_argument("serve needs at least one --graph");
+    return options;
+}
+
+/**
+ * Serve until SIGINT or SIGTERM, which are waited for by a thread since stop cannot run in a signal handler
+ */
+int serve(const ServerOptions& options) {
+    GraphServer server(options.socket, max(1, options.threads), options.workers, options.queue, options.clients);
+    for (const auto& [name, path]: options.graphs) {
+        server.addGraph(name, path);
+    }
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr); // inherited by the threads of the server
+    thread waiter([&server, signals]() {
+        int signal;
+        sigwait(&signals, &signal);
+        server.stop();
+    });
+    waiter.detach();
+
+    server.run();
+    cout << "stopped" << endl;
+    return 0;
+}
+
+int query(const ServerOptions& options) {
+    vector<string> ops = {"info", "count", "local", "clustering", "truss"};
+    auto op = find(ops.begin(), ops.end(), options.op);
+    if (op == ops.end()) {
+        throw invalid_argument("unknown query " + options.op);
+    }
+    GraphClient client(options.socket);
+    vector<char> payload;
+    QueryStatus status = client.query((QueryOp) (op - ops.begin()), options.graph, options.threads, options.k, payload);
+    if (status != STATUS_OK) {
+        cerr << "Error: " << string(payload.begin(), payload.end()) << endl;
+        return status == STATUS_BUSY ? 3 : 2;
+    }
+
+    const auto* integers = (const int64_t*) payload.data();
+    const auto* reals = (const double*) payload.data();
+    switch ((QueryOp) (op - ops.begin())) {
+        case QUERY_INFO:
+            cout << "nodes: " << integers[0] << ", edges: " << integers[1] << endl;
+            break;
+        case QUERY_COUNT:
+            cout << "triangles: " << integers[0] << endl;
+            break;
+        case QUERY_LOCAL:
+            for (size_t u = 0; u < payload.size() / sizeof(int64_t); u++) cout << u << " " << integers[u] << "\n";
+            break;
+        case QUERY_CLUSTERING:
+            cout << setprecision(6) << "transitivity: " << reals[0] << ", average clustering: " << reals[1] << endl;
+            break;
+        case QUERY_TRUSS:
+            cout << "max truss: " << integers[0] << ", edges in the " << (options.k > 0 ? options.k : integers[0])
+                 << "-truss: " << integers[1] << endl;
+            break;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    ServerOptions options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        printUsage();
+        return 2;
+    }
+
+    try {
+        return options.query ? query(options) : serve(options);
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 2;
+    }
+}
@@ -0,0 +1,1129 @@
+#include "../Graph_ds.h"
+#include "../Graph_csr.h"
+#include "../Graph_clique.h"
+#include "../Graph_partition.h"
+#include "../Graph_external.h"
+#include "../Checkpoint.h"
+#include "../Graph_stream.h"
+#include "../Graph_dynamic.h"
+#include "../Graph_truss.h"
+#include "../Graph_directed.h"
+#include "../Graph_compressed.h"
+#include "../Graph_roaring.h"
+#include "../RadixSort.h"
+#include "../Arena.h"
+#include "../Graph_reader.h"
+#include "../Decompress.h"
+#include "../Server.h"
+#include "triangles/Triangles.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <set>
+#include <map>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <filesystem>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <unistd.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace std;
+
+#ifndef TEST_DATA_DIR
+#define TEST_DATA_DIR "../assignments/asgmt_1/data/" //directory of the SNAP datasets
+#endif
+
+/**
+ * Differential tests of the counting kernels: every kernel on the same graph must agree with a brute-force
+ * oracle (small and random graphs) or with the known count (datasets), with 1, 2 and 4 threads.
+ * Run as "test_counting GROUP", groups are small, random, others, api, server and datasets.
+ */
+
+static atomic<int> nChecks = 0, nFailures = 0;
+
+#define CHECK_EQ(actual, expected, what) checkEqual((long long) (actual), (long long) (expected), what, __LINE__)
+
+static void checkEqual(long long actual, long long expected, const string& what, int line) {
+    nChecks++;
+    if (actual != expected) {
+        cerr << "line " << line << ": " << what << ": expected " << expected << ", got " << actual << endl;
+        nFailures++;
+    }
+}
+
+static const vector<int> THREADS = {1, 2, 4};
+
+/**
+ * @return whether run throws
+ */
+static bool throws(const function<void()>& run) {
+    try {
+        run();
+    } catch (const exception&) {
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Count the triangles by checking every triple of nodes, self-loops and duplicates ignored
+ */
+static long long bruteForce(int nNodes, const vector<pair<int, int>>& edges) {
+    set<pair<int, int>> edgeSet;
+    for (auto [u, v]: edges) {
+        nNodes = max(nNodes, max(u, v) + 1);
+        if (u != v) edgeSet.insert({min(u, v), max(u, v)});
+    }
+    vector<vector<bool>> adjacent(nNodes, vector<bool>(nNodes, false));
+    for (auto [u, v]: edgeSet) adjacent[u][v] = adjacent[v][u] = true;
+
+    long long count = 0;
+    for (int a = 0; a < nNodes; a++)
+        for (int b = a + 1; b < nNodes; b++)
+            if (adjacent[a][b])
+                for (int c = b + 1; c < nNodes; c++)
+                    count += adjacent[a][c] && adjacent[b][c];
+    return count;
+}
+
+/**
+ * k-cliques by extending each (k-1)-clique with higher nodes
+ */
+static long long bruteForceCliques(int nNodes, const vector<pair<int, int>>& edges, int k) {
+    vector<vector<bool>> adjacent = GraphMat::fromEdges(nNodes, edges);
+    function<long long(vector<int>&)> extend = [&](vector<int>& clique) -> long long {
+        if ((int) clique.size() == k) return 1;
+        long long count = 0;
+        for (int w = clique.empty() ? 0 : clique.back() + 1; w < (int) adjacent.size(); w++) {
+            bool all = true;
+            for (int u: clique) all = all && adjacent[u][w];
+            if (!all) continue;
+            clique.push_back(w);
+            count += extend(clique);
+            clique.pop_back();
+        }
+        return count;
+    };
+    vector<int> clique;
+    return extend(clique);
+}
+
+static string writeEdges(const vector<pair<int, int>>& edges) {
+    string path = filesystem::temp_directory_path().string() + "/test_counting_" + to_string(getpid()) + ".txt";
+    ofstream out(path, ios::trunc);
+    out << "# test graph\n";
+    for (auto [u, v]: edges) out << u << "\t" << v << "\n";
+    return path;
+}
+
+/**
+ * Run every in-memory kernel on a list of edges and compare it with the expected count
+ */
+static void checkAllKernels(const string& name, int nNodes, const vector<pair<int, int>>& edges, long long expected,
+                            bool matrixKernels = true) {
+    CSR graph = GraphCSR::fromEdges(nNodes, edges);
+    CSR dag = GraphCSR::orientByDegree(graph);
+
+    CHECK_EQ(GraphCSR::countTriangles_forward_seq(dag), expected, name + " forward merge");
+    CHECK_EQ(GraphCSR::countTriangles_forward_seq(dag, INTERSECT_ADAPTIVE), expected, name + " forward adaptive");
+    CHECK_EQ(GraphClique::countCliques_k<3>(dag, 1), expected, name + " 3-cliques");
+    RoaringGraph roaring = GraphRoaring::fromDag(dag);
+    for (int t: THREADS) {
+        string threads = " " + to_string(t) + " threads";
+        CSR parallel = GraphCSR::fromEdges(nNodes, edges, t);
+        CHECK_EQ(parallel.offsets == graph.offsets && parallel.neighbors == graph.neighbors, true, name + " csr build" + threads);
+        CSR parallelDag = GraphCSR::orientByDegree(graph, t);
+        CHECK_EQ(parallelDag.offsets == dag.offsets && parallelDag.neighbors == dag.neighbors, true, name + " orient" + threads);
+        CHECK_EQ(GraphCSR::countTriangles_forward_multi(dag, t), expected, name + " forward merge" + threads);
+        CHECK_EQ(GraphCSR::countTriangles_forward_multi(dag, t, INTERSECT_ADAPTIVE), expected, name + " forward adaptive" + threads);
+        CHECK_EQ(GraphClique::countCliques(dag, 3, t), expected, name + " cliques k=3" + threads);
+        CompressedCSR compressed = GraphCompressed::compress(graph, t);
+        CHECK_EQ(compressed.nNeighbors, (long long) dag.neighbors.size(), name + " compressed size" + threads);
+        CHECK_EQ(GraphCompressed::countTriangles_forward(compressed, t), expected, name + " compressed" + threads);
+        CHECK_EQ(GraphRoaring::countTriangles_forward(roaring, t), expected, name + " roaring" + threads);
+    }
+    DynamicGraph dynamic(nNodes, edges, 2);
+    CHECK_EQ(dynamic.getTriangles(), expected, name + " dynamic");
+
+    if (!matrixKernels) return;
+    vector<vector<bool>> matrix = GraphMat::fromEdges(nNodes, edges);
+    vector<pair<int, int>> uniqueEdges = GraphCSR::getEdges(graph);
+    vector<vector<int>> allInts = GraphMat::precomputeIntersection(matrix);
+
+    CHECK_EQ(GraphMat::countTriangles_node_seq(matrix), expected, name + " node");
+    CHECK_EQ(GraphMat::countTriangles_edge_seq(matrix), expected, name + " edge");
+    CHECK_EQ(GraphMat::ctTr_edgeFast_seq(matrix, allInts), expected, name + " fast");
+    CHECK_EQ(GraphMat::better_algo(matrix, uniqueEdges), expected, name + " better");
+    for (int t: THREADS) {
+        string threads = " " + to_string(t) + " threads";
+        CHECK_EQ(GraphMat::countTriangles_node_multi(matrix, t), expected, name + " node" + threads);
+        CHECK_EQ(GraphMat::countTriangles_edge_multi(matrix, t), expected, name + " edge" + threads);
+        CHECK_EQ(GraphMat::ctTr_edgeFast_multi(matrix, t, allInts), expected, name + " fast" + threads);
+    }
+}
+
+/**
+ * Same as checkAllKernels for the kernels that read a file of edges
+ */
+static void checkFileKernels(const string& name, const string& path, long long expected) {
+    for (int colors: {1, 2, 3, 5}) {
+        CHECK_EQ(GraphPartition::countTriangles_colorful(path, colors, 2, filesystem::temp_directory_path().string()),
+                 expected, name + " colorful " + to_string(colors) + " colors");
+    }
+    ExternalStats stats;
+    CHECK_EQ(GraphExternal::countTriangles_external(path, 1 << 20, 2, filesystem::temp_directory_path().string(), stats),
+             expected, name + " external");
+}
+
+static void testSmall() {
+    vector<pair<int, int>> triangle = {{0, 1}, {1, 2}, {2, 0}};
+    vector<pair<int, int>> k4 = {{0, 1}, {0, 2}, {0, 3}, {1, 2}, {1, 3}, {2, 3}};
+    vector<pair<int, int>> k5;
+    for (int u = 0; u < 5; u++)
+        for (int v = u + 1; v < 5; v++) k5.emplace_back(u, v);
+
+    checkAllKernels("no edges", 5, {}, 0);
+    checkAllKernels("single edge", 2, {{0, 1}}, 0);
+    checkAllKernels("triangle", 3, triangle, 1);
+    checkAllKernels("K4", 4, k4, 4);
+    checkAllKernels("K5", 5, k5, 10);
+    checkAllKernels("path", 5, {{0, 1}, {1, 2}, {2, 3}, {3, 4}}, 0);
+    checkAllKernels("star", 6, {{0, 1}, {0, 2}, {0, 3}, {0, 4}, {0, 5}}, 0);
+    checkAllKernels("square", 4, {{0, 1}, {1, 2}, {2, 3}, {3, 0}}, 0);
+    checkAllKernels("diamond", 4, {{0, 1}, {1, 2}, {2, 0}, {1, 3}, {2, 3}}, 2);
+    checkAllKernels("isolated nodes", 10, {{7, 8}, {8, 9}, {9, 7}}, 1);
+    checkAllKernels("self-loops", 3, {{0, 0}, {0, 1}, {1, 1}, {1, 2}, {2, 0}, {2, 2}}, 1);
+    checkAllKernels("duplicates", 3, {{0, 1}, {1, 0}, {0, 1}, {1, 2}, {2, 1}, {2, 0}, {0, 2}}, 1);
+    checkAllKernels("nodes raised by the edges", 0, triangle, 1);
+
+    string path = writeEdges({{0, 1}, {1, 0}, {1, 2}, {2, 2}, {2, 0}, {2, 3}, {3, 0}, {5, 6}});
+    CHECK_EQ(GraphMat::getEdges(path).size(), 8, "parsed edges");
+    checkFileKernels("file with duplicates and self-loops", path, 2);
+    filesystem::remove(path);
+}
+
+static void testRandom() {
+    mt19937 gen(2024);
+    for (int n: {8, 20, 45, 70}) {
+        for (double p: {0.05, 0.2, 0.5, 0.9}) {
+            unsigned seed = gen();
+            vector<pair<int, int>> edges = GraphMat::getEdges_dense(n, p, seed);
+            // Add some noise the kernels have to ignore
+            for (int i = 0; i < n / 4; i++) {
+                int u = (int) (gen() % n);
+                edges.emplace_back(u, u);
+                if (!edges.empty()) edges.emplace_back(edges[i].second, edges[i].first);
+            }
+            string name = "gnp(" + to_string(n) + ", " + to_string(p) + ", " + to_string(seed) + ")";
+            long long expected = bruteForce(n, edges);
+            checkAllKernels(name, n, edges, expected);
+
+            CSR dag = GraphCSR::orientByDegree(GraphCSR::fromEdges(n, edges));
+            for (int k: {4, 5}) {
+                CHECK_EQ(GraphClique::countCliques(dag, k, 2), bruteForceCliques(n, edges, k), name + " cliques k=" + to_string(k));
+            }
+        }
+    }
+
+    // Kernels that read a file, on a few of the random graphs
+    for (unsigned seed: {1u, 2u, 3u}) {
+        vector<pair<int, int>> edges = GraphMat::getEdges_dense(60, 0.3, seed);
+        string path = writeEdges(edges);
+        checkFileKernels("file gnp(60, 0.3, " + to_string(seed) + ")", path, bruteForce(60, edges));
+        filesystem::remove(path);
+    }
+}
+
+/**
+ * Every pair of Roaring container types: rows of 3 x 2^16 ids mixing sparse (array), dense (bitmap) and
+ * consecutive (run) chunks, intersected pairwise and counted, against sorted vectors
+ */
+static void testRoaring() {
+    mt19937 gen(17);
+    int n = 3 << 16;
+    auto getRow = [&gen](int chunkTypes) {
+        vector<int> row;
+        for (int chunk = 0; chunk < 3; chunk++) {
+            int type = (chunkTypes >> (2 * chunk)) & 3, base = chunk << 16;
+            if (type == 0) {
+                for (int i = 0; i < 300; i++) row.push_back(base + (int) (gen() % 65536));
+            } else if (type == 1) {
+                for (int low = 0; low < 65536; low++) if (gen() % 3 == 0) row.push_back(base + low);
+            } else if (type == 2) {
+                for (int r = 0; r < 20; r++) {
+                    int start = (int) (gen() % 65000);
+                    for (int low = start; low < start + (int) (gen() % 500); low++) row.push_back(base + low);
+                }
+            }
+        }
+        sort(row.begin(), row.end());
+        row.erase(unique(row.begin(), row.end()), row.end());
+        return row;
+    };
+
+    // Node i has row i, the rows only reference nodes > 64 so the DAG is valid as a graph of n nodes
+    vector<vector<int>> rows;
+    for (int types = 0; types < 64; types++) {
+        vector<int> row = getRow(types);
+        row.erase(row.begin(), lower_bound(row.begin(), row.end(), 64));
+        rows.push_back(row);
+    }
+    CSR dag;
+    dag.nNodes = n;
+    dag.offsets.assign(n + 1, 0);
+    for (int u = 0; u < n; u++) {
+        dag.offsets[u + 1] = dag.offsets[u] + (u < (int) rows.size() ? (long long) rows[u].size() : 0);
+        if (u < (int) rows.size()) dag.neighbors.insert(dag.neighbors.end(), rows[u].begin(), rows[u].end());
+    }
+    RoaringGraph roaring = GraphRoaring::fromDag(dag);
+    long long arrays, bitmaps, runs;
+    GraphRoaring::getRowCounts(roaring, arrays, bitmaps, runs);
+    CHECK_EQ(arrays > 0 && bitmaps > 0 && runs > 0, true, "roaring container types");
+
+    for (int u = 0; u < (int) rows.size(); u++) {
+        for (int v = 0; v < (int) rows.size(); v++) {
+            vector<int> common;
+            set_intersection(rows[u].begin(), rows[u].end(), rows[v].begin(), rows[v].end(), back_inserter(common));
+            CHECK_EQ(GraphRoaring::getIntersectionCardinality(roaring, u, v), common.size(),
+                     "roaring rows " + to_string(u) + " " + to_string(v));
+        }
+    }
+}
+
+/**
+ * Both radix sorts against std::sort, on key distributions that exercise the skipped digits, the single-bucket
+ * levels of the in-place sort and the ranges left to std::sort
+ */
+static void testRadixSort() {
+    mt19937_64 gen(5);
+    vector<pair<string, function<uint64_t(long long)>>> distributions = {
+            {"random", [&gen](long long) { return gen(); }},
+            {"edges", [&gen](long long) { return RadixSort::pack((int) (gen() % 5000), (int) (gen() % 5000)); }},
+            {"equal", [](long long) { return 42ULL; }},
+            {"few values", [&gen](long long) { return (gen() % 3) << 40; }},
+            {"sorted", [](long long i) { return (uint64_t) i * 7; }},
+            {"reversed", [](long long i) { return ~(uint64_t) i; }},
+            {"high digit only", [&gen](long long) { return (gen() % 200) << 56 | 12345; }}};
+    for (const auto& [name, next]: distributions) {
+        for (long long n: {0LL, 1LL, 255LL, 256LL, 1000LL, 100000LL}) {
+            vector<uint64_t> keys(n);
+            for (long long i = 0; i < n; i++) keys[i] = next(i);
+            vector<uint64_t> expected = keys;
+            sort(expected.begin(), expected.end());
+            for (int t: THREADS) {
+                string what = "radix " + name + " n=" + to_string(n) + " " + to_string(t) + " threads";
+                vector<uint64_t> sorted = keys;
+                RadixSort::sort(sorted, t);
+                CHECK_EQ(sorted == expected, true, what);
+                sorted = keys;
+                RadixSort::sortInPlace(sorted, t);
+                CHECK_EQ(sorted == expected, true, what + " in place");
+            }
+        }
+    }
+}
+
+/**
+ * Arena allocations in every huge-page mode: alignment, contents across a reallocation, regions released
+ */
+static void testArena() {
+    long long regions = Arena::getRegionBytes();
+    for (HugePages mode: {HUGE_PAGES_OFF, HUGE_PAGES_TRANSPARENT, HUGE_PAGES_EXPLICIT}) {
+        Arena::setHugePages(mode);
+        string name = "arena " + Arena::getName(mode);
+        CHECK_EQ(Arena::parseHugePages(Arena::getName(mode)), mode, name + " name");
+        {
+            ArenaVector<int> small(100, 7);
+            CHECK_EQ((uintptr_t) small.data() % ARENA_ALIGNMENT, 0, name + " small alignment");
+            ArenaVector<long long> large(3 * ARENA_MIN_REGION / sizeof(long long));
+            CHECK_EQ((uintptr_t) large.data() % ARENA_HUGE_PAGE, 0, name + " region alignment");
+            CHECK_EQ(Arena::getRegionBytes() - regions, 2 * ARENA_HUGE_PAGE, name + " region bytes");
+            for (size_t i = 0; i < large.size(); i++) large[i] = (long long) i;
+            large.resize(large.size() * 2, -1);
+            CHECK_EQ(large[12345] == 12345 && large.back() == -1, true, name + " contents after growing");
+            small.resize(ARENA_MIN_REGION, 1);
+            CHECK_EQ(small[99] == 7 && small.back() == 1, true, name + " small grown into a region");
+        }
+        CHECK_EQ(Arena::getRegionBytes(), regions, name + " regions released");
+    }
+    Arena::setHugePages(HUGE_PAGES_TRANSPARENT);
+
+    vector<pair<int, int>> edges = GraphMat::getEdges_dense(300, 0.2, 3);
+    CHECK_EQ(GraphCSR::countTriangles_forward_seq(GraphCSR::orientByDegree(GraphCSR::fromEdges(300, edges))),
+             bruteForce(300, edges), "arena csr");
+}
+
+/**
+ * The same graph written in every format: detected, sized from the header and counted like the SNAP list;
+ * malformed files rejected
+ */
+static void testReaders() {
+    int n = 50;
+    vector<pair<int, int>> edges = GraphMat::getEdges_dense(n, 0.3, 5);
+    long long expected = bruteForce(n, edges);
+    string base = filesystem::temp_directory_path().string() + "/test_readers_" + to_string(getpid());
+    vector<vector<int>> adjacency(n);
+    for (auto [u, v]: edges) {
+        adjacency[u].push_back(v);
+        adjacency[v].push_back(u);
+    }
+    map<string, string> files; // path -> format
+    {
+        string path = base + "_general.mtx";
+        ofstream out(path);
+        out << "%%MatrixMarket matrix coordinate pattern general\n% comment\n" << n << " " << n << " " << edges.size() << "\n";
+        for (auto [u, v]: edges) out << u + 1 << " " << v + 1 << "\n";
+        files[path] = "matrix-market";
+    }
+    {
+        string path = base + "_symmetric.mm";
+        ofstream out(path);
+        out << "%%MatrixMarket matrix coordinate real symmetric\n" << n << " " << n << " " << edges.size() << "\n";
+        for (auto [u, v]: edges) out << max(u, v) + 1 << " " << min(u, v) + 1 << " 0.5\n";
+        files[path] = "matrix-market";
+    }
+    {
+        string path = base + ".graph";
+        ofstream out(path);
+        out << "% METIS, node sizes skipped and edge weights\n" << n << " " << edges.size() << " 011 1\n";
+        for (int u = 0; u < n; u++) {
+            if (adjacency[u].empty()) {
+                out << "\n";
+                continue;
+            }
+            out << "3";
+            for (int v: adjacency[u]) out << " " << v + 1 << " 9";
+            out << "\n";
+        }
+        files[path] = "metis";
+    }
+    {
+        string path = base + "_edges.dat";
+        ofstream out(path, ios::binary);
+        for (auto [u, v]: edges) {
+            int32_t pair[2] = {u, v};
+            out.write((const char*) pair, sizeof(pair));
+        }
+        files[path] = "binary";
+    }
+    {
+        string path = base + ".txt";
+        ofstream out(path);
+        out << "# SNAP\n";
+        for (auto [u, v]: edges) out << u << "\t" << v << "\n";
+        files[path] = "snap";
+    }
+    {
+        string path = base + "_snapshot.dat";
+        GraphCSR::saveSnapshot(GraphCSR::fromEdges(n, edges), path);
+        files[path] = "snapshot";
+    }
+
+    for (auto& [path, format]: files) {
+        string name = "reader " + filesystem::path(path).filename().string();
+        CHECK_EQ(GraphReader::detectFormat(path) == format, true, name + " detected as " + format);
+        long long nNodes = -1, nEdges = -1;
+        if (GraphReader::getSize(path, "auto", nNodes, nEdges)) {
+            CHECK_EQ(nEdges, (long long) edges.size(), name + " size");
+        } else {
+            CHECK_EQ(format == "snap", true, name + " without size");
+        }
+        for (int threads: THREADS) {
+            CSR graph = GraphReader::read(path, "auto", 0, threads);
+            CHECK_EQ(graph.nNodes >= n - 1, true, name + " nodes");
+            CHECK_EQ(GraphCSR::countTriangles_forward_seq(GraphCSR::orientByDegree(graph)), expected,
+                     name + " threads=" + to_string(threads));
+        }
+        CHECK_EQ(GraphCSR::countTriangles_forward_seq(GraphCSR::orientByDegree(GraphReader::read(path, format))),
+                 expected, name + " as " + format);
+    }
+    CHECK_EQ(triangles::countTriangles(triangles::Graph::load(base + ".graph"), {}), expected, "reader api");
+
+    // Malformed files
+    string bad = base + "_bad";
+    {
+        ofstream(bad) << "%%MatrixMarket matrix array real general\n3 3\n1\n2\n3\n4\n5\n6\n7\n8\n9\n";
+        CHECK_EQ(throws([&] { GraphReader::read(bad); }), true, "reader matrix market array");
+        ofstream(bad) << "%%MatrixMarket matrix coordinate pattern general\n4 4 3\n1 2\n2 3\n";
+        CHECK_EQ(throws([&] { GraphReader::read(bad); }), true, "reader matrix market truncated");
+        ofstream(bad) << "%%MatrixMarket matrix coordinate pattern general\n4 4 1\n1 5\n";
+        CHECK_EQ(throws([&] { GraphReader::read(bad); }), true, "reader matrix market outside");
+        ofstream(bad) << "4 3\n2\n1 3\n";
+        CHECK_EQ(throws([&] { GraphReader::read(bad, "metis"); }), true, "reader metis truncated");
+        ofstream(bad) << "3 1\n2\n1 7\n\n";
+        CHECK_EQ(throws([&] { GraphReader::read(bad, "metis"); }), true, "reader metis outside");
+        ofstream(bad, ios::binary).write("\1\0\0\0\2\0\0\0\3\0\0\0", 12);
+        CHECK_EQ(throws([&] { GraphReader::read(bad); }), true, "reader binary not pairs");
+        CHECK_EQ(throws([&] { GraphReader::read(bad, "unknown"); }), true, "reader unknown format");
+    }
+    filesystem::remove(bad);
+    for (auto& file: files) filesystem::remove(file.first);
+}
+
+/**
+ * One zstd frame of raw (stored) blocks, enough for the decoder without a zstd encoder
+ */
+static void writeZstdFrame(ofstream& out, const string& text) {
+    const size_t block = 1 << 17;
+    out.write("\x28\xb5\x2f\xfd", 4);
+    out.put(0x00); // no content size, no checksum, a window descriptor follows
+    out.put(0x38); // window of 2^17 bytes, the largest block
+    size_t at = 0;
+    do {
+        size_t size = min(block, text.size() - at);
+        uint32_t header = (uint32_t) size << 3 | (at + size == text.size() ? 1 : 0); // raw block, last
+        out.write((const char*) &header, 3);
+        out.write(text.data() + at, (long) size);
+        at += size;
+    } while (at < text.size());
+}
+
+/**
+ * An edge list of more than one chunk compressed with gzip and zstd, each in two members/frames split inside a
+ * line: the edges are those of the plain file, in order, with any number of parsers; truncated files rejected
+ */
+static void testCompressed() {
+    vector<pair<int, int>> edges = GraphMat::getEdges_dense(2000, 0.06, 9);
+    string plain = writeEdges(edges);
+    vector<pair<int, int>> expected = GraphMat::getEdges(plain);
+    long long triangles = GraphCSR::countTriangles_forward_seq(GraphCSR::orientByDegree(GraphCSR::fromEdges(0, expected)));
+    ifstream in(plain, ios::binary);
+    string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    CHECK_EQ(text.size() > DECOMPRESS_CHUNK, true, "compressed more than a chunk");
+    size_t half = text.find('\n', text.size() / 2) - 2;
+    string base = filesystem::temp_directory_path().string() + "/test_compressed_" + to_string(getpid());
+
+    map<string, Compression> files;
+#ifdef HAVE_ZLIB
+    {
+        string path = base + ".txt.gz";
+        for (int member = 0; member < 2; member++) {
+            gzFile out = gzopen(path.c_str(), member == 0 ? "wb" : "ab");
+            string part = member == 0 ? text.substr(0, half) : text.substr(half);
+            gzwrite(out, part.data(), (unsigned) part.size());
+            gzclose(out);
+        }
+        files[path] = COMPRESSION_GZIP;
+    }
+#endif
+    {
+        string path = base + ".txt.zst";
+        ofstream out(path, ios::binary);
+        writeZstdFrame(out, text.substr(0, half));
+        writeZstdFrame(out, text.substr(half));
+        files[path] = COMPRESSION_ZSTD;
+    }
+
+    for (auto& [path, compression]: files) {
+        string name = "compressed " + Decompress::getName(compression);
+        CHECK_EQ(Decompress::detect(path), compression, name + " detected");
+        if (!Decompress::isSupported(compression)) {
+            CHECK_EQ(throws([&] { GraphMat::getEdges(path); }), true, name + " not built in");
+            continue;
+        }
+        CHECK_EQ(GraphReader::detectFormat(path) == "snap", true, name + " format");
+        CHECK_EQ(Decompress::readHead(path, 12) == text.substr(0, 12), true, name + " head");
+        for (int threads: THREADS) {
+            CHECK_EQ(GraphMat::getEdges(path, threads) == expected, true, name + " edges threads=" + to_string(threads));
+        }
+        CHECK_EQ(GraphCSR::countTriangles_forward_seq(GraphCSR::orientByDegree(GraphReader::read(path, "auto", 0, 2))),
+                 triangles, name + " count");
+
+        string truncated = base + "_truncated" + filesystem::path(path).extension().string();
+        {
+            ifstream full(path, ios::binary);
+            string bytes((istreambuf_iterator<char>(full)), istreambuf_iterator<char>());
+            ofstream(truncated, ios::binary) << bytes.substr(0, bytes.size() * 3 / 4);
+        }
+        CHECK_EQ(throws([&] { GraphMat::getEdges(truncated, 2); }), true, name + " truncated");
+        filesystem::remove(truncated);
+    }
+
+    // Other formats are not read compressed
+    string matrix = base + ".mtx.zst";
+    {
+        ofstream out(matrix, ios::binary);
+        writeZstdFrame(out, "%%MatrixMarket matrix coordinate pattern general\n3 3 1\n1 2\n");
+    }
+    if (Decompress::isSupported(COMPRESSION_ZSTD)) {
+        CHECK_EQ(GraphReader::detectFormat(matrix) == "matrix-market", true, "compressed matrix market detected");
+    }
+    CHECK_EQ(throws([&] { GraphReader::read(matrix); }), true, "compressed matrix market rejected");
+    filesystem::remove(matrix);
+    for (auto& file: files) filesystem::remove(file.first);
+    filesystem::remove(plain);
+}
+
+/**
+ * Cancellation, deadline and progress of the API: stopped before the start, stopped from the progress callback
+ * after a few blocks, a deadline already passed, an exception of the progress callback, a count that runs to
+ * the end, and a slow callback that is never called concurrently
+ */
+static void testControl() {
+    using Clock = chrono::steady_clock;
+    for (auto backend: {triangles::Backend::Csr, triangles::Backend::Compressed, triangles::Backend::Roaring,
+                        triangles::Backend::Matrix}) {
+        // Enough nodes for many blocks of CONTROL_BLOCK, the matrix is checked after each row
+        int n = backend == triangles::Backend::Matrix ? 200 : 2000;
+        vector<pair<int, int>> edges = GraphMat::getEdges_dense(n, backend == triangles::Backend::Matrix ? 0.2 : 0.02, 3);
+        triangles::Graph graph = triangles::Graph::fromEdges(n, edges);
+        long long expected = triangles::countTriangles(graph, {1, backend});
+        string name = "control backend " + to_string((int) backend);
+
+        for (int threads: THREADS) {
+            triangles::Options options = {threads, backend};
+            options.cancel.cancel();
+            triangles::PartialCount partial = triangles::countTrianglesPartial(graph, options);
+            CHECK_EQ(partial.complete, false, name + " cancelled before the start");
+            CHECK_EQ(partial.count, 0, name + " nothing counted");
+            CHECK_EQ(throws([&] { triangles::countTriangles(graph, options); }), true, name + " Cancelled thrown");
+
+            options = {threads, backend};
+            triangles::CancellationToken token = options.cancel;
+            atomic<int> calls = 0;
+            options.progress = [&](const triangles::Progress&) {
+                calls++;
+                token.cancel();
+            };
+            options.progressInterval = 0;
+            partial = triangles::countTrianglesPartial(graph, options);
+            CHECK_EQ(calls > 0, true, name + " progress called");
+            CHECK_EQ(partial.complete, false, name + " cancelled from progress");
+            CHECK_EQ(partial.count <= expected, true, name + " partial count at most the count");
+            CHECK_EQ(partial.fraction > 0 && partial.fraction < 1, true, name + " partial fraction");
+            try {
+                triangles::countTriangles(graph, options);
+                CHECK_EQ(false, true, name + " Cancelled not thrown");
+            } catch (const triangles::Cancelled& cancelled) {
+                CHECK_EQ(cancelled.partial.complete, false, name + " Cancelled partial");
+            }
+
+            options = {threads, backend};
+            options.deadline = Clock::now() - chrono::seconds(1);
+            partial = triangles::countTrianglesPartial(graph, options);
+            CHECK_EQ(partial.complete, false, name + " deadline passed");
+
+            options = {threads, backend};
+            options.progress = [](const triangles::Progress&) { throw invalid_argument("progress failed"); };
+            options.progressInterval = 0;
+            try {
+                triangles::countTrianglesPartial(graph, options);
+                CHECK_EQ(false, true, name + " progress error not thrown");
+            } catch (const invalid_argument& error) {
+                CHECK_EQ(string(error.what()) == "progress failed", true, name + " progress error rethrown");
+            }
+
+            options = {threads, backend};
+            options.deadline = Clock::now() + chrono::hours(1);
+            calls = 0;
+            options.progress = [&](const triangles::Progress&) { calls++; };
+            options.progressInterval = 0;
+            partial = triangles::countTrianglesPartial(graph, options);
+            CHECK_EQ(partial.count, expected, name + " complete count");
+            CHECK_EQ(partial.complete && partial.fraction == 1, true, name + " complete");
+            CHECK_EQ(calls > 0, true, name + " progress of a complete count");
+        }
+    }
+
+    // A callback slower than the interval is never entered by two threads at once
+    int n = 2000;
+    triangles::Graph graph = triangles::Graph::fromEdges(n, GraphMat::getEdges_dense(n, 0.02, 3));
+    triangles::Options options = {4, triangles::Backend::Csr};
+    atomic<int> inside = 0, most = 0;
+    options.progress = [&](const triangles::Progress&) {
+        most = max(most.load(), ++inside);
+        this_thread::sleep_for(chrono::milliseconds(2));
+        inside--;
+    };
+    options.progressInterval = 0;
+    triangles::countTriangles(graph, options);
+    CHECK_EQ(most, 1, "progress called one thread at a time");
+}
+
+/**
+ * Colorful and external counts running at the same time in one process, each with its own scratch directory, and
+ * counts that throw after writing their files, which must not leave them behind nor open
+ */
+static void testScratch() {
+    int n = 300;
+    vector<pair<int, int>> edges = GraphMat::getEdges_dense(n, 0.2, 9);
+    long long expected = GraphCSR::countTriangles_forward_seq(GraphCSR::orientByDegree(GraphCSR::fromEdges(n, edges)));
+    string path = writeEdges(edges);
+    string tmpDir = filesystem::temp_directory_path().string() + "/test_scratch_" + to_string(getpid());
+    auto count = [&](int t, Checkpoint* checkpoint) {
+        ExternalStats stats;
+        return t % 2 == 0 ? GraphPartition::countTriangles_colorful(path, 3, 1, tmpDir, checkpoint)
+                          : GraphExternal::countTriangles_external(path, 1 << 20, 1, tmpDir, stats, checkpoint);
+    };
+
+    vector<long long> counts(4);
+    vector<thread> threads;
+    for (int t = 0; t < (int) counts.size(); t++) {
+        threads.emplace_back([&, t]() {
+            if (throws([&] { counts[t] = count(t, nullptr); })) counts[t] = -1;
+        });
+    }
+    for (thread& thread: threads) thread.join();
+    for (int t = 0; t < (int) counts.size(); t++) {
+        CHECK_EQ(counts[t], expected, "concurrent count " + to_string(t));
+    }
+
+    // The checkpoint cannot be written, its first update throws
+    auto countDescriptors = []() {
+        return distance(filesystem::directory_iterator("/proc/self/fd"), filesystem::directory_iterator());
+    };
+    for (int t = 0; t < 2; t++) {
+        auto descriptors = countDescriptors();
+        Checkpoint unwritable(tmpDir + "/missing/checkpoint.txt", false, 0);
+        CHECK_EQ(throws([&] { count(t, &unwritable); }), true, "unwritable checkpoint " + to_string(t));
+        CHECK_EQ(filesystem::is_empty(tmpDir), true, "scratch removed " + to_string(t));
+        CHECK_EQ(countDescriptors(), descriptors, "files closed " + to_string(t));
+    }
+    filesystem::remove_all(tmpDir);
+    filesystem::remove(path);
+}
+
+/**
+ * Colorful and external stopped after every unit or block, each run resuming the checkpoint of the previous one,
+ * end with the count of a run that is never stopped
+ */
+static void testCheckpoint() {
+    int n = 1500; // about 170000 edges, two passes of external with 1 MiB
+    vector<pair<int, int>> edges = GraphMat::getEdges_dense(n, 0.15, 5);
+    long long expected = GraphCSR::countTriangles_forward_seq(GraphCSR::orientByDegree(GraphCSR::fromEdges(n, edges)));
+    string path = writeEdges(edges);
+    string tmpDir = filesystem::temp_directory_path().string();
+    string file = tmpDir + "/test_checkpoint_" + to_string(getpid()) + ".txt";
+    ExternalStats stats;
+    auto count = [&](const string& algorithm, long long parameter, Checkpoint* checkpoint) {
+        return algorithm == "colorful" ? GraphPartition::countTriangles_colorful(path, (int) parameter, 2, tmpDir, checkpoint)
+                                       : GraphExternal::countTriangles_external(path, parameter, 2, tmpDir, stats, checkpoint);
+    };
+
+    atomic<bool> stop = true;
+    for (auto [algorithm, parameter]: vector<pair<string, long long>> {{"colorful", 3}, {"external", 1 << 20}}) {
+        filesystem::remove(file);
+        long long counted;
+        int runs = 0;
+        while (true) {
+            Checkpoint checkpoint(file, true, 0);
+            checkpoint.setStop(&stop);
+            counted = count(algorithm, parameter, &checkpoint);
+            runs++;
+            if (!checkpoint.isStopped()) break;
+        }
+        CHECK_EQ(counted, expected, algorithm + " resumed");
+        CHECK_EQ(runs > 3, true, algorithm + " stopped and resumed");
+
+        Checkpoint finished(file, true);
+        CHECK_EQ(count(algorithm, parameter, &finished), expected, algorithm + " finished checkpoint");
+        Checkpoint other(file, true);
+        CHECK_EQ(throws([&] { count(algorithm, 2 * parameter, &other); }), true, algorithm + " checkpoint of another run");
+        Checkpoint overwritten(file, false);
+        CHECK_EQ(count(algorithm, 2 * parameter, &overwritten), expected, algorithm + " checkpoint overwritten");
+    }
+    filesystem::remove(file);
+    filesystem::remove(path);
+}
+
+/**
+ * Census by brute force: each triple of connected nodes is matched, in every order of its nodes, against the arcs
+ * of each type as listed in Graph_directed.h
+ */
+static TriangleCensus bruteForceCensus(int nNodes, const vector<pair<int, int>>& arcs) {
+    vector<vector<bool>> has(nNodes, vector<bool>(nNodes, false));
+    for (auto [u, v]: arcs) if (u != v) has[u][v] = true;
+    // Arcs of each type between the positions 0, 1, 2 of the nodes
+    const vector<vector<pair<int, int>>> patterns = {
+        {{0, 1}, {0, 2}, {1, 2}}, {{0, 1}, {1, 2}, {2, 0}}, {{0, 1}, {1, 0}, {2, 0}, {2, 1}},
+        {{0, 1}, {1, 0}, {0, 2}, {1, 2}}, {{0, 1}, {1, 0}, {0, 2}, {2, 1}}, {{0, 1}, {1, 0}, {1, 2}, {2, 1}, {0, 2}},
+        {{0, 1}, {1, 0}, {0, 2}, {2, 0}, {1, 2}, {2, 1}}};
+
+    TriangleCensus census;
+    census.local.assign(nNodes, {});
+    for (int a = 0; a < nNodes; a++)
+        for (int b = a + 1; b < nNodes; b++)
+            for (int c = b + 1; c < nNodes; c++) {
+                if (!(has[a][b] || has[b][a]) || !(has[a][c] || has[c][a]) || !(has[b][c] || has[c][b])) continue;
+                int order[3] = {a, b, c};
+                int found = -1;
+                do {
+                    for (int type = 0; type < N_TRIANGLE_TYPES && found < 0; type++) {
+                        bool match = true;
+                        for (int i = 0; i < 3; i++)
+                            for (int j = 0; j < 3; j++) {
+                                if (i == j) continue;
+                                bool inPattern = find(patterns[type].begin(), patterns[type].end(), make_pair(i, j)) != patterns[type].end();
+                                match &= has[order[i]][order[j]] == inPattern;
+                            }
+                        if (match) found = type;
+                    }
+                } while (found < 0 && next_permutation(order, order + 3));
+                census.counts[found]++;
+                for (int node: {a, b, c}) census.local[node][found]++;
+            }
+    return census;
+}
+
+/**
+ * Directed census of hand-built triangles of each type and of random directed graphs against brute force
+ */
+static void testCensus() {
+    // One triangle of each type, in the order of TriangleType, on disjoint nodes
+    vector<pair<int, int>> arcs = {{0, 1}, {0, 2}, {1, 2},
+                                   {3, 4}, {4, 5}, {5, 3},
+                                   {6, 7}, {7, 6}, {8, 6}, {8, 7},
+                                   {9, 10}, {10, 9}, {9, 11}, {10, 11},
+                                   {12, 13}, {13, 12}, {12, 14}, {14, 13},
+                                   {15, 16}, {16, 15}, {16, 17}, {17, 16}, {15, 17},
+                                   {18, 19}, {19, 18}, {18, 20}, {20, 18}, {19, 20}, {20, 19}, {19, 20}, {21, 21}};
+    for (int t: THREADS) {
+        TriangleCensus census = GraphDirected::countCensus(GraphDirected::fromArcs(22, arcs, t), t, true);
+        for (int type = 0; type < N_TRIANGLE_TYPES; type++) {
+            string name = "census " + GraphDirected::getName((TriangleType) type) + " " + to_string(t) + " threads";
+            CHECK_EQ(census.counts[type], 1, name);
+            CHECK_EQ(census.local[3 * type][type] + census.local[3 * type + 1][type] + census.local[3 * type + 2][type], 3, name + " local");
+        }
+    }
+
+    for (unsigned seed = 1; seed <= 4; seed++) {
+        int n = 40;
+        mt19937 gen(seed);
+        vector<pair<int, int>> randomArcs;
+        for (int i = 0; i < 150 * (int) seed; i++) randomArcs.emplace_back((int) (gen() % n), (int) (gen() % n));
+        TriangleCensus expected = bruteForceCensus(n, randomArcs);
+        string name = "census random " + to_string(seed);
+        CHECK_EQ(expected.getTotal(), bruteForce(n, randomArcs), name + " brute force total");
+
+        for (int t: THREADS) {
+            DirectedCSR graph = GraphDirected::fromArcs(n, randomArcs, t);
+            set<pair<int, int>> unique;
+            for (auto [u, v]: randomArcs) if (u != v) unique.insert({u, v});
+            CHECK_EQ((long long) graph.out.neighbors.size(), (long long) unique.size(), name + " out arcs");
+            CHECK_EQ((long long) graph.in.neighbors.size(), (long long) unique.size(), name + " in arcs");
+
+            TriangleCensus census = GraphDirected::countCensus(graph, t, true);
+            CHECK_EQ(census.counts == expected.counts, true, name + " counts " + to_string(t) + " threads");
+            CHECK_EQ(census.local == expected.local, true, name + " local " + to_string(t) + " threads");
+            CHECK_EQ(GraphDirected::countCensus(graph, t).local.empty(), true, name + " no local");
+        }
+    }
+}
+
+/**
+ * Everything but the kernels counting a whole graph: Roaring containers, radix sorts, arena, readers and
+ * decompression, control of long counts, scratch directories, checkpoints and the directed census, then the
+ * streaming and dynamic counts against a recount after every batch
+ */
+static void testOthers() {
+    testRoaring();
+    testRadixSort();
+    testArena();
+    testReaders();
+    testCompressed();
+    testControl();
+    testScratch();
+    testCheckpoint();
+    testCensus();
+
+    mt19937 gen(7);
+    int n = 40;
+    vector<pair<int, int>> edges = GraphMat::getEdges_dense(n, 0.3, 11);
+
+    // TRIEST is exact while the whole stream fits in the reservoir
+    TriestFD triest((long long) edges.size() + 1, true, 5);
+    for (auto [u, v]: edges) triest.insertEdge(u, v);
+    CHECK_EQ(llround(triest.getGlobalEstimate()), bruteForce(n, edges), "triest insertions");
+    for (size_t i = 0; i < edges.size() / 3; i++) triest.deleteEdge(edges[i].first, edges[i].second);
+    vector<pair<int, int>> rest(edges.begin() + (long) (edges.size() / 3), edges.end());
+    CHECK_EQ(llround(triest.getGlobalEstimate()), bruteForce(n, rest), "triest deletions");
+
+    // Batches of insertions and deletions, with duplicates and conflicts inside a batch
+    DynamicGraph dynamic(n);
+    set<pair<int, int>> current;
+    for (int batch = 0; batch < 20; batch++) {
+        vector<pair<int, int>> insertions, deletions;
+        for (int i = 0; i < 30; i++) {
+            int u = (int) (gen() % n), v = (int) (gen() % n);
+            if (u == v) continue;
+            pair<int, int> edge = {min(u, v), max(u, v)};
+            if (current.count(edge) && gen() % 2) deletions.push_back(edge);
+            else insertions.emplace_back(v, u);
+        }
+        dynamic.applyBatch(insertions, deletions, 1 + batch % 4);
+        for (auto edge: deletions) current.erase(edge);
+        for (auto [v, u]: insertions) current.insert({min(u, v), max(u, v)});
+
+        vector<pair<int, int>> now(current.begin(), current.end());
+        CHECK_EQ(dynamic.getTriangles(), bruteForce(n, now), "dynamic batch " + to_string(batch));
+        CHECK_EQ(dynamic.getNumEdges(), (long long) now.size(), "dynamic edges batch " + to_string(batch));
+    }
+}
+
+/**
+ * The library API: counts of each backend, local counts and enumeration against brute force, snapshot round trip
+ */
+static void testApi() {
+    for (unsigned seed = 1; seed <= 5; seed++) {
+        int n = 50;
+        vector<pair<int, int>> edges = GraphMat::getEdges_dense(n, 0.1 * seed, seed);
+        long long expected = bruteForce(n, edges);
+        string name = "api gnp(50, " + to_string(seed) + ")";
+        triangles::Graph graph = triangles::Graph::fromEdges(n, edges);
+
+        for (int threads: THREADS) {
+            for (auto backend: {triangles::Backend::Csr, triangles::Backend::Matrix, triangles::Backend::Compressed,
+                                 triangles::Backend::Roaring}) {
+                for (auto kernel: {triangles::Kernel::Merge, triangles::Kernel::Adaptive}) {
+                    CHECK_EQ(triangles::countTriangles(graph, {threads, backend, kernel}), expected, name + " count");
+                }
+            }
+
+            // Each node is in the triangles of the graph minus the graph without its edges
+            vector<int64_t> local = triangles::countLocalTriangles(graph, {threads});
+            long long sum = 0;
+            for (int u = 0; u < n; u++) {
+                vector<pair<int, int>> without;
+                for (auto [a, b]: edges) if (a != u && b != u) without.emplace_back(a, b);
+                CHECK_EQ(local[u], expected - bruteForce(n, without), name + " local " + to_string(u));
+                sum += local[u];
+            }
+            CHECK_EQ(sum, 3 * expected, name + " local sum");
+
+            mutex lock;
+            set<vector<int>> found;
+            long long visits = 0;
+            triangles::enumerateTriangles(graph, [&](int u, int v, int w) {
+                vector<int> triangle = {u, v, w};
+                sort(triangle.begin(), triangle.end());
+                lock_guard<mutex> guard(lock);
+                found.insert(triangle);
+                visits++;
+            }, {threads});
+            CHECK_EQ(visits, expected, name + " enumerate");
+            CHECK_EQ(found.size(), expected, name + " enumerate distinct");
+            CHECK_EQ(triangles::countCliques(graph, 4, {threads}), bruteForceCliques(n, edges, 4), name + " 4-cliques");
+        }
+
+        // Caller-owned columns and interleaved pairs, read in place
+        vector<int32_t> columns(2 * edges.size());
+        vector<int64_t> pairs(2 * edges.size());
+        for (size_t i = 0; i < edges.size(); i++) {
+            columns[i] = edges[i].first;
+            columns[edges.size() + i] = edges[i].second;
+            pairs[2 * i] = edges[i].first;
+            pairs[2 * i + 1] = edges[i].second;
+        }
+        long long m = (long long) edges.size();
+        CHECK_EQ(triangles::countTriangles(triangles::Graph::fromEdges(n, columns.data(), columns.data() + m, m)), expected, name + " columns");
+        CHECK_EQ(triangles::countTriangles(triangles::Graph::fromEdges(n, pairs.data(), pairs.data() + 1, m, 2)), expected, name + " pairs");
+
+        string path = writeEdges(edges);
+        triangles::Graph loaded = triangles::Graph::load(path);
+        CHECK_EQ(triangles::countTriangles(loaded), expected, name + " load edges");
+        loaded.save(path);
+        triangles::Graph snapshot = triangles::Graph::load(path);
+        CHECK_EQ(snapshot.numEdges(), graph.numEdges(), name + " snapshot edges");
+        CHECK_EQ(triangles::countTriangles(snapshot), expected, name + " load snapshot");
+        filesystem::remove(path);
+    }
+}
+
+/**
+ * Trussness by definition: the k-truss is what is left after removing, until none is left, the edges in fewer
+ * than k - 2 triangles
+ */
+static map<pair<int, int>, int> bruteForceTruss(int nNodes, const vector<pair<int, int>>& edges) {
+    set<pair<int, int>> left;
+    for (auto [u, v]: edges) if (u != v) left.insert({min(u, v), max(u, v)});
+    map<pair<int, int>, int> trussness;
+    for (auto edge: left) trussness[edge] = 2;
+    for (int k = 3; !left.empty(); k++) {
+        bool removed = true;
+        while (removed) {
+            removed = false;
+            for (auto it = left.begin(); it != left.end();) {
+                auto [u, v] = *it;
+                int support = 0;
+                for (int w = 0; w < nNodes; w++) {
+                    support += left.count({min(u, w), max(u, w)}) && left.count({min(v, w), max(v, w)});
+                }
+                if (support < k - 2) {
+                    it = left.erase(it);
+                    removed = true;
+                } else {
+                    it++;
+                }
+            }
+        }
+        for (auto edge: left) trussness[edge] = k;
+    }
+    return trussness;
+}
+
+/**
+ * Run the server on a thread, its exceptions counted as failures, once it listens
+ */
+static thread serveInBackground(GraphServer& server) {
+    thread serving([&server]() {
+        try {
+            server.run();
+        } catch (const exception& e) {
+            cerr << "server: " << e.what() << endl;
+            CHECK_EQ(false, true, "server run");
+        }
+    });
+    CHECK_EQ(server.waitListening(10), true, "server listening");
+    return serving;
+}
+
+/**
+ * Truss decomposition against the definition, and every query of the server against the library,
+ * connections past the limit of the server
+ */
+static void testServer() {
+    for (unsigned seed = 1; seed <= 4; seed++) {
+        int n = 30;
+        vector<pair<int, int>> edges = GraphMat::getEdges_dense(n, 0.15 * seed, seed);
+        map<pair<int, int>, int> expected = bruteForceTruss(n, edges);
+        for (int threads: THREADS) {
+            Truss truss = GraphTruss::decompose(GraphCSR::fromEdges(n, edges), threads);
+            CHECK_EQ(truss.edges.size(), expected.size(), "truss edges gnp " + to_string(seed));
+            for (size_t e = 0; e < truss.edges.size(); e++) {
+                CHECK_EQ(truss.trussness[e], expected[truss.edges[e]], "trussness gnp " + to_string(seed));
+            }
+        }
+    }
+
+    int n = 60;
+    vector<pair<int, int>> edges = GraphMat::getEdges_dense(n, 0.3, 5);
+    string path = writeEdges(edges);
+    string socket = filesystem::temp_directory_path().string() + "/test_counting_" + to_string(getpid()) + ".sock";
+    GraphServer server(socket, 2, 2, 4);
+    server.addGraph("gnp", path);
+    thread serving = serveInBackground(server);
+
+    triangles::Graph graph = triangles::Graph::fromEdges(n, edges);
+    vector<int64_t> local = triangles::countLocalTriangles(graph);
+    vector<double> clustering = triangles::localClustering(graph);
+    triangles::TrussDecomposition truss = triangles::trussDecomposition(graph);
+
+    // Concurrent clients, each with several queries on its connection
+    vector<thread> clients;
+    for (int c = 0; c < 4; c++) {
+        clients.emplace_back([&, c]() {
+            try {
+                GraphClient client(socket);
+                vector<char> payload;
+                const auto* integers = (const int64_t*) payload.data();
+                for (int threads = 0; threads <= 2; threads++) {
+                    CHECK_EQ(client.query(QUERY_COUNT, "gnp", threads, 0, payload), STATUS_OK, "server count status");
+                    integers = (const int64_t*) payload.data();
+                    CHECK_EQ(integers[0], bruteForce(n, edges), "server count " + to_string(c));
+                }
+                CHECK_EQ(client.query(QUERY_INFO, "gnp", 0, 0, payload), STATUS_OK, "server info status");
+                integers = (const int64_t*) payload.data();
+                CHECK_EQ(integers[1], graph.numEdges(), "server info edges");
+                CHECK_EQ(client.query(QUERY_LOCAL, "gnp", 2, 0, payload), STATUS_OK, "server local status");
+                CHECK_EQ(payload.size(), n * sizeof(int64_t), "server local size");
+                CHECK_EQ(memcmp(payload.data(), local.data(), payload.size()), 0, "server local");
+                CHECK_EQ(client.query(QUERY_CLUSTERING, "gnp", 1, 0, payload), STATUS_OK, "server clustering status");
+                CHECK_EQ(memcmp(payload.data() + 2 * sizeof(double), clustering.data(), n * sizeof(double)), 0, "server clustering");
+                CHECK_EQ(client.query(QUERY_TRUSS, "gnp", 1, 4, payload), STATUS_OK, "server truss status");
+                integers = (const int64_t*) payload.data();
+                CHECK_EQ(integers[0], truss.maxTruss, "server max truss");
+                CHECK_EQ(integers[1], truss.countEdges(4), "server 4-truss");
+                CHECK_EQ(client.query(QUERY_COUNT, "missing", 1, 0, payload), STATUS_NOT_FOUND, "server missing graph");
+            } catch (const exception& e) {
+                // An exception escaping a thread would terminate the test
+                cerr << "client " << c << ": " << e.what() << endl;
+                CHECK_EQ(false, true, "server client " + to_string(c));
+            }
+        });
+    }
+    for (thread& client: clients) client.join();
+
+    server.stop();
+    serving.join();
+    CHECK_EQ(filesystem::exists(socket), false, "server socket removed");
+
+    // Connections past maxClients are answered busy and closed, their slots come back when clients close
+    GraphServer limited(socket, 1, 1, 4, 2);
+    limited.addGraph("gnp", path);
+    serving = serveInBackground(limited);
+    vector<char> payload;
+    {
+        GraphClient first(socket), second(socket);
+        CHECK_EQ(first.query(QUERY_INFO, "gnp", 0, 0, payload), STATUS_OK, "server first client");
+        CHECK_EQ(second.query(QUERY_INFO, "gnp", 0, 0, payload), STATUS_OK, "server second client");
+        GraphClient third(socket);
+        CHECK_EQ(third.query(QUERY_INFO, "gnp", 0, 0, payload), STATUS_BUSY, "server client past the limit");
+    }
+    QueryStatus status = STATUS_BUSY;
+    for (int attempt = 0; attempt < 100 && status == STATUS_BUSY; attempt++) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+        GraphClient client(socket);
+        status = client.query(QUERY_INFO, "gnp", 0, 0, payload);
+    }
+    CHECK_EQ(status, STATUS_OK, "server client after the others closed");
+    limited.stop();
+    serving.join();
+    filesystem::remove(path);
+}
+
+static void testDatasets() {
+    struct Dataset {string file; long long triangles; bool matrix;};
+    vector<Dataset> datasets = {{"email-Eu-core.txt", 105461, true},
+                                {"facebook_combined.txt", 1612010, false},
+                                {"Email-Enron.txt", 727044, false}};
+    for (const auto& [file, triangles, matrix]: datasets) {
+        string path = string(TEST_DATA_DIR) + "/" + file;
+        if (!filesystem::exists(path)) {
+            cout << "skipped " << file << ", not found in " << TEST_DATA_DIR << endl;
+            continue;
+        }
+        vector<pair<int, int>> edges = GraphMat::getEdges(path);
+        checkAllKernels(file, 0, edges, triangles, matrix);
+        checkFileKernels(file, path, triangles);
+    }
+
+    string facebook = string(TEST_DATA_DIR) + "/facebook_combined.txt";
+    if (filesystem::exists(facebook)) {
+        CSR dag = GraphCSR::orientByDegree(GraphCSR::fromEdges(0, GraphMat::getEdges(facebook)));
+        CHECK_EQ(GraphClique::countCliques(dag, 4, 2), 30004668, "facebook 4-cliques");
+    }
+}
+
+int main(int argc, char** argv) {
+    vector<pair<string, function<void()>>> groups = {{"small", testSmall}, {"random", testRandom},
+                                                     {"others", testOthers}, {"api", testApi}, {"server", testServer}, {"datasets", testDatasets}};
+    string selected = argc > 1 ? argv[1] : "";
+    bool found = false;
+    for (const auto& [name, test]: groups) {
+        if (!selected.empty() && selected != name) continue;
+        found = true;
+        cout << "running " << name << endl;
+        test();
+    }
+    if (!found) {
+        cerr << "unknown test group " << selected << endl;
+        return 2;
+    }
+    if (nFailures > 0) {
+        cerr << nFailures << " of " << nChecks << " checks failed" << endl;
+        return 1;
+    }
+    cout << "all " << nChecks << " checks passed" << endl;
+    return 0;
+}
@@ -0,0 +1,125 @@
+"""
+The Python module against a brute-force count: edge buffers of both widths and layouts, per-node counts,
+enumeration, cliques, snapshots and stopped counts. Run by ctest with the module on PYTHONPATH.
+"""
+import array
+import itertools
+import os
+import random
+import sys
+import tempfile
+import threading
+
+import triangles
+
+failures = 0
+
+
+def check(actual, expected, what):
+    global failures
+    if actual != expected:
+        print(f"{what}: expected {expected}, got {actual}", file=sys.stderr)
+        failures += 1
+
+
+def brute_force(n, edges):
+    adjacent = [set() for _ in range(n)]
+    for u, v in edges:
+        if u != v:
+            adjacent[u].add(v)
+            adjacent[v].add(u)
+    return [sorted(t) for t in itertools.combinations(range(n), 3)
+            if t[1] in adjacent[t[0]] and t[2] in adjacent[t[0]] and t[2] in adjacent[t[1]]]
+
+
+def main():
+    generator = random.Random(3)
+    n = 40
+    edges = [(generator.randrange(n), generator.randrange(n)) for _ in range(300)]
+    expected = brute_force(n, edges)
+    flat = [x for edge in edges for x in edge]
+
+    for code in ("i", "q"):
+        graph = triangles.Graph(array.array(code, flat), num_nodes=n)
+        check(graph.num_nodes, n, f"{code} nodes")
+        for threads in (1, 2, 4):
+            for backend, kernel in (("csr", "merge"), ("csr", "adaptive"), ("matrix", "merge"), ("compressed", "merge"), ("roaring", "merge")):
+                check(graph.count(threads=threads, backend=backend, kernel=kernel), len(expected),
+                      f"{code} count {backend} {kernel} {threads}")
+
+    data = array.array("q", flat)
+    rows = memoryview(data).cast("B").cast("q", (len(edges), 2))
+    check(triangles.Graph(rows).count(), len(expected), "shape (m, 2)")
+    every_other = array.array("i", [x for edge in edges for x in (edge[0], -1, edge[1], -1)])
+    check(triangles.Graph(memoryview(every_other)[::2]).count(), len(expected), "strided")
+
+    graph = triangles.Graph(data, num_nodes=n)
+    local = graph.local_counts(threads=2)
+    check(local.format, "q", "local format")
+    local = local.tolist()
+    for u in range(n):
+        check(local[u], sum(u in t for t in expected), f"local {u}")
+    out = array.array("q", [0]) * n
+    check(graph.local_counts(out=out) is out, True, "local out returned")
+    check(out.tolist(), local, "local out")
+
+    found = graph.triangles(threads=4)
+    check(found.shape, (len(expected), 3), "triangles shape")
+    check(sorted(sorted(row) for row in found.tolist()), sorted(expected), "triangles")
+
+    cliques = sum(1 for q in itertools.combinations(range(n), 4)
+                  if all(sorted(t) in expected for t in itertools.combinations(q, 3)))
+    check(graph.cliques(4, threads=2), cliques, "4-cliques")
+
+    with tempfile.TemporaryDirectory() as directory:
+        path = os.path.join(directory, "graph.bin")
+        graph.save(path)
+        check(triangles.Graph.load(path).count(), len(expected), "snapshot")
+
+    # The GIL is released, concurrent calls on the same graph all finish with the same count
+    results = []
+    workers = [threading.Thread(target=lambda: results.append(graph.count(threads=2))) for _ in range(4)]
+    for worker in workers:
+        worker.start()
+    for worker in workers:
+        worker.join()
+    check(results, [len(expected)] * 4, "concurrent counts")
+
+    # A timeout already passed stops the count before it starts, an exception of progress stops it and is raised
+    large = triangles.Graph(array.array("i", [x for u in range(300) for v in range(u + 1, 300, 3) for x in (u, v)]))
+    full = large.count()
+    for threads in (1, 4):
+        check(large.count_partial(threads=threads), (full, 1.0), f"count_partial complete {threads}")
+        stopped, fraction = large.count_partial(threads=threads, timeout=1e-9)
+        check(stopped <= full and fraction < 1, True, f"count_partial timeout {threads}")
+        try:
+            large.count(threads=threads, timeout=1e-9)
+            check("no error", "RuntimeError", f"count timeout {threads}")
+        except RuntimeError:
+            pass
+
+        def stop(fraction, rate, eta):
+            raise KeyboardInterrupt
+        try:
+            large.count(threads=threads, progress=stop, progress_interval=1e-9)
+            check("no error", "KeyboardInterrupt", f"progress raises {threads}")
+        except KeyboardInterrupt:
+            pass
+
+    for bad, error in ((array.array("d", [0.0, 1.0]), ValueError), (array.array("i", [0, 1, 2]), ValueError),
+                       (array.array("i", [0, -1]), RuntimeError)):
+        try:
+            triangles.Graph(bad)
+            check("no error", error.__name__, f"bad edges {bad}")
+        except error:
+            pass
+
+    if failures:
+        print(f"{failures} checks failed", file=sys.stderr)
+        return 1
+    print("all checks passed")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())